@@ -0,0 +1,205 @@
+// Copyright (c) 2021 Nicholas Corgan
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "BenchmarkBlocks.hpp"
+
+#include <Pothos/Framework.hpp>
+#include <Pothos/Object.hpp>
+
+#include <complex>
+
+static constexpr size_t NumBenchmarkTaps = 64;
+
+static const std::vector<std::string> IntTypes = {"int32", "uint32"};
+static const std::vector<std::string> FloatTypes = {"float32", "float64"};
+static const std::vector<std::string> ComplexTypes = {"complex_float32", "complex_float64"};
+static const std::vector<std::string> IntFloatTypes = {"int32", "uint32", "float32", "float64"};
+static const std::vector<std::string> FloatComplexTypes = {"float32", "float64", "complex_float32", "complex_float64"};
+static const std::vector<std::string> AllTypes = {"int32", "uint32", "float32", "float64", "complex_float32", "complex_float64"};
+
+BenchmarkBlockFactory makeOneTypeFactory(const std::string& path)
+{
+    return [path](const std::string& device, const std::string& dtype)
+    {
+        return Pothos::BlockRegistry::make(path, device, dtype);
+    };
+}
+
+BenchmarkBlockFactory makeNToOneFactory(
+    const std::string& path,
+    size_t numInputs)
+{
+    return [path, numInputs](const std::string& device, const std::string& dtype)
+    {
+        return Pothos::BlockRegistry::make(path, device, dtype, numInputs);
+    };
+}
+
+// Blocks whose factory takes (device,dtype,...) with fixed trailing arguments
+template <typename... Args>
+static BenchmarkBlockFactory makeOneTypeFactoryWithArgs(
+    const std::string& path,
+    Args... args)
+{
+    return [path, args...](const std::string& device, const std::string& dtype)
+    {
+        return Pothos::BlockRegistry::make(path, device, dtype, args...);
+    };
+}
+
+static BenchmarkBlockFactory makeOperationFactory(
+    const std::string& path,
+    const std::string& operation,
+    size_t numInputs)
+{
+    return [path, operation, numInputs](const std::string& device, const std::string& dtype)
+    {
+        return Pothos::BlockRegistry::make(path, device, operation, dtype, numInputs);
+    };
+}
+
+static BenchmarkBlockFactory makeScalarOperationFactory(
+    const std::string& path,
+    const std::string& operation)
+{
+    return [path, operation](const std::string& device, const std::string& dtype)
+    {
+        return Pothos::BlockRegistry::make(path, device, operation, dtype, 2);
+    };
+}
+
+static BenchmarkBlockFactory makeComparatorFactory(
+    const std::string& path,
+    const std::string& operation)
+{
+    return [path, operation](const std::string& device, const std::string& dtype)
+    {
+        return Pothos::BlockRegistry::make(path, device, operation, dtype);
+    };
+}
+
+// Matches Tap<T>::Type in Source/Utility.hpp, as setTaps() won't convert
+// between vector types.
+static Pothos::Object getBenchmarkTaps(const std::string& dtype)
+{
+    if("float64" == dtype)
+    {
+        return Pothos::Object(std::vector<double>(NumBenchmarkTaps, 1.0 / NumBenchmarkTaps));
+    }
+    else if("complex_float32" == dtype)
+    {
+        return Pothos::Object(std::vector<std::complex<float>>(NumBenchmarkTaps, 1.0f / NumBenchmarkTaps));
+    }
+    else if("complex_float64" == dtype)
+    {
+        return Pothos::Object(std::vector<std::complex<double>>(NumBenchmarkTaps, 1.0 / NumBenchmarkTaps));
+    }
+
+    return Pothos::Object(std::vector<float>(NumBenchmarkTaps, 1.0f / NumBenchmarkTaps));
+}
+
+// The default single tap would make these a copy, so benchmark a
+// realistic filter length.
+static BenchmarkBlockFactory makeTapsFactory(const std::string& path)
+{
+    return [path](const std::string& device, const std::string& dtype)
+    {
+        auto block = Pothos::BlockRegistry::make(path, device, dtype);
+        block.call("setTaps", getBenchmarkTaps(dtype));
+
+        return block;
+    };
+}
+
+// Only blocks that process a stream are worth benchmarking, so sources and
+// file I/O blocks are left out.
+std::vector<BenchmarkBlock> getManualBenchmarkBlocks()
+{
+    return
+    {
+        {"/gpu/algorithm/max", IntFloatTypes, makeOneTypeFactory("/gpu/algorithm/max")},
+        {"/gpu/algorithm/min", IntFloatTypes, makeOneTypeFactory("/gpu/algorithm/min")},
+        {"/gpu/algorithm/set_union", IntFloatTypes, makeNToOneFactory("/gpu/algorithm/set_union", 2)},
+        {"/gpu/algorithm/set_unique", IntFloatTypes, makeOneTypeFactory("/gpu/algorithm/set_unique")},
+        {"/gpu/algorithm/sort", IntFloatTypes, makeOneTypeFactory("/gpu/algorithm/sort")},
+        {"/gpu/arith/acot", FloatTypes, makeOneTypeFactory("/gpu/arith/acot")},
+        {"/gpu/arith/acoth", FloatTypes, makeOneTypeFactory("/gpu/arith/acoth")},
+        {"/gpu/arith/acsc", FloatTypes, makeOneTypeFactory("/gpu/arith/acsc")},
+        {"/gpu/arith/acsch", FloatTypes, makeOneTypeFactory("/gpu/arith/acsch")},
+        {"/gpu/arith/asec", FloatTypes, makeOneTypeFactory("/gpu/arith/asec")},
+        {"/gpu/arith/asech", FloatTypes, makeOneTypeFactory("/gpu/arith/asech")},
+        {"/gpu/arith/clamp", IntFloatTypes, makeOneTypeFactoryWithArgs("/gpu/arith/clamp", 25, 75)},
+        {"/gpu/arith/combine_complex", FloatTypes, makeOneTypeFactory("/gpu/arith/combine_complex")},
+        {"/gpu/arith/complex_to_polar", FloatTypes, makeOneTypeFactory("/gpu/arith/complex_to_polar")},
+        {"/gpu/arith/cot", FloatTypes, makeOneTypeFactory("/gpu/arith/cot")},
+        {"/gpu/arith/coth", FloatTypes, makeOneTypeFactory("/gpu/arith/coth")},
+        {"/gpu/arith/csc", FloatTypes, makeOneTypeFactory("/gpu/arith/csc")},
+        {"/gpu/arith/csch", FloatTypes, makeOneTypeFactory("/gpu/arith/csch")},
+        {"/gpu/arith/expression", FloatComplexTypes,
+            [](const std::string& device, const std::string& dtype)
+            {
+                auto block = Pothos::BlockRegistry::make("/gpu/arith/expression", device, dtype, 2);
+                block.call("setExpression", std::string("sqrt(x0*x0 + x1*x1) * 0.5"));
+
+                return block;
+            }},
+        {"/gpu/arith/isinf", FloatTypes, makeOneTypeFactory("/gpu/arith/isinf")},
+        {"/gpu/arith/isnan", FloatTypes, makeOneTypeFactory("/gpu/arith/isnan")},
+        {"/gpu/arith/iszero", AllTypes, makeOneTypeFactory("/gpu/arith/iszero")},
+        {"/gpu/arith/log", FloatTypes, makeOneTypeFactoryWithArgs("/gpu/arith/log", 10.0)},
+        {"/gpu/arith/polar_to_complex", FloatTypes, makeOneTypeFactory("/gpu/arith/polar_to_complex")},
+        {"/gpu/arith/pow", AllTypes, makeOneTypeFactoryWithArgs("/gpu/arith/pow", 2.0)},
+        {"/gpu/arith/powN", FloatComplexTypes, makeOneTypeFactoryWithArgs("/gpu/arith/powN", 3.0)},
+        {"/gpu/arith/root", FloatComplexTypes, makeOneTypeFactoryWithArgs("/gpu/arith/root", 4.0)},
+        // Only in the generated list for ArrayFire 3.7+, as older versions
+        // register a fallback (see Source/Fallback.cpp).
+        {"/gpu/arith/rsqrt", FloatTypes, makeOneTypeFactory("/gpu/arith/rsqrt")},
+        {"/gpu/arith/sec", FloatTypes, makeOneTypeFactory("/gpu/arith/sec")},
+        {"/gpu/arith/sech", FloatTypes, makeOneTypeFactory("/gpu/arith/sech")},
+        {"/gpu/arith/sign", {"int32", "float32", "float64"}, makeOneTypeFactory("/gpu/arith/sign")},
+        {"/gpu/arith/split_complex", FloatTypes, makeOneTypeFactory("/gpu/arith/split_complex")},
+        {"/gpu/array/arithmetic:Add", AllTypes, makeOperationFactory("/gpu/array/arithmetic", "Add", 2)},
+        {"/gpu/array/arithmetic:Multiply", AllTypes, makeOperationFactory("/gpu/array/arithmetic", "Multiply", 2)},
+        {"/gpu/array/bitwise:And", IntTypes, makeOperationFactory("/gpu/array/bitwise", "And", 2)},
+        {"/gpu/array/bitwise_not", IntTypes, makeOneTypeFactory("/gpu/array/bitwise_not")},
+        {"/gpu/array/cast", AllTypes,
+            [](const std::string& device, const std::string& dtype)
+            {
+                // Always cast to a different type so the block does real work.
+                const Pothos::DType inputDType(dtype);
+                const std::string outputDType = inputDType.isComplex() ? ("complex_float32" == dtype ? "complex_float64" : "complex_float32")
+                                                                       : ("float32" == dtype ? "float64" : "float32");
+
+                return Pothos::BlockRegistry::make("/gpu/array/cast", device, dtype, outputDType);
+            }},
+        {"/gpu/array/comparator:<", IntFloatTypes, makeComparatorFactory("/gpu/array/comparator", "<")},
+        {"/gpu/array/logical:And", IntTypes, makeOperationFactory("/gpu/array/logical", "And", 2)},
+        {"/gpu/data/flip", AllTypes, makeOneTypeFactory("/gpu/data/flip")},
+        {"/gpu/data/replace", IntFloatTypes, makeOneTypeFactoryWithArgs("/gpu/data/replace", 50, 0)},
+        {"/gpu/scalar/arithmetic:Add", AllTypes, makeScalarOperationFactory("/gpu/scalar/arithmetic", "Add")},
+        {"/gpu/scalar/arithmetic:Multiply", AllTypes, makeScalarOperationFactory("/gpu/scalar/arithmetic", "Multiply")},
+        {"/gpu/scalar/bitshift:Left Shift", IntTypes, makeOneTypeFactoryWithArgs("/gpu/scalar/bitshift", std::string("Left Shift"), size_t(1))},
+        {"/gpu/scalar/bitwise:And", IntTypes, makeScalarOperationFactory("/gpu/scalar/bitwise", "And")},
+        {"/gpu/scalar/comparator:<", IntFloatTypes, makeScalarOperationFactory("/gpu/scalar/comparator", "<")},
+        {"/gpu/scalar/logical:And", IntTypes, makeScalarOperationFactory("/gpu/scalar/logical", "And")},
+        {"/gpu/signal/convolve", AllTypes, makeTapsFactory("/gpu/signal/convolve")},
+        {"/gpu/signal/fft", ComplexTypes,
+            [](const std::string& device, const std::string& dtype)
+            {
+                return Pothos::BlockRegistry::make("/gpu/signal/fft", device, dtype, dtype, 1024, 1.0, false);
+            }},
+        {"/gpu/signal/fftconvolve", AllTypes, makeTapsFactory("/gpu/signal/fftconvolve")},
+        {"/gpu/signal/fir_filter", FloatComplexTypes, makeTapsFactory("/gpu/signal/fir_filter")},
+        {"/gpu/signal/iir_filter", FloatComplexTypes, makeOneTypeFactory("/gpu/signal/iir_filter")},
+        {"/gpu/signal/sinc", FloatTypes, makeOneTypeFactory("/gpu/signal/sinc")},
+        {"/gpu/statistics/corrcoef", IntFloatTypes, makeOneTypeFactory("/gpu/statistics/corrcoef")},
+        {"/gpu/statistics/cov", IntFloatTypes, makeOneTypeFactory("/gpu/statistics/cov")},
+        {"/gpu/statistics/medabsdev", IntFloatTypes, makeOneTypeFactory("/gpu/statistics/medabsdev")},
+        {"/gpu/statistics/mean", FloatTypes, makeOneTypeFactory("/gpu/statistics/mean")},
+        {"/gpu/statistics/median", FloatTypes, makeOneTypeFactory("/gpu/statistics/median")},
+        {"/gpu/statistics/rms", FloatTypes, makeOneTypeFactory("/gpu/statistics/rms")},
+        {"/gpu/statistics/stdev", IntFloatTypes, makeOneTypeFactory("/gpu/statistics/stdev")},
+        {"/gpu/statistics/topk", IntFloatTypes, makeOneTypeFactory("/gpu/statistics/topk")},
+        {"/gpu/statistics/var", IntFloatTypes, makeOneTypeFactoryWithArgs("/gpu/statistics/var", false)},
+    };
+}
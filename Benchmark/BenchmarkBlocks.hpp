@@ -0,0 +1,36 @@
+// Copyright (c) 2021 Nicholas Corgan
+// SPDX-License-Identifier: BSD-3-Clause
+
+#pragma once
+
+#include <Pothos/Proxy.hpp>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+using BenchmarkBlockFactory = std::function<Pothos::Proxy(const std::string& device, const std::string& dtype)>;
+
+struct BenchmarkBlock
+{
+    std::string path;
+
+    // The type passed into the factory, not necessarily the port types
+    std::vector<std::string> dtypes;
+
+    BenchmarkBlockFactory factory;
+};
+
+// Blocks whose factory takes (device,dtype)
+BenchmarkBlockFactory makeOneTypeFactory(const std::string& path);
+
+// Blocks whose factory takes (device,dtype,numInputs)
+BenchmarkBlockFactory makeNToOneFactory(
+    const std::string& path,
+    size_t numInputs);
+
+// Generated from Blocks.yaml
+std::vector<BenchmarkBlock> getAutoBenchmarkBlocks();
+
+// Hand-written block registries
+std::vector<BenchmarkBlock> getManualBenchmarkBlocks();
@@ -0,0 +1,404 @@
+// Copyright (c) 2021 Nicholas Corgan
+// SPDX-License-Identifier: BSD-3-Clause
+
+//
+// Measures sustained throughput and per-call latency for PothosGPU blocks
+// across data types, buffer sizes, and devices, and outputs the results as
+// JSON for regression comparison.
+//
+// Throughput is measured from the wall time of a full topology run, so it
+// includes scheduling and transfer overhead. Per-call latency comes from the
+// block's own stage timings (see BlockStats.hpp), which are recorded in a
+// separate run, as the synchronization they need would otherwise be counted
+// against throughput.
+//
+
+#include "BenchmarkBlocks.hpp"
+
+#include <Pothos/Exception.hpp>
+#include <Pothos/Framework.hpp>
+#include <Pothos/Init.hpp>
+#include <Pothos/Plugin.hpp>
+#include <Pothos/Proxy.hpp>
+
+#include <Poco/Exception.h>
+#include <Poco/NumberParser.h>
+#include <Poco/String.h>
+#include <Poco/StringTokenizer.h>
+
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+using json = nlohmann::json;
+using Clock = std::chrono::steady_clock;
+
+static constexpr double IdleDuration = 0.01;
+static constexpr double RunTimeout = 60.0;
+static constexpr size_t WarmupBuffers = 2;
+static constexpr size_t MinBuffers = 16;
+
+struct BenchmarkOptions
+{
+    std::string outputPath;
+    std::vector<std::string> backends;
+    std::string filter;
+    std::vector<size_t> bufferSizes{1 << 10, 1 << 14, 1 << 18};
+    size_t elementsPerRun{1 << 22};
+
+    // GPU block path -> host block path, both taking the same dtype
+    std::map<std::string, std::string> hostBlocks;
+};
+
+struct BenchmarkDevice
+{
+    std::string name;
+    std::string backend;
+};
+
+//
+// Utility
+//
+
+static void printUsage(const char* program)
+{
+    std::cout << "Usage: " << program << " [options]" << std::endl
+              << std::endl
+              << "Options:" << std::endl
+              << "  --output <file>          Write JSON results here instead of stdout" << std::endl
+              << "  --backend <a,b,...>      Only run on devices with the given backends (CPU, CUDA, OpenCL)" << std::endl
+              << "  --filter <text>          Only run blocks whose path contains the given text" << std::endl
+              << "  --sizes <a,b,...>        Buffer sizes (in elements) to sweep" << std::endl
+              << "  --elements <num>         Elements to process per run (default 4194304)" << std::endl
+              << "  --host <gpuPath=path>    Also run the given host block for comparison (repeatable)" << std::endl
+              << "  --help                   Print this message" << std::endl;
+}
+
+static std::vector<std::string> splitList(const std::string& str)
+{
+    const Poco::StringTokenizer tokenizer(
+        str,
+        ",",
+        (Poco::StringTokenizer::TOK_IGNORE_EMPTY | Poco::StringTokenizer::TOK_TRIM));
+
+    return std::vector<std::string>(tokenizer.begin(), tokenizer.end());
+}
+
+static BenchmarkOptions parseOptions(int argc, char** argv)
+{
+    BenchmarkOptions options;
+
+    for(int i = 1; i < argc; ++i)
+    {
+        const std::string arg(argv[i]);
+        if("--help" == arg)
+        {
+            printUsage(argv[0]);
+            std::exit(EXIT_SUCCESS);
+        }
+
+        if((i+1) >= argc)
+        {
+            throw Pothos::InvalidArgumentException("Missing value for option", arg);
+        }
+        const std::string value(argv[++i]);
+
+        if("--output" == arg) options.outputPath = value;
+        else if("--backend" == arg) options.backends = splitList(value);
+        else if("--filter" == arg) options.filter = value;
+        else if("--elements" == arg) options.elementsPerRun = Poco::NumberParser::parseUnsigned64(value);
+        else if("--sizes" == arg)
+        {
+            options.bufferSizes.clear();
+            for(const auto& size: splitList(value))
+            {
+                options.bufferSizes.emplace_back(Poco::NumberParser::parseUnsigned64(size));
+            }
+        }
+        else if("--host" == arg)
+        {
+            const auto separator = value.find('=');
+            if(std::string::npos == separator)
+            {
+                throw Pothos::InvalidArgumentException("Expected gpuPath=hostPath", value);
+            }
+
+            options.hostBlocks[value.substr(0, separator)] = value.substr(separator+1);
+        }
+        else throw Pothos::InvalidArgumentException("Invalid option", arg);
+    }
+
+    return options;
+}
+
+static json getDeviceInfo()
+{
+    auto plugin = Pothos::PluginRegistry::get("/devices/gpu/info");
+    auto getter = plugin.getObject().extract<Pothos::Callable>();
+
+    return json::parse(getter.call<std::string>());
+}
+
+static std::vector<BenchmarkDevice> getBenchmarkDevices(
+    const json& deviceInfo,
+    const std::vector<std::string>& backends)
+{
+    std::vector<BenchmarkDevice> devices;
+    for(const auto& deviceJSON: deviceInfo["PothosGPU Device"])
+    {
+        BenchmarkDevice device;
+        device.name = deviceJSON["Name"].get<std::string>();
+        device.backend = deviceJSON["Backend"].get<std::string>();
+
+        const bool backendMatches = backends.empty() ||
+                                    (backends.end() != std::find_if(
+                                                           backends.begin(),
+                                                           backends.end(),
+                                                           [&device](const std::string& backend)
+                                                           {return (0 == Poco::icompare(backend, device.backend));}));
+        if(backendMatches) devices.emplace_back(std::move(device));
+    }
+
+    return devices;
+}
+
+// Positive values keep domain-limited functions (log, sqrt, division) happy.
+static Pothos::BufferChunk getRandomInputs(
+    const Pothos::DType& dtype,
+    size_t numElements)
+{
+    static std::mt19937 rng(std::random_device{}());
+    std::uniform_real_distribution<double> dist(1.0, 100.0);
+
+    Pothos::BufferChunk float64Buffer("float64", numElements);
+    double* buffer = float64Buffer;
+    for(size_t elem = 0; elem < numElements; ++elem) buffer[elem] = dist(rng);
+
+    return float64Buffer.convert(dtype);
+}
+
+//
+// Running a single configuration
+//
+
+// Returns the wall time in seconds.
+static double runBlock(
+    const Pothos::Proxy& block,
+    size_t bufferSize,
+    size_t numBuffers)
+{
+    const auto inputs = block.call<std::vector<Pothos::InputPort*>>("inputs");
+    const auto outputs = block.call<std::vector<Pothos::OutputPort*>>("outputs");
+
+    Pothos::Topology topology;
+
+    for(const auto* input: inputs)
+    {
+        auto feederSource = Pothos::BlockRegistry::make(
+                                "/blocks/feeder_source",
+                                input->dtype());
+
+        const auto inputBuffer = getRandomInputs(input->dtype(), bufferSize);
+        for(size_t i = 0; i < numBuffers; ++i) feederSource.call("feedBuffer", inputBuffer);
+
+        topology.connect(feederSource, 0, block, input->name());
+    }
+
+    for(const auto* output: outputs)
+    {
+        auto collectorSink = Pothos::BlockRegistry::make(
+                                 "/blocks/collector_sink",
+                                 output->dtype());
+
+        topology.connect(block, output->name(), collectorSink, 0);
+    }
+
+    const auto start = Clock::now();
+    topology.commit();
+    if(!topology.waitInactive(IdleDuration, RunTimeout))
+    {
+        throw Pothos::TimeoutException("Benchmark run did not complete");
+    }
+    const auto end = Clock::now();
+
+    // Don't count the time spent confirming the topology was idle.
+    return std::max(
+               std::chrono::duration<double>(end - start).count() - IdleDuration,
+               std::numeric_limits<double>::epsilon());
+}
+
+static json runConfiguration(
+    const BenchmarkOptions& options,
+    const BenchmarkBlockFactory& factory,
+    const std::string& device,
+    const std::string& dtype,
+    size_t bufferSize,
+    bool isGPUBlock)
+{
+    json result;
+    result["DType"] = dtype;
+    result["Buffer Size"] = bufferSize;
+
+    try
+    {
+        auto block = factory(device, dtype);
+
+        // Stats may be enabled on creation by POTHOSGPU_BLOCK_STATS.
+        if(isGPUBlock) block.call("setStatsEnabled", false);
+
+        const auto numBuffers = std::max(MinBuffers, (options.elementsPerRun / bufferSize));
+
+        // Get one-time costs like JIT compilation out of the way.
+        runBlock(block, bufferSize, WarmupBuffers);
+
+        const auto seconds = runBlock(block, bufferSize, numBuffers);
+        const auto numElements = numBuffers * bufferSize;
+
+        result["Elements"] = numElements;
+        result["Time (s)"] = seconds;
+        result["Throughput (samples/s)"] = static_cast<double>(numElements) / seconds;
+
+        if(isGPUBlock)
+        {
+            block.call("setStatsEnabled", true);
+            block.call("resetStats");
+            runBlock(block, bufferSize, numBuffers);
+
+            auto stats = json::parse(block.call<std::string>("stats"));
+            const auto calls = stats["Calls"].get<size_t>();
+            const double callTimeMs = stats["Upload Time (ms)"].get<double>() +
+                                      stats["Compute Time (ms)"].get<double>() +
+                                      stats["Sync Time (ms)"].get<double>() +
+                                      stats["Download Time (ms)"].get<double>();
+
+            result["Latency Per Call (us)"] = (calls > 0) ? ((callTimeMs * 1e3) / calls) : 0.0;
+            result["Stats"] = stats;
+        }
+    }
+    catch(const Pothos::Exception& ex)
+    {
+        result["Error"] = ex.displayText();
+    }
+
+    return result;
+}
+
+//
+// Main
+//
+
+int main(int argc, char** argv)
+{
+    try
+    {
+        const auto options = parseOptions(argc, argv);
+
+        Pothos::ScopedInit init;
+
+        const auto deviceInfo = getDeviceInfo();
+        const auto devices = getBenchmarkDevices(deviceInfo, options.backends);
+        if(devices.empty())
+        {
+            throw Pothos::RuntimeException("No devices match the given backends.");
+        }
+
+        // Some manual entries cover blocks the generated list only has for
+        // newer ArrayFire versions, so don't run those twice.
+        auto blocks = getAutoBenchmarkBlocks();
+        for(auto& manualBlock: getManualBenchmarkBlocks())
+        {
+            const bool isDuplicate = (blocks.end() != std::find_if(
+                                                          blocks.begin(),
+                                                          blocks.end(),
+                                                          [&manualBlock](const BenchmarkBlock& block)
+                                                          {return (block.path == manualBlock.path);}));
+            if(!isDuplicate) blocks.emplace_back(std::move(manualBlock));
+        }
+
+        json results(json::array());
+        for(const auto& block: blocks)
+        {
+            if(std::string::npos == block.path.find(options.filter)) continue;
+            std::cerr << block.path << std::endl;
+
+            const auto hostBlockIter = options.hostBlocks.find(block.path);
+
+            for(const auto& dtype: block.dtypes)
+            {
+                for(const auto bufferSize: options.bufferSizes)
+                {
+                    for(const auto& device: devices)
+                    {
+                        auto result = runConfiguration(
+                                          options,
+                                          block.factory,
+                                          device.name,
+                                          dtype,
+                                          bufferSize,
+                                          true);
+                        result["Block"] = block.path;
+                        result["Device"] = device.name;
+                        result["Backend"] = device.backend;
+                        results.push_back(result);
+                    }
+
+                    if(options.hostBlocks.end() != hostBlockIter)
+                    {
+                        const auto& hostPath = hostBlockIter->second;
+                        auto result = runConfiguration(
+                                          options,
+                                          [&hostPath](const std::string&, const std::string& dtype)
+                                          {
+                                              return Pothos::BlockRegistry::make(hostPath, dtype);
+                                          },
+                                          "",
+                                          dtype,
+                                          bufferSize,
+                                          false);
+                        result["Block"] = block.path;
+                        result["Host Block"] = hostPath;
+                        result["Device"] = "Host";
+                        result["Backend"] = "None";
+                        results.push_back(result);
+                    }
+                }
+            }
+        }
+
+        json output;
+        output["PothosGPU Library Info"] = deviceInfo["PothosGPU Library Info"];
+        output["Results"] = results;
+
+        if(options.outputPath.empty()) std::cout << output.dump(4) << std::endl;
+        else
+        {
+            std::ofstream outputFile(options.outputPath);
+            if(!outputFile)
+            {
+                throw Pothos::FileException("Failed to open output file", options.outputPath);
+            }
+            outputFile << output.dump(4) << std::endl;
+        }
+    }
+    catch(const Pothos::Exception& ex)
+    {
+        std::cerr << ex.displayText() << std::endl;
+        return EXIT_FAILURE;
+    }
+    catch(const Poco::Exception& ex)
+    {
+        std::cerr << ex.displayText() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
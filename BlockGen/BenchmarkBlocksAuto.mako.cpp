@@ -0,0 +1,22 @@
+#include "BenchmarkBlocks.hpp"
+
+std::vector<BenchmarkBlock> getAutoBenchmarkBlocks()
+{
+    return
+    {
+%for block in oneToOneBlocks + twoToOneBlocks:
+        {
+            "/gpu/${block["header"]}/${block["blockName"]}",
+            {${", ".join(["\"{0}\"".format(dtype) for dtype in block["benchmarkDTypes"]])}},
+            makeOneTypeFactory("/gpu/${block["header"]}/${block["blockName"]}")
+        },
+%endfor
+%for block in NToOneBlocks:
+        {
+            "/gpu/${block["header"]}/${block["blockName"]}",
+            {${", ".join(["\"{0}\"".format(dtype) for dtype in block["benchmarkDTypes"]])}},
+            makeNToOneFactory("/gpu/${block["header"]}/${block["blockName"]}", 2)
+        },
+%endfor
+    };
+}
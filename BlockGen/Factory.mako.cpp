@@ -12,20 +12,39 @@
 
 #include <vector>
 
-static const std::vector<Pothos::BlockRegistry> BlockRegistries =
+//
+// ArrayFire's functions can't be template arguments when imported from a
+// DLL, so wrap each one for DirectOneToOneBlock.
+//
+
+namespace OneToOneFuncs
 {
 %for block in oneToOneBlocks:
-    Pothos::BlockRegistry(
+    struct ${block["header"].title()}${block["blockName"].title().replace("_", "")}
+    {
+        static af::array call(const af::array& afInput)
+        {
+            return af::${block["func"]}(afInput);
+        }
+    };
+
+%endfor
+}
+
+static const std::vector<std::vector<Pothos::BlockRegistry>> OneToOneBlockRegistries =
+{
+%for block in oneToOneBlocks:
+<%
+    funcType = "OneToOneFuncs::{0}{1}".format(block["header"].title(), block["blockName"].title().replace("_", ""))
+%>\
+    makeOneToOneBlockRegistries(
         "/gpu/${block["header"]}/${block["blockName"]}",
     %if block.get("pattern", "") == "FloatToComplex":
-        Pothos::Callable(&OneToOneBlock::makeFloatToComplex)
-            .bind<OneToOneFunc>(&af::${block["func"]}, 1)
+        Pothos::Callable(&DirectOneToOneBlock<${funcType}>::makeFloatToComplex)
     %elif block.get("pattern", "") == "ComplexToFloat":
-        Pothos::Callable(&OneToOneBlock::makeComplexToFloat)
-            .bind<OneToOneFunc>(&af::${block["func"]}, 1)
+        Pothos::Callable(&DirectOneToOneBlock<${funcType}>::makeComplexToFloat)
     %else:
-        Pothos::Callable(&OneToOneBlock::makeFromOneType)
-            .bind<OneToOneFunc>(&af::${block["func"]}, 1)
+        Pothos::Callable(&DirectOneToOneBlock<${funcType}>::makeFromOneType)
             .bind<DTypeSupport>({
                 ${"true" if block["supportedTypes"].get("supportInt", block["supportedTypes"].get("supportAll", False)) else "false"},
                 ${"true" if block["supportedTypes"].get("supportUInt", block["supportedTypes"].get("supportAll", False)) else "false"},
@@ -35,6 +54,10 @@ static const std::vector<Pothos::BlockRegistry> BlockRegistries =
     %endif
     ),
 %endfor
+};
+
+static const std::vector<Pothos::BlockRegistry> BlockRegistries =
+{
 %for block in twoToOneBlocks:
     Pothos::BlockRegistry(
         "/gpu/${block["header"]}/${block["blockName"]}",
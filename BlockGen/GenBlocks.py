@@ -16,6 +16,7 @@ Now = datetime.datetime.now()
 
 FactoryTemplate = None
 BlockExecutionTestAutoTemplate = None
+BenchmarkBlocksAutoTemplate = None
 
 prefix = """// Copyright (c) 2019-{0} Nicholas Corgan
 // SPDX-License-Identifier: BSD-3-Clause
@@ -34,6 +35,7 @@ def afVersionToAPI(version):
 def populateTemplates():
     global FactoryTemplate
     global BlockExecutionTestAutoTemplate
+    global BenchmarkBlocksAutoTemplate
 
     factoryFunctionTemplatePath = os.path.join(ScriptDir, "Factory.mako.cpp")
     with open(factoryFunctionTemplatePath) as f:
@@ -43,6 +45,10 @@ def populateTemplates():
     with open(blockExecutionTestAutoTemplatePath) as f:
         BlockExecutionTestAutoTemplate = f.read()
 
+    benchmarkBlocksAutoTemplatePath = os.path.join(ScriptDir, "BenchmarkBlocksAuto.mako.cpp")
+    with open(benchmarkBlocksAutoTemplatePath) as f:
+        BenchmarkBlocksAutoTemplate = f.read()
+
 # In place
 def setBlockNames(blockTypeYAML):
     # If a specific block registry path node name is not provided, use the
@@ -162,6 +168,14 @@ def generatePothosDoc(category,blockYAML):
                                 default="2" if category == "NToOneBlocks" else "1",
                                 preview="disable")]
 
+    if category == "OneToOneBlocks":
+        desc["args"] += ["numChannels"]
+        desc["params"] += [dict(key="numChannels",
+                                name="Num Channels",
+                                desc=["The number of input/output pairs. All channels are processed together in one kernel."],
+                                default="1",
+                                preview="disable")]
+
     if "supportedTypes" in blockYAML:
         dtypeArg["default"] = "\"{0}\"".format(blockYAML["supportedTypes"]["defaultType"])
 
@@ -226,6 +240,47 @@ def generateBlockExecutionTest(allBlockYAML):
     with open(outputFilepath, 'w') as f:
         f.write(output)
 
+BENCHMARK_DTYPES = dict(
+    supportInt=["int32"],
+    supportUInt=["uint32"],
+    supportFloat=["float32", "float64"],
+    supportComplexFloat=["complex_float32", "complex_float64"]
+)
+
+# Operates in-place
+def setBenchmarkDTypes(block):
+    # Both patterns take the float type, regardless of which port is complex.
+    if block.get("pattern", "") in ["FloatToComplex", "ComplexToFloat"]:
+        block["benchmarkDTypes"] = BENCHMARK_DTYPES["supportFloat"]
+    else:
+        supportedTypes = block["supportedTypes"]
+        block["benchmarkDTypes"] = []
+        for key in BENCHMARK_DTYPES:
+            if supportedTypes.get(key, supportedTypes.get("supportAll", False)):
+                block["benchmarkDTypes"] += BENCHMARK_DTYPES[key]
+
+def generateBenchmarkBlocks(allBlockYAML):
+    # Only benchmark blocks that are actually registered.
+    blocks = dict()
+    for category in ["OneToOneBlocks", "TwoToOneBlocks", "NToOneBlocks"]:
+        blocks[category] = filterBlockYAML([block for block in allBlockYAML[category] if not block.get("testOnly", False)])
+        for block in blocks[category]:
+            setBenchmarkDTypes(block)
+
+    try:
+        rendered = Template(BenchmarkBlocksAutoTemplate).render(
+                       oneToOneBlocks=blocks["OneToOneBlocks"],
+                       twoToOneBlocks=blocks["TwoToOneBlocks"],
+                       NToOneBlocks=blocks["NToOneBlocks"])
+    except:
+        print(mako.exceptions.text_error_template().render())
+
+    output = "{0}\n{1}".format(prefix, rendered)
+
+    outputFilepath = os.path.join(OutputDir, "BenchmarkBlocksAuto.cpp")
+    with open(outputFilepath, 'w') as f:
+        f.write(output)
+
 if __name__ == "__main__":
     populateTemplates()
 
@@ -234,3 +289,4 @@ if __name__ == "__main__":
 
     generateFactory(allBlockYAML)
     generateBlockExecutionTest(allBlockYAML)
+    generateBenchmarkBlocks(allBlockYAML)
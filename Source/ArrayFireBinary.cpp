@@ -0,0 +1,499 @@
+// Copyright (c) 2021 Nicholas Corgan
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "ArrayFireBinary.hpp"
+
+#include <Pothos/Exception.hpp>
+#include <Pothos/Framework.hpp>
+#include <Pothos/Object.hpp>
+
+#include <Poco/File.h>
+#include <Poco/Format.h>
+#include <Poco/NumberFormatter.h>
+
+#include <arrayfire.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <numeric>
+#include <utility>
+
+// The only version af::saveArray has ever written
+static constexpr char ArrayFireBinaryVersion = 1;
+
+//
+// ArrayFireBinaryEntry
+//
+
+Pothos::DType ArrayFireBinaryEntry::dtype() const
+{
+    return Pothos::Object(afDType).convert<Pothos::DType>();
+}
+
+// Matches af::array::numdims()
+size_t ArrayFireBinaryEntry::numDims() const
+{
+    size_t ret = 4;
+    while((ret > 1) && (1 == dims[ret-1])) --ret;
+
+    return ret;
+}
+
+size_t ArrayFireBinaryEntry::elements() const
+{
+    return std::accumulate(
+               dims.begin(),
+               dims.end(),
+               size_t(1),
+               std::multiplies<size_t>());
+}
+
+size_t ArrayFireBinaryEntry::bytes() const
+{
+    return this->elements() * this->dtype().size();
+}
+
+//
+// Parsing
+//
+
+template <typename T>
+static T readValue(
+    std::ifstream& file,
+    const std::string& filepath)
+{
+    T ret;
+    file.read(reinterpret_cast<char*>(&ret), sizeof(ret));
+    if(!file)
+    {
+        throw Pothos::DataFormatException(
+                  "Unexpected end of ArrayFire binary header",
+                  filepath);
+    }
+
+    return ret;
+}
+
+std::vector<ArrayFireBinaryEntry> getArrayFireBinaryEntries(const std::string& filepath)
+{
+    std::ifstream file(filepath, std::ios::in | std::ios::binary);
+    if(!file)
+    {
+        throw Pothos::FileNotFoundException(filepath);
+    }
+
+    const auto version = readValue<char>(file, filepath);
+    if(ArrayFireBinaryVersion != version)
+    {
+        throw Pothos::DataFormatException(
+                  "Unsupported ArrayFire binary version",
+                  Poco::NumberFormatter::format(int(version)));
+    }
+
+    const auto numArrays = readValue<int>(file, filepath);
+    if(numArrays < 0)
+    {
+        throw Pothos::DataFormatException(
+                  "Invalid ArrayFire binary array count",
+                  filepath);
+    }
+
+    std::vector<ArrayFireBinaryEntry> entries;
+    for(int arrIndex = 0; arrIndex < numArrays; ++arrIndex)
+    {
+        ArrayFireBinaryEntry entry;
+        entry.entryOffset = file.tellg();
+
+        const auto keyLength = readValue<int>(file, filepath);
+        if(keyLength < 0)
+        {
+            throw Pothos::DataFormatException(
+                      "Invalid ArrayFire binary key length",
+                      filepath);
+        }
+
+        entry.key.resize(static_cast<size_t>(keyLength));
+        file.read(&entry.key[0], keyLength);
+
+        const auto nextEntryBytes = readValue<dim_t>(file, filepath);
+        const auto arrayOffset = file.tellg();
+
+        entry.afDType = static_cast<af::dtype>(readValue<char>(file, filepath));
+        for(auto& dim: entry.dims) dim = readValue<dim_t>(file, filepath);
+        entry.dataOffset = file.tellg();
+
+        const bool isValid = std::all_of(entry.dims.begin(), entry.dims.end(), [](dim_t dim){return (dim >= 0);}) &&
+                             (nextEntryBytes == static_cast<dim_t>(entry.dataOffset - arrayOffset + entry.bytes()));
+        if(!isValid)
+        {
+            throw Pothos::DataFormatException(
+                      Poco::format(
+                          "Invalid header for array \"%s\" in ArrayFire binary",
+                          entry.key),
+                      filepath);
+        }
+
+        file.seekg(arrayOffset + static_cast<std::streamoff>(nextEntryBytes));
+        entries.emplace_back(std::move(entry));
+    }
+
+    return entries;
+}
+
+ArrayFireBinaryEntry findArrayFireBinaryEntry(
+    const std::string& filepath,
+    const std::string& key)
+{
+    const auto entries = getArrayFireBinaryEntries(filepath);
+
+    auto entryIter = std::find_if(
+                         entries.begin(),
+                         entries.end(),
+                         [&key](const ArrayFireBinaryEntry& entry)
+                         {
+                             return (entry.key == key);
+                         });
+    if(entries.end() == entryIter)
+    {
+        throw Pothos::InvalidArgumentException(
+                  "Could not find key in ArrayFire binary",
+                  key);
+    }
+
+    return *entryIter;
+}
+
+//
+// ArrayFireBinaryReader
+//
+
+ArrayFireBinaryReader::ArrayFireBinaryReader(
+    const std::string& filepath,
+    const std::string& key
+):
+    _filepath(filepath),
+    _entry(findArrayFireBinaryEntry(filepath, key)),
+    _file(filepath, std::ios::in | std::ios::binary),
+    _nchans(0),
+    _elemSize(_entry.dtype().size()),
+    _numSamples(0)
+{
+    if(!_file)
+    {
+        throw Pothos::FileException(
+                  "Failed to open ArrayFire binary",
+                  _filepath);
+    }
+
+    const auto numDims = _entry.numDims();
+    if(1 == numDims)
+    {
+        _nchans = 1;
+        _numSamples = static_cast<size_t>(_entry.dims[0]);
+    }
+    else if(2 == numDims)
+    {
+        _nchans = static_cast<size_t>(_entry.dims[0]);
+        _numSamples = static_cast<size_t>(_entry.dims[1]);
+    }
+    else
+    {
+        throw Pothos::DataFormatException(
+                  "Only arrays of 1-2 dimensions are supported.");
+    }
+}
+
+size_t ArrayFireBinaryReader::numChannels() const
+{
+    return _nchans;
+}
+
+Pothos::DType ArrayFireBinaryReader::dtype(size_t) const
+{
+    return _entry.dtype();
+}
+
+size_t ArrayFireBinaryReader::numSamples() const
+{
+    return _numSamples;
+}
+
+// Samples for all channels are interleaved on disk, so reads are measured
+// in full columns.
+size_t ArrayFireBinaryReader::preferredReadSamples(size_t maxBytes) const
+{
+    return std::max<size_t>(1, (maxBytes / (_nchans * _elemSize)));
+}
+
+void ArrayFireBinaryReader::read(
+    size_t startSample,
+    size_t numSamples,
+    const std::vector<void*>& channels)
+{
+    const size_t columnSize = _nchans * _elemSize;
+
+    // A single channel is contiguous on disk, so it can be read straight
+    // into the caller's buffer.
+    std::vector<char> columns;
+    char* dst = reinterpret_cast<char*>(channels[0]);
+    if(_nchans > 1)
+    {
+        columns.resize(numSamples * columnSize);
+        dst = columns.data();
+    }
+
+    _file.seekg(_entry.dataOffset + static_cast<std::streamoff>(startSample * columnSize));
+    _file.read(dst, static_cast<std::streamsize>(numSamples * columnSize));
+    if(!_file)
+    {
+        throw Pothos::ReadFileException(
+                  Poco::format(
+                      "Failed to read %s samples at offset %s",
+                      Poco::NumberFormatter::format(numSamples),
+                      Poco::NumberFormatter::format(startSample)),
+                  _filepath);
+    }
+
+    if(_nchans > 1)
+    {
+        for(size_t chan = 0; chan < _nchans; ++chan)
+        {
+            auto* out = reinterpret_cast<char*>(channels[chan]);
+            for(size_t sample = 0; sample < numSamples; ++sample)
+            {
+                std::memcpy(
+                    out + (sample * _elemSize),
+                    columns.data() + (sample * columnSize) + (chan * _elemSize),
+                    _elemSize);
+            }
+        }
+    }
+}
+
+//
+// ArrayFireBinaryWriter
+//
+
+template <typename T>
+static void writeValue(
+    std::fstream& file,
+    const T& value)
+{
+    file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+ArrayFireBinaryWriter::ArrayFireBinaryWriter(
+    const std::string& filepath,
+    const std::string& key,
+    af::dtype afDType,
+    size_t numChannels,
+    bool append,
+    size_t maxQueuedWrites
+):
+    _file(),
+    _filepath(filepath),
+    _nchans(numChannels),
+    _columnSize(numChannels * Pothos::Object(afDType).convert<Pothos::DType>().size()),
+    _maxQueuedWrites(std::max<size_t>(1, maxQueuedWrites)),
+    _nextEntryBytesOffset(0),
+    _dimsOffset(0),
+    _samplesWritten(0),
+    _mutex(),
+    _cond(),
+    _queue(),
+    _closing(false),
+    _error(),
+    _thread()
+{
+    int numArrays = 0;
+    if(append)
+    {
+        // Throws if the file exists but isn't an ArrayFire binary.
+        std::ifstream existingFile(_filepath, std::ios::in | std::ios::binary);
+        if(existingFile && (existingFile.peek() != std::ifstream::traits_type::eof()))
+        {
+            existingFile.close();
+
+            const auto entries = getArrayFireBinaryEntries(_filepath);
+            numArrays = static_cast<int>(entries.size());
+
+            // An interrupted write can leave data past the last complete
+            // entry, which would corrupt the new entry.
+            if(!entries.empty())
+            {
+                const auto& lastEntry = entries.back();
+                Poco::File(_filepath).setSize(static_cast<Poco::File::FileSize>(
+                    lastEntry.dataOffset + static_cast<std::streamoff>(lastEntry.bytes())));
+            }
+        }
+    }
+
+    const auto openMode = std::ios::in | std::ios::out | std::ios::binary;
+    if(numArrays > 0) _file.open(_filepath, openMode);
+    else              _file.open(_filepath, openMode | std::ios::trunc);
+    if(!_file)
+    {
+        throw Pothos::FileException(
+                  "Failed to open ArrayFire binary for writing",
+                  _filepath);
+    }
+
+    _file.seekp(0);
+    writeValue(_file, ArrayFireBinaryVersion);
+    writeValue(_file, numArrays+1);
+
+    _file.seekp(0, std::ios::end);
+    writeValue(_file, static_cast<int>(key.size()));
+    _file.write(key.data(), static_cast<std::streamsize>(key.size()));
+
+    _nextEntryBytesOffset = _file.tellp();
+    writeValue(_file, dim_t(0));
+    writeValue(_file, static_cast<char>(afDType));
+
+    _dimsOffset = _file.tellp();
+    for(size_t dim = 0; dim < 4; ++dim) writeValue(_file, dim_t(0));
+
+    this->_patchHeader();
+    if(!_file)
+    {
+        throw Pothos::WriteFileException(
+                  "Failed to write ArrayFire binary header",
+                  _filepath);
+    }
+
+    _thread = std::thread(&ArrayFireBinaryWriter::_writerLoop, this);
+}
+
+ArrayFireBinaryWriter::~ArrayFireBinaryWriter()
+{
+    try {this->close();}
+    catch(...) {}
+}
+
+void ArrayFireBinaryWriter::write(std::vector<char>&& columns)
+{
+    if(columns.empty()) return;
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    this->_rethrowError();
+
+    if(_closing)
+    {
+        throw Pothos::AssertionViolationException(
+                  "Attempted to write to a closed ArrayFire binary",
+                  _filepath);
+    }
+    if(0 != (columns.size() % _columnSize))
+    {
+        throw Pothos::AssertionViolationException(
+                  "ArrayFireBinaryWriter::write() expects whole columns",
+                  Poco::format(
+                      "%s bytes, column size %s",
+                      Poco::NumberFormatter::format(columns.size()),
+                      Poco::NumberFormatter::format(_columnSize)));
+    }
+
+    _cond.wait(lock, [this](){return (_queue.size() < _maxQueuedWrites) || _error;});
+    this->_rethrowError();
+
+    _queue.emplace_back(std::move(columns));
+    _cond.notify_all();
+}
+
+void ArrayFireBinaryWriter::close()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _closing = true;
+        _cond.notify_all();
+    }
+    if(_thread.joinable()) _thread.join();
+    if(_file.is_open()) _file.close();
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    this->_rethrowError();
+}
+
+size_t ArrayFireBinaryWriter::samplesWritten() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _samplesWritten;
+}
+
+void ArrayFireBinaryWriter::_writerLoop()
+{
+    while(true)
+    {
+        std::vector<char> columns;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _cond.wait(lock, [this](){return !_queue.empty() || _closing;});
+            if(_queue.empty()) return; // Closing, nothing left to write
+
+            columns = std::move(_queue.front());
+            _queue.pop_front();
+            _cond.notify_all();
+        }
+
+        try
+        {
+            _file.seekp(0, std::ios::end);
+            _file.write(columns.data(), static_cast<std::streamsize>(columns.size()));
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _samplesWritten += (columns.size() / _columnSize);
+            }
+            this->_patchHeader();
+
+            if(!_file)
+            {
+                throw Pothos::WriteFileException(
+                          "Failed to write to ArrayFire binary",
+                          _filepath);
+            }
+        }
+        catch(...)
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _error = std::current_exception();
+            _queue.clear();
+            _cond.notify_all();
+            return;
+        }
+    }
+}
+
+// Match what af::saveArray writes for an array of this shape.
+void ArrayFireBinaryWriter::_patchHeader()
+{
+    const auto numSamples = static_cast<dim_t>(_samplesWritten);
+    const auto dataBytes = static_cast<dim_t>(_samplesWritten * _columnSize);
+
+    std::array<dim_t, 4> dims = {numSamples, 1, 1, 1};
+    if(_nchans > 1)
+    {
+        dims[0] = static_cast<dim_t>(_nchans);
+        dims[1] = numSamples;
+    }
+
+    _file.seekp(_nextEntryBytesOffset);
+    writeValue(_file, static_cast<dim_t>(sizeof(char) + sizeof(dims)) + dataBytes);
+
+    _file.seekp(_dimsOffset);
+    for(const auto& dim: dims) writeValue(_file, dim);
+
+    _file.flush();
+}
+
+// Assumes _mutex is locked
+void ArrayFireBinaryWriter::_rethrowError()
+{
+    if(_error)
+    {
+        auto error = _error;
+        _error = nullptr;
+        std::rethrow_exception(error);
+    }
+}
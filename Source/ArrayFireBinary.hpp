@@ -0,0 +1,156 @@
+// Copyright (c) 2021 Nicholas Corgan
+// SPDX-License-Identifier: BSD-3-Clause
+
+#pragma once
+
+#include "StreamFileReader.hpp"
+
+#include <Pothos/Framework.hpp>
+
+#include <arrayfire.h>
+
+#include <array>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <ios>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+//
+// Direct access to arrays stored with af::saveArray, without loading the
+// whole array into memory.
+//
+// Layout (all values native-endian):
+//
+// (char   ) Version (once)
+// (int    ) Number of arrays (once)
+// For each array:
+//     (int    ) Key length
+//     (char[] ) Key
+//     (intl   ) Number of bytes until the next entry
+//     (char   ) af::dtype
+//     (intl[4]) Dimensions
+//     (T[]    ) Column-major data
+//
+
+struct ArrayFireBinaryEntry
+{
+    std::string key;
+    af::dtype afDType;
+    std::array<dim_t, 4> dims;
+
+    // Absolute file offsets
+    std::streamoff entryOffset;
+    std::streamoff dataOffset;
+
+    Pothos::DType dtype() const;
+
+    size_t numDims() const;
+
+    size_t elements() const;
+
+    size_t bytes() const;
+};
+
+std::vector<ArrayFireBinaryEntry> getArrayFireBinaryEntries(const std::string& filepath);
+
+// Throws Pothos::InvalidArgumentException if the key is not present. As with
+// af::readArray, the first entry with a matching key is returned.
+ArrayFireBinaryEntry findArrayFireBinaryEntry(
+    const std::string& filepath,
+    const std::string& key);
+
+//
+// Streams a 1D or 2D array, reading only the columns requested. The rows of a
+// 2D array are read as separate channels.
+//
+class ArrayFireBinaryReader: public StreamFileReader
+{
+    public:
+        ArrayFireBinaryReader(
+            const std::string& filepath,
+            const std::string& key);
+
+        virtual ~ArrayFireBinaryReader() = default;
+
+        size_t numChannels() const override;
+
+        Pothos::DType dtype(size_t chan) const override;
+
+        size_t numSamples() const override;
+
+        size_t preferredReadSamples(size_t maxBytes) const override;
+
+        void read(
+            size_t startSample,
+            size_t numSamples,
+            const std::vector<void*>& channels) override;
+
+    private:
+        std::string _filepath;
+        ArrayFireBinaryEntry _entry;
+        std::ifstream _file;
+
+        size_t _nchans;
+        size_t _elemSize;
+        size_t _numSamples;
+};
+
+//
+// Writes a single array incrementally. Column data passed into write() is
+// written on a background thread, and the entry header is patched after
+// every write, so the file is a valid ArrayFire binary containing everything
+// written so far at all times.
+//
+class ArrayFireBinaryWriter
+{
+    public:
+        ArrayFireBinaryWriter(
+            const std::string& filepath,
+            const std::string& key,
+            af::dtype afDType,
+            size_t numChannels,
+            bool append,
+            size_t maxQueuedWrites);
+
+        // Calls close().
+        virtual ~ArrayFireBinaryWriter();
+
+        // Expects whole columns, i.e. numChannels interleaved elements per
+        // sample. Blocks if maxQueuedWrites writes are already queued.
+        void write(std::vector<char>&& columns);
+
+        // Writes everything queued and stops the background thread. Any
+        // exception thrown by the background thread is rethrown here.
+        void close();
+
+        size_t samplesWritten() const;
+
+    private:
+        std::fstream _file;
+        std::string _filepath;
+        size_t _nchans;
+        size_t _columnSize;
+        size_t _maxQueuedWrites;
+
+        std::streamoff _nextEntryBytesOffset;
+        std::streamoff _dimsOffset;
+        size_t _samplesWritten;
+
+        mutable std::mutex _mutex;
+        std::condition_variable _cond;
+        std::deque<std::vector<char>> _queue;
+        bool _closing;
+        std::exception_ptr _error;
+        std::thread _thread;
+
+        void _writerLoop();
+
+        void _patchHeader();
+
+        void _rethrowError();
+};
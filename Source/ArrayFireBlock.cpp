@@ -4,6 +4,10 @@
 #include "ArrayFireBlock.hpp"
 #include "BufferConversions.hpp"
 #include "DeviceCache.hpp"
+#include "DevicePlacement.hpp"
+#include "DeviceThreads.hpp"
+#include "EnumConversions.hpp"
+#include "MemoryManager.hpp"
 #include "SharedBufferAllocator.hpp"
 #include "Utility.hpp"
 
@@ -19,7 +23,13 @@
 #include <arrayfire.h>
 
 #include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 
 #ifdef POTHOSGPU_LEGACY_BUFFER_MANAGER
 Pothos::BufferManager::Sptr makePinnedBufferManager(af::Backend backend);
@@ -47,9 +57,193 @@ static void checkVersion()
     }
 }
 
+// Sizes to time when measuring the crossover size, in ascending order
+static const std::vector<size_t> CrossoverSizes =
+{
+    1 << 8,
+    1 << 10,
+    1 << 12,
+    1 << 14,
+    1 << 16,
+    1 << 18,
+    1 << 20
+};
+
+static constexpr size_t CrossoverRuns = 3;
+
+static bool canUseHostBackend(af::Backend backend)
+{
+    if(::AF_BACKEND_CPU == backend) return false;
+
+    const auto& availableBackends = getAvailableBackends();
+    return (availableBackends.end() != std::find(
+                                           availableBackends.begin(),
+                                           availableBackends.end(),
+                                           ::AF_BACKEND_CPU));
+}
+
+// Returns the fastest time of a full upload, compute, and download on the
+// current backend.
+static double timeRoundTrip(
+    const std::vector<af::dtype>& inputTypes,
+    const AfArrayFunc& func,
+    size_t numElements)
+{
+    // Use ones as inputs, since they're valid for every block's domain.
+    std::vector<std::vector<unsigned char>> hostInputs;
+    for(const auto& inputType: inputTypes)
+    {
+        const auto afInput = af::constant(1, static_cast<dim_t>(numElements), inputType);
+        hostInputs.emplace_back(afInput.bytes());
+        afInput.host(hostInputs.back().data());
+    }
+
+    double fastest = 0.0;
+
+    // The first run is a warmup, to avoid counting JIT compilation.
+    for(size_t run = 0; run <= CrossoverRuns; ++run)
+    {
+        const auto start = BlockStats::Clock::now();
+
+        std::vector<af::array> afInputs;
+        for(size_t input = 0; input < inputTypes.size(); ++input)
+        {
+            afInputs.emplace_back(static_cast<dim_t>(numElements), inputTypes[input]);
+            afInputs.back().write(
+                hostInputs[input].data(),
+                hostInputs[input].size(),
+                ::afHost);
+        }
+
+        auto afOutput = func(afInputs);
+        afOutput.eval();
+
+        std::vector<unsigned char> hostOutput(afOutput.bytes());
+        afOutput.host(hostOutput.data());
+        af::sync();
+
+        const auto seconds = std::chrono::duration<double>(BlockStats::Clock::now() - start).count();
+        if((run > 0) && ((run == 1) || (seconds < fastest))) fastest = seconds;
+    }
+
+    return fastest;
+}
+
+static constexpr size_t DefaultMaxLatencyUs = 1000;
+
+// How often to check for freed memory while a device is near its budget
+static constexpr std::chrono::nanoseconds MemoryPollInterval(50000);
+
+// How often to release cached memory while a device is near its budget
+static constexpr std::chrono::milliseconds MemoryGCInterval(10);
+
+// Roughly a second of polling, after which a waiting block logs a warning
+static constexpr size_t MaxMemoryDeferrals = 20000;
+
+// The scheduler doesn't call work() again until the reserve is met, so
+// while a partial batch waits, this calls yield() at the deadline to have
+// work() called regardless. The thread only exists for blocks that have
+// waited for a batch, and stops when the block is deactivated.
+class ArrayFireBlock::BatchTimer
+{
+    public:
+        explicit BatchTimer(ArrayFireBlock* block):
+            _block(block),
+            _mutex(),
+            _cond(),
+            _armed(false),
+            _stopping(false),
+            _deadline(),
+            _thread()
+        {
+            _thread = std::thread(&BatchTimer::_timerLoop, this);
+        }
+
+        ~BatchTimer()
+        {
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _stopping = true;
+            }
+            _cond.notify_all();
+            _thread.join();
+        }
+
+        void arm(BlockStats::Clock::time_point deadline)
+        {
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _armed = true;
+                _deadline = deadline;
+            }
+            _cond.notify_all();
+        }
+
+        void disarm()
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _armed = false;
+        }
+
+    private:
+        ArrayFireBlock* _block;
+
+        std::mutex _mutex;
+        std::condition_variable _cond;
+        bool _armed;
+        bool _stopping;
+        BlockStats::Clock::time_point _deadline;
+        std::thread _thread;
+
+        void _timerLoop()
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            while(!_stopping)
+            {
+                if(!_armed)
+                {
+                    _cond.wait(lock);
+                }
+                else if(BlockStats::Clock::now() >= _deadline)
+                {
+                    _armed = false;
+                    _block->yield();
+                }
+                else
+                {
+                    _cond.wait_until(lock, _deadline);
+                }
+            }
+        }
+};
+
 ArrayFireBlock::ArrayFireBlock(const std::string& device):
     Pothos::Block(),
-    _afDeviceName(device)
+    _afDeviceName(device),
+    _autoOffload(false),
+    _crossoverKnown(false),
+    _crossoverElements(0),
+    _onHostBackend(false),
+    _minBatchElements(0),
+    _batchReserveElements(0),
+    _maxLatencyUs(DefaultMaxLatencyUs),
+    _batchPending(false),
+    _batchDeadline(),
+    _batchTimer(),
+    _memoryDeferrals(0),
+    _lastMemoryGCTime(),
+    _failover(false),
+    _failoverRetryMs(0),
+    _deviceFaults(0),
+    _injectedFaults(0),
+    _failedOver(false),
+    _failoverTime(),
+    _originalBackend(::AF_BACKEND_DEFAULT),
+    _originalDevice(0),
+    _originalDeviceName(),
+    _trackConsumedPorts(false),
+    _consumedPorts(),
+    _afInputDTypes()
 {
     checkVersion();
 
@@ -59,43 +253,48 @@ ArrayFireBlock::ArrayFireBlock(const std::string& device):
         throw Pothos::RuntimeException("No ArrayFire devices found. Check your ArrayFire installation.");
     }
 
-    if(device == "Auto")
+    if(isAutoDevice(device))
     {
-        _afBackend = deviceCache[0].afBackendEnum;
-        _afDevice = deviceCache[0].afDeviceIndex;
-        _afDeviceName = deviceCache[0].name;
+        auto placement = placeAutoDevice(device);
+
+        _afBackend = placement.entry->afBackendEnum;
+        _afDevice = placement.entry->afDeviceIndex;
+        _afDeviceName = placement.entry->name;
+        _devicePlacement = placement.description;
+        _devicePlacementToken = std::move(placement.token);
     }
     else
     {
-        auto deviceCacheIter = std::find_if(
-                                   deviceCache.begin(),
-                                   deviceCache.end(),
-                                   [&device](const DeviceCacheEntry& entry)
-                                   {
-                                       return (entry.name == device) ||
-                                              (Poco::format("%s:%d", entry.platform, entry.afDeviceIndex) == device);
-                                   });
-        if(deviceCache.end() != deviceCacheIter)
-        {
-            _afBackend = deviceCacheIter->afBackendEnum;
-            _afDevice = deviceCacheIter->afDeviceIndex;
-            _afDeviceName = deviceCacheIter->name;
-        }
-        else
-        {
-            throw Pothos::InvalidArgumentException(
-                      Poco::format(
-                          "Could not find ArrayFire device %s.",
-                          device));
-        }
+        const auto& entry = getDeviceCacheEntry(device);
+
+        _afBackend = entry.afBackendEnum;
+        _afDevice = entry.afDeviceIndex;
+        _afDeviceName = entry.name;
+        _devicePlacement = "Manual";
     }
 
     _domain = "ArrayFire_" + this->backend();
+    _stats = BlockStats::make(_afBackend, _afDevice, _afDeviceName);
 
     this->configArrayFire();
+
+    if(deviceThreadsPerPool() > 0)
+    {
+        this->setThreadPool(getDeviceThreadPool(_afBackend, _afDevice));
+    }
+
     this->registerCall(this, POTHOS_FCN_TUPLE(ArrayFireBlock, backend));
     this->registerCall(this, POTHOS_FCN_TUPLE(ArrayFireBlock, device));
+    this->registerCall(this, POTHOS_FCN_TUPLE(ArrayFireBlock, devicePlacement));
     this->registerCall(this, POTHOS_FCN_TUPLE(ArrayFireBlock, overlay));
+    this->registerCall(this, POTHOS_FCN_TUPLE(ArrayFireBlock, stats));
+    this->registerCall(this, POTHOS_FCN_TUPLE(ArrayFireBlock, statsEnabled));
+    this->registerCall(this, POTHOS_FCN_TUPLE(ArrayFireBlock, setStatsEnabled));
+    this->registerCall(this, POTHOS_FCN_TUPLE(ArrayFireBlock, resetStats));
+    this->registerCall(this, POTHOS_FCN_TUPLE(ArrayFireBlock, memoryStats));
+    this->registerProbe("stats");
+    this->registerProbe("memoryStats");
+    this->registerProbe("device");
 }
 
 ArrayFireBlock::~ArrayFireBlock()
@@ -142,6 +341,20 @@ Pothos::BufferManager::Sptr ArrayFireBlock::getOutputBufferManager(
 void ArrayFireBlock::activate()
 {
     this->configArrayFire();
+
+    // The block's name isn't known at construction.
+    _stats->setName(this->getName());
+
+    if(_autoOffload && !_crossoverKnown && canUseHostBackend(_afBackend))
+    {
+        this->setCrossoverElements(this->measureCrossoverElements());
+    }
+}
+
+void ArrayFireBlock::deactivate()
+{
+    this->_endBatchWait();
+    _batchTimer.reset();
 }
 
 std::string ArrayFireBlock::backend() const
@@ -154,6 +367,11 @@ std::string ArrayFireBlock::device() const
     return _afDeviceName;
 }
 
+std::string ArrayFireBlock::devicePlacement() const
+{
+    return _devicePlacement;
+}
+
 std::string ArrayFireBlock::overlay() const
 {
     nlohmann::json topObj;
@@ -162,7 +380,8 @@ std::string ArrayFireBlock::overlay() const
     nlohmann::json deviceParam;
     deviceParam["key"] = "device";
     deviceParam["widgetType"] = "ComboBox";
-    deviceParam["widgetKwargs"]["editable"] = false;
+    // Editable, to allow for "Auto:<group>"
+    deviceParam["widgetKwargs"]["editable"] = true;
 
     auto& deviceParamOpts = deviceParam["options"];
 
@@ -186,6 +405,423 @@ std::string ArrayFireBlock::overlay() const
     return topObj.dump();
 }
 
+//
+// Stats
+//
+
+std::string ArrayFireBlock::stats() const
+{
+    return _stats->toJSON().dump();
+}
+
+bool ArrayFireBlock::statsEnabled() const
+{
+    return _stats->enabled();
+}
+
+void ArrayFireBlock::setStatsEnabled(bool enabled)
+{
+    _stats->setEnabled(enabled);
+}
+
+void ArrayFireBlock::resetStats()
+{
+    _stats->reset();
+}
+
+std::string ArrayFireBlock::memoryStats() const
+{
+    return memoryStatsToJSON(_afBackend, _afDevice).dump();
+}
+
+BlockStats::ScopedTimer ArrayFireBlock::timeStage(BlockStage stage)
+{
+    return _stats->timeStage(stage);
+}
+
+//
+// Auto offload
+//
+
+void ArrayFireBlock::enableAutoOffload()
+{
+    this->registerCall(this, POTHOS_FCN_TUPLE(ArrayFireBlock, autoOffload));
+    this->registerCall(this, POTHOS_FCN_TUPLE(ArrayFireBlock, setAutoOffload));
+    this->registerCall(this, POTHOS_FCN_TUPLE(ArrayFireBlock, crossoverElements));
+    this->registerCall(this, POTHOS_FCN_TUPLE(ArrayFireBlock, setCrossoverElements));
+    this->registerProbe("crossoverElements");
+}
+
+bool ArrayFireBlock::autoOffload() const
+{
+    return _autoOffload;
+}
+
+void ArrayFireBlock::setAutoOffload(bool autoOffload)
+{
+    _autoOffload = autoOffload;
+
+    if(_autoOffload && !_crossoverKnown && this->isActive() && canUseHostBackend(_afBackend))
+    {
+        this->setCrossoverElements(this->measureCrossoverElements());
+    }
+}
+
+size_t ArrayFireBlock::crossoverElements() const
+{
+    return _crossoverElements;
+}
+
+void ArrayFireBlock::setCrossoverElements(size_t crossoverElements)
+{
+    _crossoverElements = crossoverElements;
+    _crossoverKnown = true;
+}
+
+size_t ArrayFireBlock::measureCrossoverElements()
+{
+    return 0;
+}
+
+size_t ArrayFireBlock::timeCrossoverElements(
+    const std::vector<af::dtype>& inputTypes,
+    const AfArrayFunc& func)
+{
+    for(const auto size: CrossoverSizes)
+    {
+        double hostTime = 0.0;
+        {
+            ScopedHostBackend hostBackend(this);
+            hostTime = timeRoundTrip(inputTypes, func, size);
+        }
+
+        this->configArrayFire();
+        const double deviceTime = timeRoundTrip(inputTypes, func, size);
+
+        if(deviceTime <= hostTime) return size;
+    }
+
+    // The host was faster for every size, so use the host for anything
+    // smaller than the largest size we know about.
+    return CrossoverSizes.back();
+}
+
+ArrayFireBlock::ScopedHostBackend::ScopedHostBackend(ArrayFireBlock* block):
+    _block(block)
+{
+    if(_block)
+    {
+        setThreadBackend(::AF_BACKEND_CPU);
+        _block->_onHostBackend = true;
+    }
+}
+
+ArrayFireBlock::ScopedHostBackend::ScopedHostBackend(ScopedHostBackend&& other):
+    _block(other._block)
+{
+    other._block = nullptr;
+}
+
+ArrayFireBlock::ScopedHostBackend::~ScopedHostBackend()
+{
+    if(_block)
+    {
+        _block->_onHostBackend = false;
+        _block->configArrayFire();
+    }
+}
+
+ArrayFireBlock::ScopedHostBackend ArrayFireBlock::hostBackendIfSmall(size_t elems)
+{
+    const bool useHost = _autoOffload &&
+                         _crossoverKnown &&
+                         (elems < _crossoverElements) &&
+                         canUseHostBackend(_afBackend);
+
+    return ScopedHostBackend(useHost ? this : nullptr);
+}
+
+//
+// Batching
+//
+
+void ArrayFireBlock::enableBatching()
+{
+    this->registerCall(this, POTHOS_FCN_TUPLE(ArrayFireBlock, minBatchElements));
+    this->registerCall(this, POTHOS_FCN_TUPLE(ArrayFireBlock, setMinBatchElements));
+    this->registerCall(this, POTHOS_FCN_TUPLE(ArrayFireBlock, maxLatencyUs));
+    this->registerCall(this, POTHOS_FCN_TUPLE(ArrayFireBlock, setMaxLatencyUs));
+    this->registerProbe("minBatchElements");
+    this->registerProbe("maxLatencyUs");
+}
+
+size_t ArrayFireBlock::minBatchElements() const
+{
+    return _minBatchElements;
+}
+
+void ArrayFireBlock::setMinBatchElements(size_t minBatchElements)
+{
+    _minBatchElements = minBatchElements;
+
+    // An upstream block stops producing once its buffers are full, so the
+    // batch is capped at what a default buffer pool holds, and a batch that
+    // size is processed as is. Smaller upstream pools are flushed by the
+    // deadline.
+    const Pothos::BufferManagerArgs bufferArgs;
+    const size_t poolBytes = bufferArgs.numBuffers * bufferArgs.bufferSize;
+
+    _batchReserveElements = _minBatchElements;
+    for(auto* input: this->inputs())
+    {
+        _batchReserveElements = std::min(_batchReserveElements, poolBytes / input->dtype().size());
+    }
+
+    this->_endBatchWait();
+}
+
+size_t ArrayFireBlock::maxLatencyUs() const
+{
+    return _maxLatencyUs;
+}
+
+void ArrayFireBlock::setMaxLatencyUs(size_t maxLatencyUs)
+{
+    _maxLatencyUs = maxLatencyUs;
+}
+
+bool ArrayFireBlock::deferForBatch(size_t elems)
+{
+    if(elems >= _batchReserveElements)
+    {
+        this->_endBatchWait();
+        return false;
+    }
+
+    const auto now = BlockStats::Clock::now();
+    if(!_batchPending)
+    {
+        _batchDeadline = now + std::chrono::microseconds(_maxLatencyUs);
+        if(now >= _batchDeadline) return false;
+
+        // Don't sleep or yield here. The reserve holds off work() until
+        // the rest of the batch has arrived, accumulated into a single
+        // contiguous buffer, and the timer wakes the block at the deadline.
+        _batchPending = true;
+        for(auto* input: this->inputs()) input->setReserve(_batchReserveElements);
+
+        if(!_batchTimer) _batchTimer.reset(new BatchTimer(this));
+        _batchTimer->arm(_batchDeadline);
+    }
+    if(now >= _batchDeadline)
+    {
+        this->_endBatchWait();
+        return false;
+    }
+
+    return true;
+}
+
+void ArrayFireBlock::_endBatchWait()
+{
+    if(!_batchPending) return;
+
+    _batchPending = false;
+    if(_batchTimer) _batchTimer->disarm();
+
+    // Have the next data wake the block, so its deadline starts on arrival.
+    for(auto* input: this->inputs()) input->setReserve(1);
+}
+
+bool ArrayFireBlock::deferForMemory()
+{
+    this->configArrayFire();
+    if(!memoryUnderPressure(_afBackend, _afDevice))
+    {
+        _memoryDeferrals = 0;
+        return false;
+    }
+
+    // Releasing the cache and garbage collecting are device-wide and
+    // expensive, so only do it every so often while waiting.
+    const auto now = BlockStats::Clock::now();
+    if((now - _lastMemoryGCTime) >= MemoryGCInterval)
+    {
+        _lastMemoryGCTime = now;
+
+        releaseMemoryCache(_afBackend, _afDevice);
+        af::deviceGC();
+        if(!memoryUnderPressure(_afBackend, _afDevice))
+        {
+            _memoryDeferrals = 0;
+            return false;
+        }
+    }
+
+    if(MaxMemoryDeferrals == ++_memoryDeferrals)
+    {
+        poco_warning_f2(
+            Poco::Logger::get(this->getName()),
+            "%s has been waiting for memory on %s for over a second. Check the device's memory budget.",
+            this->getName(),
+            _afDeviceName);
+    }
+
+    // Downstream blocks free memory as they consume their inputs.
+    const auto maxTimeout = std::chrono::nanoseconds(this->workInfo().maxTimeoutNs);
+    std::this_thread::sleep_for(std::min(maxTimeout, MemoryPollInterval));
+    this->yield();
+
+    return true;
+}
+
+//
+// Failover
+//
+
+static bool isDeviceFault(const af::exception& ex)
+{
+    switch(ex.err())
+    {
+        case ::AF_ERR_NO_MEM:
+        case ::AF_ERR_DRIVER:
+        case ::AF_ERR_RUNTIME:
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+void ArrayFireBlock::enableFailover()
+{
+    this->registerCall(this, POTHOS_FCN_TUPLE(ArrayFireBlock, failover));
+    this->registerCall(this, POTHOS_FCN_TUPLE(ArrayFireBlock, setFailover));
+    this->registerCall(this, POTHOS_FCN_TUPLE(ArrayFireBlock, failoverRetryMs));
+    this->registerCall(this, POTHOS_FCN_TUPLE(ArrayFireBlock, setFailoverRetryMs));
+    this->registerCall(this, POTHOS_FCN_TUPLE(ArrayFireBlock, deviceFaults));
+    this->registerCall(this, POTHOS_FCN_TUPLE(ArrayFireBlock, injectDeviceFault));
+    this->registerProbe("deviceFaults");
+}
+
+bool ArrayFireBlock::failover() const
+{
+    return _failover;
+}
+
+void ArrayFireBlock::setFailover(bool failover)
+{
+    _failover = failover;
+}
+
+size_t ArrayFireBlock::failoverRetryMs() const
+{
+    return _failoverRetryMs;
+}
+
+void ArrayFireBlock::setFailoverRetryMs(size_t failoverRetryMs)
+{
+    _failoverRetryMs = failoverRetryMs;
+}
+
+size_t ArrayFireBlock::deviceFaults() const
+{
+    return _deviceFaults;
+}
+
+void ArrayFireBlock::injectDeviceFault()
+{
+    ++_injectedFaults;
+}
+
+void ArrayFireBlock::runWithFailover(const std::function<void()>& func)
+{
+    if(_failover) this->_restoreDeviceIfRetryDue();
+
+    // Make sure tracking stops however this returns.
+    struct ConsumedPortTracker
+    {
+        explicit ConsumedPortTracker(ArrayFireBlock* block): block(block)
+        {
+            block->_consumedPorts.clear();
+            block->_trackConsumedPorts = true;
+        }
+
+        ~ConsumedPortTracker()
+        {
+            block->_trackConsumedPorts = false;
+        }
+
+        ArrayFireBlock* block;
+    };
+    ConsumedPortTracker tracker(this);
+
+    try
+    {
+        func();
+    }
+    catch(const af::exception& ex)
+    {
+        if(!_failover || !isDeviceFault(ex) || !this->_failOverToHost(ex)) throw;
+
+        func();
+    }
+}
+
+bool ArrayFireBlock::_failOverToHost(const af::exception& ex)
+{
+    const auto hostDevice = getCPUOrBestDevice();
+    if(isAutoDevice(hostDevice)) return false;
+
+    const auto& entry = getDeviceCacheEntry(hostDevice);
+
+    ++_deviceFaults;
+    poco_warning_f3(
+        Poco::Logger::get(this->getName()),
+        "Device %s faulted (%s). Failing over to %s.",
+        _afDeviceName,
+        std::string(ex.what()),
+        entry.name);
+
+    if(!_failedOver)
+    {
+        _originalBackend = _afBackend;
+        _originalDevice = _afDevice;
+        _originalDeviceName = _afDeviceName;
+    }
+
+    _afBackend = entry.afBackendEnum;
+    _afDevice = entry.afDeviceIndex;
+    _afDeviceName = entry.name;
+    _failedOver = true;
+    _failoverTime = BlockStats::Clock::now();
+    _stats->setDevice(_afBackend, _afDevice, _afDeviceName);
+
+    this->configArrayFire();
+
+    return true;
+}
+
+void ArrayFireBlock::_restoreDeviceIfRetryDue()
+{
+    if(!_failedOver || (0 == _failoverRetryMs)) return;
+
+    if(BlockStats::Clock::now() < (_failoverTime + std::chrono::milliseconds(_failoverRetryMs))) return;
+
+    poco_information_f1(
+        Poco::Logger::get(this->getName()),
+        "Retrying device %s.",
+        _originalDeviceName);
+
+    _afBackend = _originalBackend;
+    _afDevice = _originalDevice;
+    _afDeviceName = _originalDeviceName;
+    _failedOver = false;
+    _stats->setDevice(_afBackend, _afDevice, _afDeviceName);
+
+    this->configArrayFire();
+}
+
 //
 // Input port API
 //
@@ -204,6 +840,26 @@ af::array ArrayFireBlock::getInputPortAsAfArray(
     return _getInputPortAsAfArray(portName, truncateToMinLength);
 }
 
+af::array ArrayFireBlock::getInputPortsAsAfArray(size_t numPorts)
+{
+    // Each port's buffer is uploaded straight into its column, so the
+    // copies come from the ports' page-locked buffers instead of going
+    // through an intermediate host buffer.
+    af::array afArray;
+    for(size_t port = 0; port < numPorts; ++port)
+    {
+        const auto afColumn = this->_getInputPortAsAfArray(port, true);
+        if(0 == port)
+        {
+            afArray = af::array(afColumn.elements(), static_cast<dim_t>(numPorts), afColumn.type());
+        }
+
+        afArray(af::span, static_cast<int>(port)) = afColumn;
+    }
+
+    return afArray;
+}
+
 //
 // Output port API
 //
@@ -236,20 +892,59 @@ void ArrayFireBlock::postAfArray(
     _postAfArray(portName, afArray);
 }
 
+void ArrayFireBlock::produceFromAfArrayColumns(const af::array& afArray)
+{
+    const size_t numPorts = static_cast<size_t>(afArray.dims(1));
+    const size_t columnElems = static_cast<size_t>(afArray.dims(0));
+
+    if(0 == columnElems)
+    {
+        throw Pothos::AssertionViolationException("Attempted to output an empty af::array.");
+    }
+    for(size_t port = 0; port < numPorts; ++port)
+    {
+        const auto* outputPort = this->output(port);
+        if(outputPort->elements() < columnElems)
+        {
+            throw Pothos::AssertionViolationException(
+                      "Attempted to output an af::array column larger than the provided buffer.",
+                      Poco::format(
+                          "Column: %s elements, BufferChunk: %s elements",
+                          Poco::NumberFormatter::format(columnElems),
+                          Poco::NumberFormatter::format(outputPort->elements())));
+        }
+    }
+
+    this->_syncForStats(afArray);
+
+    // Each column is downloaded straight into its port's page-locked
+    // buffer. Nothing is produced until every column is downloaded, so if
+    // the device faults partway through, running the computation again
+    // through runWithFailover() doesn't output any column twice.
+    for(size_t port = 0; port < numPorts; ++port)
+    {
+        auto* outputPort = this->output(port);
+        {
+            auto timer = this->timeStage(BlockStage::Download);
+            const af::array afColumn = afArray(af::span, static_cast<int>(port));
+            afColumn.host(outputPort->buffer().as<void*>());
+        }
+        if(!_onHostBackend) _stats->addBytesD2H(columnElems * outputPort->dtype().size());
+    }
+    for(size_t port = 0; port < numPorts; ++port)
+    {
+        this->output(port)->produce(columnElems);
+    }
+    _stats->addCall(static_cast<size_t>(afArray.elements()));
+}
+
 //
 // Misc
 //
 
 void ArrayFireBlock::configArrayFire() const
 {
-    if(af::getActiveBackend() != _afBackend)
-    {
-        af::setBackend(_afBackend);
-    }
-    if(af::getDevice() != _afDevice)
-    {
-        af::setDevice(_afDevice);
-    }
+    setThreadBackendAndDevice(_afBackend, _afDevice);
 }
 
 //
@@ -262,7 +957,8 @@ af::array ArrayFireBlock::_getInputPortAsAfArray(
     const PortIdType& portId,
     bool truncateToMinLength)
 {
-    auto bufferChunk = this->input(portId)->buffer();
+    auto* inputPort = this->input(portId);
+    auto bufferChunk = inputPort->buffer();
     const size_t minLength = this->workInfo().minAllElements;
     assert(minLength <= bufferChunk.elements());
 
@@ -271,8 +967,68 @@ af::array ArrayFireBlock::_getInputPortAsAfArray(
         bufferChunk.length = minLength * bufferChunk.dtype.size();
     }
 
-    this->input(portId)->consume(minLength);
-    return Pothos::Object(bufferChunk).convert<af::array>();
+    this->_consumeInputPort(inputPort, minLength);
+
+    auto timer = this->timeStage(BlockStage::Upload);
+    if(!_onHostBackend) _stats->addBytesH2D(bufferChunk.length);
+
+    return bufferChunkToAfArray(bufferChunk, this->_getAfInputDType(inputPort));
+}
+
+void ArrayFireBlock::_consumeInputPort(
+    Pothos::InputPort* inputPort,
+    size_t elems)
+{
+    // When running a computation again after a fault, the port was already
+    // consumed.
+    if(!_trackConsumedPorts ||
+       (_consumedPorts.end() == std::find(_consumedPorts.begin(), _consumedPorts.end(), inputPort)))
+    {
+        inputPort->consume(elems);
+        if(_trackConsumedPorts) _consumedPorts.emplace_back(inputPort);
+    }
+
+    // Injected faults happen partway through the computation, after some
+    // input has been consumed, like a real fault would.
+    if(_trackConsumedPorts && (_injectedFaults > 0))
+    {
+        --_injectedFaults;
+        throw af::exception("Injected device fault", __FILE__, __LINE__, ::AF_ERR_DRIVER);
+    }
+}
+
+af::dtype ArrayFireBlock::_getAfInputDType(const Pothos::InputPort* inputPort)
+{
+    auto afDTypeIter = _afInputDTypes.find(inputPort);
+    if(_afInputDTypes.end() == afDTypeIter)
+    {
+        afDTypeIter = _afInputDTypes.emplace(inputPort, pothosDTypeToAfDType(inputPort->dtype())).first;
+    }
+
+    return afDTypeIter->second;
+}
+
+// ArrayFire evaluates lazily and runs asynchronously, so without this, the
+// compute time would show up in the download stage. This forces a sync, so
+// it is only done when stats are enabled or a trace is running.
+static void evalForStats(const af::array& afArray)
+{
+    afArray.eval();
+}
+
+static void evalForStats(const af::array::array_proxy&)
+{
+}
+
+template <typename AfArrayType>
+void ArrayFireBlock::_syncForStats(const AfArrayType& afArray)
+{
+    if(_stats->isRecording())
+    {
+        auto timer = this->timeStage(BlockStage::Sync);
+        evalForStats(afArray);
+        af::sync();
+    }
 }
 
 template <typename PortIdType, typename AfArrayType>
@@ -297,7 +1053,17 @@ void ArrayFireBlock::_produceFromAfArray(
                 "Port: "+Pothos::Object(portId).convert<std::string>());
     }
 
-    afArray.host(outputPort->buffer());
+    this->_syncForStats(afArray);
+    {
+        auto timer = this->timeStage(BlockStage::Download);
+        afArray.host(outputPort->buffer());
+    }
+    if(!_onHostBackend)
+    {
+        _stats->addBytesD2H(static_cast<size_t>(afArray.elements()) * outputPort->dtype().size());
+    }
+    _stats->addCall(static_cast<size_t>(afArray.elements()));
+
     outputPort->produce(afArray.elements());
 }
 
@@ -312,5 +1078,15 @@ void ArrayFireBlock::_postAfArray(
                 "Attempted to output an empty af::array,",
                 "Port: "+Pothos::Object(portId).convert<std::string>());
     }
-    this->output(portId)->postBuffer(Pothos::Object(afArray).convert<Pothos::BufferChunk>());
+    this->_syncForStats(afArray);
+
+    Pothos::BufferChunk bufferChunk;
+    {
+        auto timer = this->timeStage(BlockStage::Download);
+        bufferChunk = afArrayTypeToBufferChunk(afArray);
+    }
+    if(!_onHostBackend) _stats->addBytesD2H(bufferChunk.length);
+    _stats->addCall(bufferChunk.elements());
+
+    this->output(portId)->postBuffer(std::move(bufferChunk));
 }
@@ -1,13 +1,21 @@
-// Copyright (c) 2019-2020 Nicholas Corgan
+// Copyright (c) 2019-2021 Nicholas Corgan
 // SPDX-License-Identifier: BSD-3-Clause
 
 #pragma once
 
+#include "BlockStats.hpp"
+
 #include <Pothos/Framework.hpp>
 
 #include <arrayfire.h>
 
+#include <functional>
+#include <memory>
 #include <string>
+#include <unordered_map>
+#include <vector>
+
+using AfArrayFunc = std::function<af::array(const std::vector<af::array>&)>;
 
 class ArrayFireBlock: public Pothos::Block
 {
@@ -29,12 +37,173 @@ class ArrayFireBlock: public Pothos::Block
 
         void activate() override;
 
+        void deactivate() override;
+
         std::string backend() const;
 
         std::string device() const;
 
+        // How the device was chosen
+        std::string devicePlacement() const;
+
         virtual std::string overlay() const;
 
+        //
+        // Stats
+        //
+
+        std::string stats() const;
+
+        bool statsEnabled() const;
+
+        void setStatsEnabled(bool enabled);
+
+        void resetStats();
+
+        // Memory manager stats for the block's device
+        std::string memoryStats() const;
+
+        //
+        // Auto offload
+        //
+        // Blocks that process through hostBackendIfSmall() call
+        // enableAutoOffload() to expose it. In auto offload mode, work()
+        // calls smaller than the block's crossover size run on the ArrayFire
+        // CPU backend in the calling thread, avoiding the transfer and
+        // launch overhead of the block's device. If no crossover size is
+        // set, it is measured the first time the block is activated.
+        //
+
+        void enableAutoOffload();
+
+        bool autoOffload() const;
+
+        void setAutoOffload(bool autoOffload);
+
+        size_t crossoverElements() const;
+
+        void setCrossoverElements(size_t crossoverElements);
+
+        // Measures the crossover size for the block's computation. By
+        // default, the block never runs on the host.
+        virtual size_t measureCrossoverElements();
+
+        // Times the given function on the host and device for increasing
+        // sizes and returns the smallest size at which the device is
+        // faster.
+        size_t timeCrossoverElements(
+            const std::vector<af::dtype>& inputTypes,
+            const AfArrayFunc& func);
+
+        // While in scope, the block processes on the CPU backend, if the
+        // given size is below the crossover size. Otherwise, this does
+        // nothing.
+        class ScopedHostBackend
+        {
+            public:
+                explicit ScopedHostBackend(ArrayFireBlock* block);
+
+                ScopedHostBackend(ScopedHostBackend&& other);
+
+                ~ScopedHostBackend();
+
+                ScopedHostBackend(const ScopedHostBackend&) = delete;
+                ScopedHostBackend& operator=(const ScopedHostBackend&) = delete;
+
+                bool active() const
+                {
+                    return (nullptr != _block);
+                }
+
+            private:
+                ArrayFireBlock* _block;
+        };
+
+        ScopedHostBackend hostBackendIfSmall(size_t elems);
+
+        //
+        // Batching
+        //
+        // Blocks that call enableBatching() can be set to wait until a
+        // minimum number of elements has accumulated before processing,
+        // amortizing launch overhead across larger buffers. While a partial
+        // batch waits, the minimum is set as the inputs' reserve, so the
+        // scheduler only calls work() once a batch has arrived, or as much
+        // as a default upstream buffer pool holds. A timer wakes the block
+        // when the oldest waiting data reaches the maximum latency, and
+        // whatever has accumulated is processed.
+        //
+
+        void enableBatching();
+
+        size_t minBatchElements() const;
+
+        void setMinBatchElements(size_t minBatchElements);
+
+        size_t maxLatencyUs() const;
+
+        void setMaxLatencyUs(size_t maxLatencyUs);
+
+        // Call at the beginning of work() with the number of elements
+        // available. If this returns true, work() should return without
+        // consuming anything, and it will be called again when the batch
+        // has arrived or the maximum latency has passed.
+        bool deferForBatch(size_t elems);
+
+        // Call at the beginning of work(). If the block's device is near its
+        // memory budget, this periodically frees what it can, and if that
+        // isn't enough, returns true, and work() should return without
+        // consuming anything until memory is freed elsewhere. A warning is
+        // logged if this goes on for too long.
+        //
+        // The one-, two-, and N-input blocks (including Convolve), the
+        // reduced blocks, the expression block, and FFT call this. Other
+        // blocks don't wait for memory, so their allocations can fail once
+        // the budget is reached.
+        bool deferForMemory();
+
+        //
+        // Failover
+        //
+        // Blocks that run their computation through runWithFailover() call
+        // enableFailover() to expose it. With failover enabled, if the
+        // block's device faults (runs out of memory, or has a driver or
+        // runtime error) during that computation, the block moves to the
+        // CPU device and runs the computation again. If a retry time is set,
+        // the block moves back to its original device after that long.
+        //
+
+        void enableFailover();
+
+        bool failover() const;
+
+        void setFailover(bool failover);
+
+        size_t failoverRetryMs() const;
+
+        void setFailoverRetryMs(size_t failoverRetryMs);
+
+        size_t deviceFaults() const;
+
+        // For testing, makes the next computation run through
+        // runWithFailover() throw a driver error right after it consumes
+        // its first input.
+        void injectDeviceFault();
+
+        // Input consumed through the port API before a fault isn't
+        // consumed again when the computation is run again.
+        void runWithFailover(const std::function<void()>& func);
+
+        bool failedOver() const
+        {
+            return _failedOver;
+        }
+
+        // Records time spent in a stage of work(). Uploads, device syncs,
+        // and downloads done through the port APIs below are recorded
+        // automatically, so subclasses only need to time computation.
+        BlockStats::ScopedTimer timeStage(BlockStage stage);
+
         //
         // Input port API
         //
@@ -47,6 +216,10 @@ class ArrayFireBlock: public Pothos::Block
             const std::string& portName,
             bool truncateToMinLength = true);
 
+        // Gathers the first numPorts inputs, which must share a type, into
+        // one array with a column per port.
+        af::array getInputPortsAsAfArray(size_t numPorts);
+
         //
         // Output port API
         //
@@ -67,6 +240,10 @@ class ArrayFireBlock: public Pothos::Block
             const std::string& portName,
             const af::array& afArray);
 
+        // Scatters each column of the given array to the output port with
+        // the same index.
+        void produceFromAfArrayColumns(const af::array& afArray);
+
         //
         // Misc
         //
@@ -81,9 +258,63 @@ class ArrayFireBlock: public Pothos::Block
         int _afDevice;
         std::string _afDeviceName;
         std::string _domain;
+        std::string _devicePlacement;
+        std::shared_ptr<void> _devicePlacementToken;
+
+        BlockStats::SPtr _stats;
+
+        bool _autoOffload;
+        bool _crossoverKnown;
+        size_t _crossoverElements;
+        bool _onHostBackend;
+
+        size_t _minBatchElements;
+        size_t _batchReserveElements;
+        size_t _maxLatencyUs;
+        bool _batchPending;
+        BlockStats::Clock::time_point _batchDeadline;
+
+        class BatchTimer;
+        std::unique_ptr<BatchTimer> _batchTimer;
+
+        size_t _memoryDeferrals;
+        BlockStats::Clock::time_point _lastMemoryGCTime;
+
+        bool _failover;
+        size_t _failoverRetryMs;
+        size_t _deviceFaults;
+        size_t _injectedFaults;
+        bool _failedOver;
+        BlockStats::Clock::time_point _failoverTime;
+        af::Backend _originalBackend;
+        int _originalDevice;
+        std::string _originalDeviceName;
 
     private:
 
+        void _endBatchWait();
+
+        bool _failOverToHost(const af::exception& ex);
+
+        void _restoreDeviceIfRetryDue();
+
+        // Set while running a computation through runWithFailover()
+        bool _trackConsumedPorts;
+        std::vector<Pothos::InputPort*> _consumedPorts;
+
+        // Port DTypes don't change after setup, so each is only converted
+        // the first time the port is used.
+        std::unordered_map<const Pothos::InputPort*, af::dtype> _afInputDTypes;
+
+        af::dtype _getAfInputDType(const Pothos::InputPort* inputPort);
+
+        void _consumeInputPort(
+            Pothos::InputPort* inputPort,
+            size_t elems);
+
+        template <typename AfArrayType>
+        void _syncForStats(const AfArrayType& afArray);
+
         template <typename PortIdType>
         af::array _getInputPortAsAfArray(
             const PortIdType& portId,
@@ -1,4 +1,4 @@
-// Copyright (c) 2020 Nicholas Corgan
+// Copyright (c) 2020-2021 Nicholas Corgan
 // SPDX-License-Identifier: BSD-3-Clause
 
 #include "OneToOneBlock.hpp"
@@ -78,7 +78,7 @@ static af::array afNot(const af::array& afArray)
  * the outputs in the output stream.
  *
  * |category /GPU/Array Operations
- * |factory /gpu/array/bitwise_not(device,dtype)
+ * |factory /gpu/array/bitwise_not(device,dtype,numChannels)
  *
  * |param device[Device] Device to use for processing.
  * |default "Auto"
@@ -87,11 +87,15 @@ static af::array afNot(const af::array& afArray)
  * |widget DTypeChooser(int=1,uint=1,dim=1)
  * |default "uint64"
  * |preview disable
+ *
+ * |param numChannels[Num Channels] The number of input/output pairs.
+ * |widget SpinBox(minimum=1)
+ * |default 1
+ * |preview disable
  */
-static Pothos::BlockRegistry registerBitwiseNot(
+static const auto registerBitwiseNot = makeOneToOneBlockRegistries(
     "/gpu/array/bitwise_not",
-    Pothos::Callable(&OneToOneBlock::makeFromOneType)
-        .bind<OneToOneFunc>(&afNot, 1)
+    Pothos::Callable(&DirectOneToOneBlock<OneToOneFuncCaller<&afNot>>::makeFromOneType)
         .bind<DTypeSupport>({
             true,
             true,
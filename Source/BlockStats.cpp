@@ -0,0 +1,370 @@
+// Copyright (c) 2021 Nicholas Corgan
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "BlockStats.hpp"
+#include "BlockTrace.hpp"
+
+#include <Pothos/Object.hpp>
+
+#include <Poco/Environment.h>
+#include <Poco/NumberParser.h>
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+using json = nlohmann::json;
+
+//
+// Global state
+//
+
+static bool getEnabledFromEnvironment()
+{
+    int value = 0;
+    return Poco::NumberParser::tryParse(Poco::Environment::get("POTHOSGPU_BLOCK_STATS", "0"), value) &&
+           (value != 0);
+}
+
+static std::atomic<bool>& getAllEnabled()
+{
+    static std::atomic<bool> allEnabled(getEnabledFromEnvironment());
+
+    return allEnabled;
+}
+
+struct BlockDeviceCounters
+{
+    BlockDeviceCounters():
+        activeBlocks(0),
+        bytesH2D(0),
+        bytesD2H(0),
+        kernelNs(0),
+        untimedCalls(0)
+    {
+    }
+
+    std::atomic<size_t> activeBlocks;
+    std::atomic<std::uint64_t> bytesH2D;
+    std::atomic<std::uint64_t> bytesD2H;
+
+    // Compute and sync time, which is when ArrayFire runs kernels. This is
+    // only measured for blocks with stats enabled, as it needs a sync.
+    std::atomic<std::uint64_t> kernelNs;
+
+    // Calls from blocks with stats disabled, which aren't in kernelNs
+    std::atomic<std::uint64_t> untimedCalls;
+};
+
+struct BlockStatsRegistry
+{
+    std::mutex mutex;
+    std::vector<std::weak_ptr<BlockStats>> entries;
+
+    // Never removed, so totals outlive blocks
+    std::map<std::pair<af::Backend, int>, std::shared_ptr<BlockDeviceCounters>> devices;
+
+    // Assumes mutex is locked
+    std::vector<BlockStats::SPtr> lockAll()
+    {
+        entries.erase(
+            std::remove_if(
+                entries.begin(),
+                entries.end(),
+                [](const std::weak_ptr<BlockStats>& entry){return entry.expired();}),
+            entries.end());
+
+        std::vector<BlockStats::SPtr> ret;
+        for(const auto& entry: entries)
+        {
+            if(auto stats = entry.lock()) ret.emplace_back(std::move(stats));
+        }
+
+        return ret;
+    }
+};
+
+static BlockStatsRegistry& getRegistry()
+{
+    static BlockStatsRegistry registry;
+
+    return registry;
+}
+
+static std::shared_ptr<BlockDeviceCounters> getDeviceCounters(
+    af::Backend backend,
+    int device)
+{
+    auto& registry = getRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+
+    auto& counters = registry.devices[std::make_pair(backend, device)];
+    if(!counters) counters = std::make_shared<BlockDeviceCounters>();
+
+    return counters;
+}
+
+static double nsToMs(std::uint64_t ns)
+{
+    return static_cast<double>(ns) / 1e6;
+}
+
+static const std::string& getStageName(BlockStage stage)
+{
+    static const std::string stageNames[] = {"Upload", "Compute", "Sync", "Download", "Work"};
+
+    return stageNames[static_cast<size_t>(stage)];
+}
+
+//
+// ScopedTimer
+//
+
+BlockStats::ScopedTimer::ScopedTimer(BlockStats* stats, BlockStage stage):
+    _stats(stats),
+    _stage(stage),
+    _start(stats ? Clock::now() : Clock::time_point())
+{
+}
+
+BlockStats::ScopedTimer::ScopedTimer(ScopedTimer&& other):
+    _stats(other._stats),
+    _stage(other._stage),
+    _start(other._start)
+{
+    other._stats = nullptr;
+}
+
+BlockStats::ScopedTimer::~ScopedTimer()
+{
+    if(_stats) _stats->_record(_stage, _start, Clock::now());
+}
+
+//
+// BlockStats
+//
+
+BlockStats::SPtr BlockStats::make(
+    af::Backend backend,
+    int device,
+    const std::string& deviceName)
+{
+    SPtr stats(new BlockStats(backend, device, deviceName));
+
+    auto& registry = getRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.entries.emplace_back(stats);
+
+    return stats;
+}
+
+void BlockStats::setAllEnabled(bool enabled)
+{
+    getAllEnabled() = enabled;
+
+    auto& registry = getRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    for(const auto& stats: registry.lockAll()) stats->setEnabled(enabled);
+}
+
+bool BlockStats::allEnabled()
+{
+    return getAllEnabled();
+}
+
+json BlockStats::allToJSON()
+{
+    std::vector<SPtr> allStats;
+    {
+        auto& registry = getRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        allStats = registry.lockAll();
+    }
+
+    json ret(json::array());
+    for(const auto& stats: allStats)
+    {
+        if(stats->_calls.load(std::memory_order_relaxed) > 0)
+        {
+            ret.push_back(stats->toJSON());
+        }
+    }
+
+    return ret;
+}
+
+json BlockStats::deviceTotalsToJSON(
+    af::Backend backend,
+    int device)
+{
+    const auto counters = getDeviceCounters(backend, device);
+    const auto kernelNs = counters->kernelNs.load(std::memory_order_relaxed);
+
+    json totalsJSON;
+    totalsJSON["Active Blocks"] = counters->activeBlocks.load(std::memory_order_relaxed);
+    totalsJSON["Bytes H2D"] = counters->bytesH2D.load(std::memory_order_relaxed);
+    totalsJSON["Bytes D2H"] = counters->bytesD2H.load(std::memory_order_relaxed);
+    totalsJSON["Kernel Time (ms)"] = nsToMs(kernelNs);
+    totalsJSON["Kernel Time Recorded"] = (0 == counters->untimedCalls.load(std::memory_order_relaxed));
+
+    return totalsJSON;
+}
+
+BlockStats::BlockStats(
+    af::Backend backend,
+    int device,
+    const std::string& deviceName
+):
+    _enabled(getAllEnabled().load()),
+    _nameMutex(),
+    _name(),
+    _device(deviceName),
+    _backend(Pothos::Object(backend).convert<std::string>()),
+    _deviceCounters(getDeviceCounters(backend, device)),
+    _stageNs(),
+    _bytesH2D(0),
+    _bytesD2H(0),
+    _calls(0),
+    _elements(0)
+{
+    for(auto& stageNs: _stageNs) stageNs = 0;
+
+    ++_deviceCounters->activeBlocks;
+}
+
+BlockStats::~BlockStats()
+{
+    --_deviceCounters->activeBlocks;
+}
+
+void BlockStats::setEnabled(bool enabled)
+{
+    _enabled = enabled;
+}
+
+void BlockStats::setName(const std::string& name)
+{
+    std::lock_guard<std::mutex> lock(_nameMutex);
+    _name = name;
+}
+
+void BlockStats::setDevice(
+    af::Backend backend,
+    int device,
+    const std::string& deviceName)
+{
+    auto deviceCounters = getDeviceCounters(backend, device);
+    ++deviceCounters->activeBlocks;
+
+    std::lock_guard<std::mutex> lock(_nameMutex);
+    --_deviceCounters->activeBlocks;
+
+    _device = deviceName;
+    _backend = Pothos::Object(backend).convert<std::string>();
+    _deviceCounters = std::move(deviceCounters);
+}
+
+bool BlockStats::isRecording() const
+{
+    return this->enabled() || BlockTrace::enabled();
+}
+
+BlockStats::ScopedTimer BlockStats::timeStage(BlockStage stage)
+{
+    return ScopedTimer((this->isRecording() ? this : nullptr), stage);
+}
+
+void BlockStats::addStageTime(
+    BlockStage stage,
+    Clock::duration duration)
+{
+    if(BlockStage::Work == stage) return;
+
+    const auto ns = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count());
+    _stageNs[static_cast<size_t>(stage)].fetch_add(ns, std::memory_order_relaxed);
+
+    if((BlockStage::Compute == stage) || (BlockStage::Sync == stage))
+    {
+        _deviceCounters->kernelNs.fetch_add(ns, std::memory_order_relaxed);
+    }
+}
+
+void BlockStats::addBytesH2D(size_t bytes)
+{
+    _deviceCounters->bytesH2D.fetch_add(bytes, std::memory_order_relaxed);
+    if(this->enabled()) _bytesH2D.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void BlockStats::addBytesD2H(size_t bytes)
+{
+    _deviceCounters->bytesD2H.fetch_add(bytes, std::memory_order_relaxed);
+    if(this->enabled()) _bytesD2H.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void BlockStats::addCall(size_t elements)
+{
+    if(this->enabled())
+    {
+        _calls.fetch_add(1, std::memory_order_relaxed);
+        _elements.fetch_add(elements, std::memory_order_relaxed);
+    }
+    else _deviceCounters->untimedCalls.fetch_add(1, std::memory_order_relaxed);
+}
+
+void BlockStats::reset()
+{
+    for(auto& stageNs: _stageNs) stageNs = 0;
+    _bytesH2D = 0;
+    _bytesD2H = 0;
+    _calls = 0;
+    _elements = 0;
+}
+
+void BlockStats::_record(
+    BlockStage stage,
+    Clock::time_point start,
+    Clock::time_point end)
+{
+    if(this->enabled()) this->addStageTime(stage, (end - start));
+
+    if(BlockTrace::enabled())
+    {
+        BlockTrace::Tags tags;
+        {
+            std::lock_guard<std::mutex> lock(_nameMutex);
+            tags.block = _name;
+            tags.device = _device;
+            tags.backend = _backend;
+        }
+
+        BlockTrace::addEvent(getStageName(stage), tags, start, end);
+    }
+}
+
+json BlockStats::toJSON() const
+{
+    const auto calls = _calls.load(std::memory_order_relaxed);
+    const auto elements = _elements.load(std::memory_order_relaxed);
+
+    json statsJSON;
+    {
+        std::lock_guard<std::mutex> lock(_nameMutex);
+        statsJSON["Name"] = _name;
+        statsJSON["Device"] = _device;
+        statsJSON["Backend"] = _backend;
+    }
+    statsJSON["Enabled"] = this->enabled();
+    statsJSON["Calls"] = calls;
+    statsJSON["Elements"] = elements;
+    statsJSON["Elements Per Call"] = (calls > 0) ? (static_cast<double>(elements) / static_cast<double>(calls)) : 0.0;
+    statsJSON["Upload Time (ms)"] = nsToMs(_stageNs[static_cast<size_t>(BlockStage::Upload)]);
+    statsJSON["Compute Time (ms)"] = nsToMs(_stageNs[static_cast<size_t>(BlockStage::Compute)]);
+    statsJSON["Sync Time (ms)"] = nsToMs(_stageNs[static_cast<size_t>(BlockStage::Sync)]);
+    statsJSON["Download Time (ms)"] = nsToMs(_stageNs[static_cast<size_t>(BlockStage::Download)]);
+    statsJSON["Bytes H2D"] = _bytesH2D.load(std::memory_order_relaxed);
+    statsJSON["Bytes D2H"] = _bytesD2H.load(std::memory_order_relaxed);
+
+    return statsJSON;
+}
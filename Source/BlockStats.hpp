@@ -0,0 +1,156 @@
+// Copyright (c) 2021 Nicholas Corgan
+// SPDX-License-Identifier: BSD-3-Clause
+
+#pragma once
+
+#include <nlohmann/json.hpp>
+
+#include <arrayfire.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+
+enum class BlockStage
+{
+    Upload = 0,
+    Compute,
+    Sync,
+    Download,
+
+    // Only traced, since the other stages cover the same time
+    Work
+};
+static constexpr size_t NumBlockStages = 4;
+
+struct BlockDeviceCounters;
+
+//
+// Per-block timing and transfer counters. Recording is a handful of relaxed
+// atomic adds, and nothing is recorded while disabled, so this can be left
+// compiled in and switched on at runtime.
+//
+// While tracing (see BlockTrace.hpp), stage timings are also written as
+// trace events, regardless of whether stats are enabled.
+//
+// Every instance is tracked so /devices/gpu/info can report on all live
+// blocks. Instances are enabled on creation if POTHOSGPU_BLOCK_STATS is set
+// to a non-zero value, or after a call to setAllEnabled(true).
+//
+// Transfers are always added to totals for the block's device, which
+// outlive the block (see deviceTotalsToJSON()), along with the number of
+// live blocks. Kernel time is only added while stats are enabled, so the
+// totals say whether it covers every call on the device.
+//
+class BlockStats
+{
+    public:
+        using SPtr = std::shared_ptr<BlockStats>;
+        using Clock = std::chrono::steady_clock;
+
+        class ScopedTimer
+        {
+            public:
+                ScopedTimer(BlockStats* stats, BlockStage stage);
+
+                ScopedTimer(ScopedTimer&& other);
+
+                ~ScopedTimer();
+
+                ScopedTimer(const ScopedTimer&) = delete;
+                ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+            private:
+                BlockStats* _stats;
+                BlockStage _stage;
+                Clock::time_point _start;
+        };
+
+        static SPtr make(
+            af::Backend backend,
+            int device,
+            const std::string& deviceName);
+
+        // Applies to all live and future instances.
+        static void setAllEnabled(bool enabled);
+
+        static bool allEnabled();
+
+        // Stats for all live instances that have recorded anything
+        static nlohmann::json allToJSON();
+
+        // Totals for all blocks that have run on the given device
+        static nlohmann::json deviceTotalsToJSON(
+            af::Backend backend,
+            int device);
+
+        ~BlockStats();
+
+        bool enabled() const
+        {
+            return _enabled.load(std::memory_order_relaxed);
+        }
+
+        void setEnabled(bool enabled);
+
+        // Whether timings are being used for stats or tracing
+        bool isRecording() const;
+
+        void setName(const std::string& name);
+
+        // For when a block moves to another device. Must be called from the
+        // thread doing the recording.
+        void setDevice(
+            af::Backend backend,
+            int device,
+            const std::string& deviceName);
+
+        // Returns a timer that does nothing unless stats are enabled or a
+        // trace is running.
+        ScopedTimer timeStage(BlockStage stage);
+
+        void addStageTime(
+            BlockStage stage,
+            Clock::duration duration);
+
+        void addBytesH2D(size_t bytes);
+
+        void addBytesD2H(size_t bytes);
+
+        // Called once per output buffer
+        void addCall(size_t elements);
+
+        void reset();
+
+        nlohmann::json toJSON() const;
+
+    private:
+        BlockStats(
+            af::Backend backend,
+            int device,
+            const std::string& deviceName);
+
+        void _record(
+            BlockStage stage,
+            Clock::time_point start,
+            Clock::time_point end);
+
+        std::atomic<bool> _enabled;
+
+        // Also guards the device
+        mutable std::mutex _nameMutex;
+        std::string _name;
+        std::string _device;
+        std::string _backend;
+        std::shared_ptr<BlockDeviceCounters> _deviceCounters;
+
+        std::array<std::atomic<std::uint64_t>, NumBlockStages> _stageNs;
+        std::atomic<std::uint64_t> _bytesH2D;
+        std::atomic<std::uint64_t> _bytesD2H;
+        std::atomic<std::uint64_t> _calls;
+        std::atomic<std::uint64_t> _elements;
+};
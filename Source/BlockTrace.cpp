@@ -0,0 +1,187 @@
+// Copyright (c) 2021 Nicholas Corgan
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "BlockTrace.hpp"
+
+#include <Pothos/Exception.hpp>
+
+#include <Poco/Environment.h>
+#include <Poco/Logger.h>
+#include <Poco/Process.h>
+
+#include <nlohmann/json.hpp>
+
+#include <atomic>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+using json = nlohmann::json;
+
+namespace BlockTrace
+{
+
+struct TraceState
+{
+    std::mutex mutex;
+    std::ofstream file;
+    std::string filepath;
+    Clock::time_point start;
+    bool firstEvent;
+
+    // Chrome traces expect small integer thread IDs.
+    std::unordered_map<std::thread::id, size_t> threadIDs;
+
+    ~TraceState()
+    {
+        try {stop();}
+        catch(...) {}
+    }
+};
+
+static std::atomic<bool> traceEnabled(false);
+
+static TraceState& getState()
+{
+    static TraceState state;
+
+    return state;
+}
+
+// Assumes the state's mutex is locked
+static void writeEvent(
+    TraceState& state,
+    const json& event)
+{
+    state.file << (state.firstEvent ? "" : ",\n") << event.dump();
+    state.firstEvent = false;
+}
+
+// Assumes the state's mutex is locked
+static size_t getThreadID(TraceState& state)
+{
+    const auto threadID = std::this_thread::get_id();
+
+    auto iter = state.threadIDs.find(threadID);
+    if(state.threadIDs.end() != iter) return iter->second;
+
+    const size_t tid = state.threadIDs.size() + 1;
+    state.threadIDs.emplace(threadID, tid);
+
+    // Name the thread in the viewer.
+    json event;
+    event["name"] = "thread_name";
+    event["ph"] = "M";
+    event["pid"] = Poco::Process::id();
+    event["tid"] = tid;
+    event["args"]["name"] = "Pothos thread " + std::to_string(tid);
+    writeEvent(state, event);
+
+    return tid;
+}
+
+static double toMicroseconds(Clock::duration duration)
+{
+    return std::chrono::duration<double, std::micro>(duration).count();
+}
+
+bool enabled()
+{
+    return traceEnabled.load(std::memory_order_relaxed);
+}
+
+void start(const std::string& filepath)
+{
+    stop();
+
+    auto& state = getState();
+    std::lock_guard<std::mutex> lock(state.mutex);
+
+    state.file.open(filepath, std::ios::out | std::ios::trunc);
+    if(!state.file)
+    {
+        throw Pothos::FileException(
+                  "Failed to open trace file",
+                  filepath);
+    }
+
+    state.file << "[\n";
+    state.filepath = filepath;
+    state.start = Clock::now();
+    state.firstEvent = true;
+    state.threadIDs.clear();
+
+    traceEnabled = true;
+}
+
+void stop()
+{
+    auto& state = getState();
+    std::lock_guard<std::mutex> lock(state.mutex);
+
+    traceEnabled = false;
+    if(state.file.is_open())
+    {
+        state.file << "\n]\n";
+        state.file.close();
+    }
+}
+
+std::string filepath()
+{
+    auto& state = getState();
+    std::lock_guard<std::mutex> lock(state.mutex);
+
+    return state.file.is_open() ? state.filepath : "";
+}
+
+void addEvent(
+    const std::string& name,
+    const Tags& tags,
+    Clock::time_point start,
+    Clock::time_point end)
+{
+    auto& state = getState();
+    std::lock_guard<std::mutex> lock(state.mutex);
+
+    // Tracing may have stopped since the caller checked.
+    if(!state.file.is_open()) return;
+
+    json event;
+    event["name"] = name;
+    event["cat"] = "PothosGPU";
+    event["ph"] = "X";
+    event["ts"] = toMicroseconds(start - state.start);
+    event["dur"] = toMicroseconds(end - start);
+    event["pid"] = Poco::Process::id();
+    event["tid"] = getThreadID(state);
+    event["args"]["block"] = tags.block;
+    event["args"]["device"] = tags.device;
+    event["args"]["backend"] = tags.backend;
+    writeEvent(state, event);
+}
+
+static bool startFromEnvironment()
+{
+    const auto filepath = Poco::Environment::get("POTHOSGPU_TRACE_FILE", "");
+    if(filepath.empty()) return false;
+
+    try
+    {
+        start(filepath);
+    }
+    catch(const Pothos::Exception& ex)
+    {
+        auto& logger = Poco::Logger::get("PothosGPU");
+        poco_error(logger, ex.displayText());
+
+        return false;
+    }
+
+    return true;
+}
+
+static const bool startedFromEnvironment = startFromEnvironment();
+
+}
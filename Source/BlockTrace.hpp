@@ -0,0 +1,43 @@
+// Copyright (c) 2021 Nicholas Corgan
+// SPDX-License-Identifier: BSD-3-Clause
+
+#pragma once
+
+#include <chrono>
+#include <string>
+
+//
+// Writes ArrayFireBlock stage timings as Chrome trace events, viewable in
+// chrome://tracing or the Perfetto UI.
+//
+// Tracing starts on load if POTHOSGPU_TRACE_FILE is set to a file path, or
+// at runtime with /devices/gpu/start_trace. Events are written as they are
+// recorded, in the JSON array format, which allows the closing bracket to be
+// missing, so a trace from an interrupted process is still readable.
+//
+namespace BlockTrace
+{
+    using Clock = std::chrono::steady_clock;
+
+    struct Tags
+    {
+        std::string block;
+        std::string device;
+        std::string backend;
+    };
+
+    bool enabled();
+
+    // Any trace in progress is stopped first.
+    void start(const std::string& filepath);
+
+    void stop();
+
+    std::string filepath();
+
+    void addEvent(
+        const std::string& name,
+        const Tags& tags,
+        Clock::time_point start,
+        Clock::time_point end);
+}
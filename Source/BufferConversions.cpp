@@ -1,7 +1,8 @@
-// Copyright (c) 2019-2020 Nicholas Corgan
+// Copyright (c) 2019-2021 Nicholas Corgan
 // SPDX-License-Identifier: BSD-3-Clause
 
 #include "BufferConversions.hpp"
+#include "EnumConversions.hpp"
 #include "SharedBufferAllocator.hpp"
 #include "Utility.hpp"
 
@@ -32,16 +33,29 @@ Pothos::BufferChunk afArrayTypeToBufferChunk(const AfArrayType& afArray)
     afArray.host(reinterpret_cast<void*>(sharedBuffer.getAddress()));
 
     auto bufferChunk = Pothos::BufferChunk(sharedBuffer);
-    bufferChunk.dtype = Pothos::Object(afArray.type()).convert<Pothos::DType>();
+    bufferChunk.dtype = afDTypeToPothosDType(afArray.type());
 
     return bufferChunk;
 }
 
-static af::array bufferChunkToAfArray(const Pothos::BufferChunk& bufferChunk)
+template Pothos::BufferChunk afArrayTypeToBufferChunk<af::array>(const af::array&);
+template Pothos::BufferChunk afArrayTypeToBufferChunk<af::array::array_proxy>(const af::array::array_proxy&);
+
+af::array bufferChunkToAfArray(const Pothos::BufferChunk& bufferChunk)
+{
+    return bufferChunkToAfArray(
+               bufferChunk,
+               pothosDTypeToAfDType(bufferChunk.dtype));
+}
+
+af::array bufferChunkToAfArray(
+    const Pothos::BufferChunk& bufferChunk,
+    af::dtype afDType)
 {
+    // Uses the buffer's length, since its DType may not match.
     af::array ret(
-        bufferChunk.elements(),
-        Pothos::Object(bufferChunk.dtype).convert<af::dtype>());
+        static_cast<dim_t>(bufferChunk.length / af::getSizeOf(afDType)),
+        afDType);
     ret.write<unsigned char>(
         reinterpret_cast<const unsigned char*>(bufferChunk.address),
         bufferChunk.length,
@@ -121,7 +135,7 @@ pothos_static_block(registerArrayFireBufferConversions)
         Pothos::Callable(&afArrayTypeToBufferChunk<af::array::array_proxy>));
     Pothos::PluginRegistry::add(
         "/object/convert/gpu/bufferchunk_to_afarray",
-        Pothos::Callable(&bufferChunkToAfArray));
+        Pothos::Callable(static_cast<af::array(*)(const Pothos::BufferChunk&)>(&bufferChunkToAfArray)));
 
     registerStdVectorConversion<float>("float");
     registerStdVectorConversion<double>("double");
@@ -1,4 +1,4 @@
-// Copyright (c) 2019-2020 Nicholas Corgan
+// Copyright (c) 2019-2021 Nicholas Corgan
 // SPDX-License-Identifier: BSD-3-Clause
 
 #pragma once
@@ -10,6 +10,17 @@
 //
 // Pothos::BufferChunk <-> af::array
 //
+// These are also registered as Pothos::Object conversions, but blocks call
+// them directly to skip the plugin lookup on every buffer.
+//
 
 template <typename AfArrayType>
 Pothos::BufferChunk afArrayTypeToBufferChunk(const AfArrayType& afArray);
+
+af::array bufferChunkToAfArray(const Pothos::BufferChunk& bufferChunk);
+
+// For when the caller already knows the af::dtype. The buffer's DType is
+// ignored.
+af::array bufferChunkToAfArray(
+    const Pothos::BufferChunk& bufferChunk,
+    af::dtype afDType);
@@ -0,0 +1,617 @@
+// Copyright (c) 2021 Nicholas Corgan
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "CaptureFile.hpp"
+
+#include <Pothos/Exception.hpp>
+#include <Pothos/Framework.hpp>
+#include <Pothos/Object.hpp>
+
+#include <Poco/Checksum.h>
+#include <Poco/Format.h>
+#include <Poco/NumberFormatter.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <utility>
+
+static const std::string HeaderMagic = "PGPUCAP1";
+static const std::string ChunkMagic  = "CHNK";
+static const std::string IndexMagic  = "INDX";
+static const std::string FooterMagic = "PGPUIDX2";
+
+// Magic, first sample, number of samples, CRC-32
+static constexpr size_t ChunkHeaderSize = 4 + 8 + 8 + 4;
+
+// Footer offset, magic
+static constexpr size_t TrailerSize = 8 + 8;
+
+// Poco::Checksum takes an unsigned length, so larger payloads are passed in
+// pieces.
+static constexpr size_t MaxCRC32UpdateSize = 1 << 30;
+
+static std::uint32_t getCRC32(const char* data, size_t size)
+{
+    Poco::Checksum checksum(Poco::Checksum::TYPE_CRC32);
+    for(size_t offset = 0; offset < size; offset += MaxCRC32UpdateSize)
+    {
+        const size_t updateSize = std::min(MaxCRC32UpdateSize, (size - offset));
+        checksum.update(data + offset, static_cast<unsigned>(updateSize));
+    }
+
+    return checksum.checksum();
+}
+
+// Label data is stored with Pothos's serialization, so it keeps its type.
+// Types without serialization support are stored as their string form.
+static std::string serializeLabelData(const Pothos::Object& data)
+{
+    if(!data) return std::string();
+
+    std::ostringstream stream;
+    try
+    {
+        data.serialize(stream);
+    }
+    catch(const Pothos::Exception&)
+    {
+        stream.str(std::string());
+        Pothos::Object(data.toString()).serialize(stream);
+    }
+
+    return stream.str();
+}
+
+static Pothos::Object deserializeLabelData(
+    const std::string& serializedData,
+    const std::string& filepath)
+{
+    Pothos::Object data;
+    if(serializedData.empty()) return data;
+
+    std::istringstream stream(serializedData);
+    try
+    {
+        data.deserialize(stream);
+    }
+    catch(const Pothos::Exception& ex)
+    {
+        throw Pothos::DataFormatException(
+                  "Invalid label data in capture file: "+ex.displayText(),
+                  filepath);
+    }
+
+    return data;
+}
+
+//
+// Parsing
+//
+
+template <typename T>
+static T readValue(
+    std::ifstream& file,
+    const std::string& filepath)
+{
+    T ret;
+    file.read(reinterpret_cast<char*>(&ret), sizeof(ret));
+    if(!file)
+    {
+        throw Pothos::DataFormatException(
+                  "Unexpected end of capture file",
+                  filepath);
+    }
+
+    return ret;
+}
+
+static std::string readString(
+    std::ifstream& file,
+    const std::string& filepath,
+    size_t length)
+{
+    std::string ret(length, '\0');
+    file.read(&ret[0], static_cast<std::streamsize>(length));
+    if(!file)
+    {
+        throw Pothos::DataFormatException(
+                  "Unexpected end of capture file",
+                  filepath);
+    }
+
+    return ret;
+}
+
+bool isCaptureFile(const std::string& filepath)
+{
+    std::ifstream file(filepath, std::ios::in | std::ios::binary);
+
+    std::string magic(HeaderMagic.size(), '\0');
+    file.read(&magic[0], static_cast<std::streamsize>(magic.size()));
+
+    return file && (HeaderMagic == magic);
+}
+
+//
+// CaptureFileReader
+//
+
+CaptureFileReader::CaptureFileReader(const std::string& filepath):
+    _filepath(filepath),
+    _file(filepath, std::ios::in | std::ios::binary),
+    _dtypes(),
+    _sampleSize(0),
+    _chunkSamples(0),
+    _firstChunkOffset(0),
+    _chunks(),
+    _labels(),
+    _numSamples(0)
+{
+    if(!_file)
+    {
+        throw Pothos::FileNotFoundException(_filepath);
+    }
+
+    if(HeaderMagic != readString(_file, _filepath, HeaderMagic.size()))
+    {
+        throw Pothos::DataFormatException(
+                  "Not a PothosGPU capture file",
+                  _filepath);
+    }
+
+    const auto numChannels = readValue<std::uint32_t>(_file, _filepath);
+    _chunkSamples = static_cast<size_t>(readValue<std::uint64_t>(_file, _filepath));
+    if((0 == numChannels) || (0 == _chunkSamples))
+    {
+        throw Pothos::DataFormatException(
+                  "Invalid capture file header",
+                  _filepath);
+    }
+
+    for(std::uint32_t chan = 0; chan < numChannels; ++chan)
+    {
+        const auto nameLength = readValue<std::uint32_t>(_file, _filepath);
+        _dtypes.emplace_back(readString(_file, _filepath, nameLength));
+        _sampleSize += _dtypes.back().size();
+    }
+    _firstChunkOffset = _file.tellg();
+
+    if(!this->_readFooter()) this->_scanChunks();
+
+    for(const auto& chunk: _chunks)
+    {
+        if(chunk.firstSample != _numSamples)
+        {
+            throw Pothos::DataFormatException(
+                      "Capture file chunks are not contiguous",
+                      _filepath);
+        }
+        _numSamples += static_cast<size_t>(chunk.numSamples);
+    }
+}
+
+size_t CaptureFileReader::numChannels() const
+{
+    return _dtypes.size();
+}
+
+Pothos::DType CaptureFileReader::dtype(size_t chan) const
+{
+    return _dtypes.at(chan);
+}
+
+size_t CaptureFileReader::numSamples() const
+{
+    return _numSamples;
+}
+
+// Chunks are verified as a whole, so read whole chunks at a time.
+size_t CaptureFileReader::preferredReadSamples(size_t maxBytes) const
+{
+    const size_t chunkBytes = _chunkSamples * _sampleSize;
+
+    return std::max<size_t>(1, (maxBytes / chunkBytes)) * _chunkSamples;
+}
+
+void CaptureFileReader::read(
+    size_t startSample,
+    size_t numSamples,
+    const std::vector<void*>& channels)
+{
+    if((startSample + numSamples) > _numSamples)
+    {
+        throw Pothos::RangeException(
+                  Poco::format(
+                      "Attempted to read %s samples at offset %s",
+                      Poco::NumberFormatter::format(numSamples),
+                      Poco::NumberFormatter::format(startSample)),
+                  Poco::format(
+                      "%s contains %s samples",
+                      _filepath,
+                      Poco::NumberFormatter::format(_numSamples)));
+    }
+
+    // Find the chunk containing the first sample.
+    auto chunkIter = std::upper_bound(
+                         _chunks.begin(),
+                         _chunks.end(),
+                         startSample,
+                         [](size_t sample, const CaptureFileChunk& chunk)
+                         {
+                             return (sample < chunk.firstSample);
+                         });
+    if(_chunks.begin() != chunkIter) --chunkIter;
+
+    size_t samplesRead = 0;
+    for(; (samplesRead < numSamples) && (_chunks.end() != chunkIter); ++chunkIter)
+    {
+        const auto payload = this->_readChunk(*chunkIter);
+
+        const size_t chunkStart = (startSample + samplesRead) - static_cast<size_t>(chunkIter->firstSample);
+        const size_t numToCopy = std::min<size_t>(
+                                     (numSamples - samplesRead),
+                                     (static_cast<size_t>(chunkIter->numSamples) - chunkStart));
+
+        size_t channelOffset = 0;
+        for(size_t chan = 0; chan < _dtypes.size(); ++chan)
+        {
+            const size_t elemSize = _dtypes[chan].size();
+            std::memcpy(
+                reinterpret_cast<char*>(channels[chan]) + (samplesRead * elemSize),
+                payload.data() + channelOffset + (chunkStart * elemSize),
+                (numToCopy * elemSize));
+
+            channelOffset += (static_cast<size_t>(chunkIter->numSamples) * elemSize);
+        }
+
+        samplesRead += numToCopy;
+    }
+}
+
+std::vector<StreamFileLabel> CaptureFileReader::labels() const
+{
+    return _labels;
+}
+
+size_t CaptureFileReader::chunkSamples() const
+{
+    return _chunkSamples;
+}
+
+const std::vector<CaptureFileChunk>& CaptureFileReader::chunks() const
+{
+    return _chunks;
+}
+
+bool CaptureFileReader::_readFooter()
+{
+    _file.seekg(0, std::ios::end);
+    const std::streamoff fileSize = _file.tellg();
+    if(fileSize < static_cast<std::streamoff>(_firstChunkOffset + TrailerSize))
+    {
+        return false;
+    }
+
+    _file.seekg(fileSize - static_cast<std::streamoff>(TrailerSize));
+    const auto footerOffset = static_cast<std::streamoff>(readValue<std::uint64_t>(_file, _filepath));
+    if((FooterMagic != readString(_file, _filepath, FooterMagic.size())) ||
+       (footerOffset < _firstChunkOffset) ||
+       (footerOffset >= fileSize))
+    {
+        return false;
+    }
+
+    _file.seekg(footerOffset);
+    if(IndexMagic != readString(_file, _filepath, IndexMagic.size()))
+    {
+        throw Pothos::DataFormatException(
+                  "Invalid capture file index",
+                  _filepath);
+    }
+
+    const auto numChunks = readValue<std::uint64_t>(_file, _filepath);
+    for(std::uint64_t chunkIndex = 0; chunkIndex < numChunks; ++chunkIndex)
+    {
+        CaptureFileChunk chunk;
+        chunk.firstSample = readValue<std::uint64_t>(_file, _filepath);
+        chunk.numSamples = readValue<std::uint64_t>(_file, _filepath);
+        chunk.offset = readValue<std::uint64_t>(_file, _filepath);
+        _chunks.emplace_back(std::move(chunk));
+    }
+
+    const auto numLabels = readValue<std::uint64_t>(_file, _filepath);
+    for(std::uint64_t labelIndex = 0; labelIndex < numLabels; ++labelIndex)
+    {
+        const auto index = readValue<std::uint64_t>(_file, _filepath);
+        const auto channel = readValue<std::uint32_t>(_file, _filepath);
+        const auto width = readValue<std::uint64_t>(_file, _filepath);
+        const auto id = readString(_file, _filepath, readValue<std::uint32_t>(_file, _filepath));
+        const auto data = deserializeLabelData(
+                              readString(_file, _filepath, readValue<std::uint32_t>(_file, _filepath)),
+                              _filepath);
+
+        _labels.emplace_back(StreamFileLabel{
+            static_cast<size_t>(index),
+            static_cast<size_t>(channel),
+            Pothos::Label(id, data, index, static_cast<size_t>(width))});
+    }
+
+    return true;
+}
+
+void CaptureFileReader::_scanChunks()
+{
+    _file.clear();
+    _file.seekg(0, std::ios::end);
+    const std::streamoff fileSize = _file.tellg();
+
+    std::streamoff offset = _firstChunkOffset;
+    while((offset + static_cast<std::streamoff>(ChunkHeaderSize)) <= fileSize)
+    {
+        _file.seekg(offset);
+        if(ChunkMagic != readString(_file, _filepath, ChunkMagic.size())) break;
+
+        CaptureFileChunk chunk;
+        chunk.firstSample = readValue<std::uint64_t>(_file, _filepath);
+        chunk.numSamples = readValue<std::uint64_t>(_file, _filepath);
+        chunk.offset = static_cast<std::uint64_t>(offset);
+
+        // Stop at a truncated chunk.
+        const auto chunkSize = static_cast<std::streamoff>(ChunkHeaderSize + (chunk.numSamples * _sampleSize));
+        if((offset + chunkSize) > fileSize) break;
+
+        _chunks.emplace_back(std::move(chunk));
+        offset += chunkSize;
+    }
+}
+
+std::vector<char> CaptureFileReader::_readChunk(const CaptureFileChunk& chunk)
+{
+    _file.clear();
+    _file.seekg(static_cast<std::streamoff>(chunk.offset));
+
+    const bool isValidHeader = (ChunkMagic == readString(_file, _filepath, ChunkMagic.size())) &&
+                               (chunk.firstSample == readValue<std::uint64_t>(_file, _filepath)) &&
+                               (chunk.numSamples == readValue<std::uint64_t>(_file, _filepath));
+    if(!isValidHeader)
+    {
+        throw Pothos::DataFormatException(
+                  Poco::format(
+                      "Invalid chunk header at offset %s",
+                      Poco::NumberFormatter::format(chunk.offset)),
+                  _filepath);
+    }
+
+    const auto expectedCRC = readValue<std::uint32_t>(_file, _filepath);
+
+    std::vector<char> payload(static_cast<size_t>(chunk.numSamples) * _sampleSize);
+    _file.read(payload.data(), static_cast<std::streamsize>(payload.size()));
+    if(!_file)
+    {
+        throw Pothos::ReadFileException(
+                  Poco::format(
+                      "Failed to read chunk at offset %s",
+                      Poco::NumberFormatter::format(chunk.offset)),
+                  _filepath);
+    }
+    if(expectedCRC != getCRC32(payload.data(), payload.size()))
+    {
+        throw Pothos::DataFormatException(
+                  Poco::format(
+                      "Checksum mismatch in chunk starting at sample %s",
+                      Poco::NumberFormatter::format(chunk.firstSample)),
+                  _filepath);
+    }
+
+    return payload;
+}
+
+//
+// CaptureFileWriter
+//
+
+template <typename T>
+static void writeValue(
+    std::ofstream& file,
+    const T& value)
+{
+    file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+static void writeString(
+    std::ofstream& file,
+    const std::string& str)
+{
+    file.write(str.data(), static_cast<std::streamsize>(str.size()));
+}
+
+CaptureFileWriter::CaptureFileWriter(
+    const std::string& filepath,
+    const std::vector<Pothos::DType>& dtypes,
+    size_t chunkSamples
+):
+    _file(filepath, std::ios::out | std::ios::binary | std::ios::trunc),
+    _filepath(filepath),
+    _dtypes(dtypes),
+    _chunkSamples(chunkSamples),
+    _pending(),
+    _pendingSamples(0),
+    _samplesWritten(0),
+    _chunks(),
+    _labels()
+{
+    if(_dtypes.empty() || (0 == _chunkSamples))
+    {
+        throw Pothos::InvalidArgumentException(
+                  "Capture files require at least one channel and a non-zero chunk size");
+    }
+    if(!_file)
+    {
+        throw Pothos::FileException(
+                  "Failed to open capture file for writing",
+                  _filepath);
+    }
+
+    writeString(_file, HeaderMagic);
+    writeValue(_file, static_cast<std::uint32_t>(_dtypes.size()));
+    writeValue(_file, static_cast<std::uint64_t>(_chunkSamples));
+    for(const auto& dtype: _dtypes)
+    {
+        writeValue(_file, static_cast<std::uint32_t>(dtype.name().size()));
+        writeString(_file, dtype.name());
+    }
+
+    for(const auto& dtype: _dtypes)
+    {
+        _pending.emplace_back();
+        _pending.back().reserve(_chunkSamples * dtype.size());
+    }
+}
+
+CaptureFileWriter::~CaptureFileWriter()
+{
+    try {this->close();}
+    catch(...) {}
+}
+
+void CaptureFileWriter::write(
+    const std::vector<const void*>& buffers,
+    size_t numSamples)
+{
+    if(buffers.size() != _dtypes.size())
+    {
+        throw Pothos::AssertionViolationException(
+                  "CaptureFileWriter::write() expects one buffer per channel",
+                  Poco::format(
+                      "Expected %s, got %s",
+                      Poco::NumberFormatter::format(_dtypes.size()),
+                      Poco::NumberFormatter::format(buffers.size())));
+    }
+
+    size_t samplesCopied = 0;
+    while(samplesCopied < numSamples)
+    {
+        const size_t numToCopy = std::min(
+                                     (numSamples - samplesCopied),
+                                     (_chunkSamples - _pendingSamples));
+        for(size_t chan = 0; chan < _dtypes.size(); ++chan)
+        {
+            const size_t elemSize = _dtypes[chan].size();
+            const auto* src = reinterpret_cast<const char*>(buffers[chan]) + (samplesCopied * elemSize);
+            _pending[chan].insert(
+                _pending[chan].end(),
+                src,
+                src + (numToCopy * elemSize));
+        }
+
+        _pendingSamples += numToCopy;
+        _samplesWritten += numToCopy;
+        samplesCopied += numToCopy;
+
+        if(_pendingSamples == _chunkSamples) this->_writeChunk();
+    }
+}
+
+void CaptureFileWriter::addLabel(
+    size_t channel,
+    const Pothos::Label& label)
+{
+    _labels.emplace_back(StreamFileLabel{
+        static_cast<size_t>(label.index),
+        channel,
+        label});
+}
+
+void CaptureFileWriter::close()
+{
+    if(!_file.is_open()) return;
+
+    if(_pendingSamples > 0) this->_writeChunk();
+    this->_writeFooter();
+
+    _file.close();
+}
+
+size_t CaptureFileWriter::samplesWritten() const
+{
+    return _samplesWritten;
+}
+
+void CaptureFileWriter::_writeChunk()
+{
+    std::vector<char> payload;
+    for(const auto& channel: _pending)
+    {
+        payload.insert(payload.end(), channel.begin(), channel.end());
+    }
+
+    CaptureFileChunk chunk;
+    chunk.firstSample = static_cast<std::uint64_t>(_samplesWritten - _pendingSamples);
+    chunk.numSamples = static_cast<std::uint64_t>(_pendingSamples);
+    chunk.offset = static_cast<std::uint64_t>(_file.tellp());
+
+    writeString(_file, ChunkMagic);
+    writeValue(_file, chunk.firstSample);
+    writeValue(_file, chunk.numSamples);
+    writeValue(_file, getCRC32(payload.data(), payload.size()));
+    _file.write(payload.data(), static_cast<std::streamsize>(payload.size()));
+    if(!_file)
+    {
+        throw Pothos::WriteFileException(
+                  "Failed to write capture file chunk",
+                  _filepath);
+    }
+
+    _chunks.emplace_back(std::move(chunk));
+
+    for(auto& channel: _pending) channel.clear();
+    _pendingSamples = 0;
+}
+
+void CaptureFileWriter::_writeFooter()
+{
+    std::stable_sort(
+        _labels.begin(),
+        _labels.end(),
+        [](const StreamFileLabel& label0, const StreamFileLabel& label1)
+        {
+            return (label0.index < label1.index);
+        });
+
+    const auto footerOffset = static_cast<std::uint64_t>(_file.tellp());
+
+    writeString(_file, IndexMagic);
+    writeValue(_file, static_cast<std::uint64_t>(_chunks.size()));
+    for(const auto& chunk: _chunks)
+    {
+        writeValue(_file, chunk.firstSample);
+        writeValue(_file, chunk.numSamples);
+        writeValue(_file, chunk.offset);
+    }
+
+    writeValue(_file, static_cast<std::uint64_t>(_labels.size()));
+    for(const auto& streamLabel: _labels)
+    {
+        const auto& label = streamLabel.label;
+        const auto data = serializeLabelData(label.data);
+
+        writeValue(_file, static_cast<std::uint64_t>(streamLabel.index));
+        writeValue(_file, static_cast<std::uint32_t>(streamLabel.channel));
+        writeValue(_file, static_cast<std::uint64_t>(label.width));
+        writeValue(_file, static_cast<std::uint32_t>(label.id.size()));
+        writeString(_file, label.id);
+        writeValue(_file, static_cast<std::uint32_t>(data.size()));
+        writeString(_file, data);
+    }
+
+    writeValue(_file, footerOffset);
+    writeString(_file, FooterMagic);
+    if(!_file)
+    {
+        throw Pothos::WriteFileException(
+                  "Failed to write capture file index",
+                  _filepath);
+    }
+}
@@ -0,0 +1,161 @@
+// Copyright (c) 2021 Nicholas Corgan
+// SPDX-License-Identifier: BSD-3-Clause
+
+#pragma once
+
+#include "StreamFileReader.hpp"
+
+#include <Pothos/Framework.hpp>
+
+#include <cstdint>
+#include <fstream>
+#include <ios>
+#include <string>
+#include <vector>
+
+//
+// PothosGPU capture files: a seekable container for multi-channel streams.
+//
+// Samples are stored in chunks of a fixed number of samples, each with a
+// CRC-32 of its payload. A footer index maps the first sample of each chunk
+// to its byte offset, so any sample can be reached with one seek. Labels are
+// stored in the footer with their absolute sample indices.
+//
+// Layout (all values native-endian):
+//
+// Header:
+//     (char[8] ) Magic ("PGPUCAP1")
+//     (uint32  ) Number of channels
+//     (uint64  ) Samples per chunk
+//     For each channel:
+//         (uint32  ) DType name length
+//         (char[]  ) DType name
+// For each chunk:
+//     (char[4] ) Magic ("CHNK")
+//     (uint64  ) First sample
+//     (uint64  ) Number of samples (only the last chunk may be short)
+//     (uint32  ) CRC-32 of the payload
+//     (T[]     ) Payload, one contiguous block per channel
+// Footer:
+//     (char[4] ) Magic ("INDX")
+//     (uint64  ) Number of chunks
+//     For each chunk:
+//         (uint64  ) First sample
+//         (uint64  ) Number of samples
+//         (uint64  ) Chunk offset
+//     (uint64  ) Number of labels
+//     For each label:
+//         (uint64  ) Sample index
+//         (uint32  ) Channel
+//         (uint64  ) Width
+//         (uint32  ) ID length
+//         (char[]  ) ID
+//         (uint32  ) Data length (0 for no data)
+//         (char[]  ) Data, as a serialized Pothos::Object
+//     (uint64  ) Footer offset
+//     (char[8] ) Magic ("PGPUIDX2")
+//
+// A file without a footer (e.g. from an interrupted capture) is still
+// readable. The index is rebuilt by walking the chunk headers, and the labels
+// are lost.
+//
+
+bool isCaptureFile(const std::string& filepath);
+
+struct CaptureFileChunk
+{
+    std::uint64_t firstSample;
+    std::uint64_t numSamples;
+    std::uint64_t offset;
+};
+
+class CaptureFileReader: public StreamFileReader
+{
+    public:
+        CaptureFileReader(const std::string& filepath);
+
+        virtual ~CaptureFileReader() = default;
+
+        size_t numChannels() const override;
+
+        Pothos::DType dtype(size_t chan) const override;
+
+        size_t numSamples() const override;
+
+        size_t preferredReadSamples(size_t maxBytes) const override;
+
+        // Every chunk touched is read in full and its checksum verified.
+        // Throws Pothos::DataFormatException on a checksum mismatch.
+        void read(
+            size_t startSample,
+            size_t numSamples,
+            const std::vector<void*>& channels) override;
+
+        std::vector<StreamFileLabel> labels() const override;
+
+        size_t chunkSamples() const;
+
+        const std::vector<CaptureFileChunk>& chunks() const;
+
+    private:
+        std::string _filepath;
+        std::ifstream _file;
+
+        std::vector<Pothos::DType> _dtypes;
+        size_t _sampleSize;
+        size_t _chunkSamples;
+        std::streamoff _firstChunkOffset;
+
+        std::vector<CaptureFileChunk> _chunks;
+        std::vector<StreamFileLabel> _labels;
+        size_t _numSamples;
+
+        bool _readFooter();
+
+        void _scanChunks();
+
+        std::vector<char> _readChunk(const CaptureFileChunk& chunk);
+};
+
+class CaptureFileWriter
+{
+    public:
+        CaptureFileWriter(
+            const std::string& filepath,
+            const std::vector<Pothos::DType>& dtypes,
+            size_t chunkSamples);
+
+        // Calls close().
+        virtual ~CaptureFileWriter();
+
+        // Expects one buffer per channel, each holding the same number of
+        // samples. Full chunks are written as soon as they are available.
+        void write(const std::vector<const void*>& buffers, size_t numSamples);
+
+        // Label indices are absolute sample indices.
+        void addLabel(
+            size_t channel,
+            const Pothos::Label& label);
+
+        // Writes any partial chunk and the footer.
+        void close();
+
+        size_t samplesWritten() const;
+
+    private:
+        std::ofstream _file;
+        std::string _filepath;
+        std::vector<Pothos::DType> _dtypes;
+        size_t _chunkSamples;
+
+        std::vector<std::vector<char>> _pending;
+        size_t _pendingSamples;
+        size_t _samplesWritten;
+
+        std::vector<CaptureFileChunk> _chunks;
+        std::vector<StreamFileLabel> _labels;
+
+        void _writeChunk();
+
+        void _writeFooter();
+};
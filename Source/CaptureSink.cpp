@@ -0,0 +1,231 @@
+// Copyright (c) 2021 Nicholas Corgan
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "ArrayFireBlock.hpp"
+#include "CaptureFile.hpp"
+#include "DeviceCache.hpp"
+
+#include <Pothos/Exception.hpp>
+#include <Pothos/Framework.hpp>
+
+#include <Poco/File.h>
+#include <Poco/Path.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+class CaptureSinkBlock: public ArrayFireBlock
+{
+    public:
+        static Pothos::Block* make(
+            const std::string& filepath,
+            const Pothos::DType& dtype,
+            size_t numChannels,
+            size_t chunkSamples)
+        {
+            return new CaptureSinkBlock(
+                           filepath,
+                           std::vector<Pothos::DType>(numChannels, dtype),
+                           chunkSamples);
+        }
+
+        // One channel per data type
+        static Pothos::Block* makeFromDTypes(
+            const std::string& filepath,
+            const std::vector<Pothos::DType>& dtypes,
+            size_t chunkSamples)
+        {
+            return new CaptureSinkBlock(filepath, dtypes, chunkSamples);
+        }
+
+        CaptureSinkBlock(
+            const std::string& filepath,
+            const std::vector<Pothos::DType>& dtypes,
+            size_t chunkSamples
+        ):
+            ArrayFireBlock(getCPUOrBestDevice()),
+            _filepath(filepath),
+            _dtypes(dtypes),
+            _chunkSamples(chunkSamples),
+            _writer()
+        {
+            if(_dtypes.empty())
+            {
+                throw Pothos::InvalidArgumentException("numChannels must be non-zero");
+            }
+            if(0 == _chunkSamples)
+            {
+                throw Pothos::InvalidArgumentException("chunkSamples must be non-zero");
+            }
+
+            const Poco::File pocoFile(_filepath);
+            if(pocoFile.exists())
+            {
+                if(!pocoFile.isFile())
+                {
+                    throw Pothos::FileException(
+                            "This path is valid but does not correspond to a regular file.",
+                            _filepath);
+                }
+                if(!pocoFile.canWrite())
+                {
+                    throw Pothos::FileReadOnlyException(_filepath);
+                }
+            }
+            else
+            {
+                auto parentDirFile = Poco::File(Poco::Path(pocoFile.path()).parent());
+                if(!parentDirFile.canWrite())
+                {
+                    throw Pothos::FileAccessDeniedException(
+                              "Cannot write a file to the parent directory",
+                              _filepath);
+                }
+            }
+
+            for(size_t chan = 0; chan < _dtypes.size(); ++chan)
+            {
+                this->setupInput(chan, _dtypes[chan], _domain);
+            }
+
+            this->registerCall(this, POTHOS_FCN_TUPLE(CaptureSinkBlock, filepath));
+            this->registerCall(this, POTHOS_FCN_TUPLE(CaptureSinkBlock, chunkSamples));
+            this->registerCall(this, POTHOS_FCN_TUPLE(CaptureSinkBlock, samplesWritten));
+        }
+
+        std::string filepath() const
+        {
+            return _filepath;
+        }
+
+        size_t chunkSamples() const
+        {
+            return _chunkSamples;
+        }
+
+        size_t samplesWritten() const
+        {
+            return _writer ? _writer->samplesWritten() : 0;
+        }
+
+        void activate() override
+        {
+            ArrayFireBlock::activate();
+
+            _writer.reset(new CaptureFileWriter(
+                              _filepath,
+                              _dtypes,
+                              _chunkSamples));
+        }
+
+        void deactivate() override
+        {
+            ArrayFireBlock::deactivate();
+
+            if(_writer)
+            {
+                // Writes the last partial chunk and the index.
+                _writer->close();
+                _writer.reset();
+            }
+        }
+
+        void work() override
+        {
+            const auto elems = this->workInfo().minInElements;
+            if(0 == elems)
+            {
+                return;
+            }
+
+            // Only samples received on all channels are written.
+            const auto& inputs = this->inputs();
+            const size_t firstSample = _writer->samplesWritten();
+
+            std::vector<const void*> buffers;
+            for(size_t chan = 0; chan < inputs.size(); ++chan)
+            {
+                buffers.emplace_back(inputs[chan]->buffer().as<const void*>());
+
+                for(const auto& label: inputs[chan]->labels())
+                {
+                    if(label.index >= elems) break;
+
+                    auto absLabel = label;
+                    absLabel.index += firstSample;
+                    _writer->addLabel(chan, absLabel);
+                }
+            }
+
+            _writer->write(buffers, elems);
+
+            for(auto* input: inputs)
+            {
+                input->consume(elems);
+            }
+        }
+
+    private:
+        std::string _filepath;
+        std::vector<Pothos::DType> _dtypes;
+        size_t _chunkSamples;
+
+        std::unique_ptr<CaptureFileWriter> _writer;
+};
+
+/*
+ * |PothosDoc PothosGPU Capture Sink
+ *
+ * Records a multi-channel stream to a PothosGPU capture file, which
+ * <b>/gpu/array/file_source</b> can play back.
+ *
+ * Unlike ArrayFire binaries, capture files are indexed for random access.
+ * Samples are stored in fixed-size chunks, each with a CRC-32 checksum, and
+ * an index at the end of the file maps each chunk's first sample to its
+ * location in the file. Labels received on any channel are stored in the
+ * index with their absolute sample positions, and their data keeps its type.
+ * If a capture is interrupted before the index is written, all complete chunks
+ * are still readable.
+ *
+ * Only samples received on all channels are written. Each channel's data type
+ * is stored in the file, so channels may have different types when the block is
+ * created with a list of data types instead of a data type and channel count.
+ *
+ * |category /GPU/File IO
+ * |category /File IO
+ * |category /Sinks
+ * |keywords array file sink io capture record seek index
+ * |factory /gpu/array/capture_sink(filepath,dtype,numChannels,chunkSamples)
+ *
+ * |param filepath[Filepath] The path of the capture file. Any existing file is overwritten.
+ * |widget FileEntry(mode=save)
+ * |default ""
+ * |preview enable
+ *
+ * |param dtype[Data Type] The input data type.
+ * |widget DTypeChooser(int=1,uint=1,float=1,cfloat=1)
+ * |default "complex_float32"
+ * |preview disable
+ *
+ * |param numChannels[Num Channels] The number of channels.
+ * |widget SpinBox(minimum=1)
+ * |default 1
+ * |preview disable
+ *
+ * |param chunkSamples[Chunk Samples] The number of samples per channel in each chunk.
+ * Seeking reads at most one chunk that isn't played back, so smaller chunks make seeking
+ * cheaper at the cost of a larger index.
+ * |widget SpinBox(minimum=1)
+ * |default 65536
+ * |units samples
+ * |preview enable
+ */
+static Pothos::BlockRegistry registerCaptureSink(
+    "/gpu/array/capture_sink",
+    Pothos::Callable(&CaptureSinkBlock::make));
+
+// Registered at the same path, for channels of different types
+static Pothos::BlockRegistry registerCaptureSinkFromDTypes(
+    "/gpu/array/capture_sink",
+    Pothos::Callable(&CaptureSinkBlock::makeFromDTypes));
@@ -1,4 +1,4 @@
-// Copyright (c) 2019-2020 Nicholas Corgan
+// Copyright (c) 2019-2021 Nicholas Corgan
 // SPDX-License-Identifier: BSD-3-Clause
 
 #include "OneToOneBlock.hpp"
@@ -67,6 +67,8 @@ class Clamp: public OneToOneBlock
             validateMinMax(minValue, maxValue());
 
             _afMinValue = PothosToAF<T>::to(minValue);
+            _afMinValueArray = af::array();
+
             this->emitSignal("minValueChanged", minValue);
         }
 
@@ -80,6 +82,8 @@ class Clamp: public OneToOneBlock
             validateMinMax(minValue(), maxValue);
 
             _afMaxValue = PothosToAF<T>::to(maxValue);
+            _afMaxValueArray = af::array();
+
             this->emitSignal("maxValueChanged", maxValue);
         }
 
@@ -89,6 +93,13 @@ class Clamp: public OneToOneBlock
         AFType _afMinValue;
         AFType _afMaxValue;
 
+        // Only used by types without a scalar af::clamp overload. These are
+        // reset by the setters and regenerated when the buffer size changes.
+        af::array _afMinValueArray;
+        af::array _afMaxValueArray;
+
+        void _updateBoundaryArrays(size_t elems);
+
         void validateMinMax(const T& min, const T& max)
         {
             if(min > max)
@@ -112,6 +123,23 @@ const Pothos::DType Clamp<T>::dtype = Pothos::DType(typeid(T));
  * overload for scalar boundaries, despite supporting all types.
  */
 
+template <typename T>
+void Clamp<T>::_updateBoundaryArrays(size_t elems)
+{
+    static const af::dtype afDType = Pothos::Object(dtype).convert<af::dtype>();
+
+    if(static_cast<size_t>(_afMinValueArray.elements()) != elems)
+    {
+        _afMinValueArray = af::constant(_afMinValue, elems, afDType);
+        _afMinValueArray.eval();
+    }
+    if(static_cast<size_t>(_afMaxValueArray.elements()) != elems)
+    {
+        _afMaxValueArray = af::constant(_afMaxValue, elems, afDType);
+        _afMaxValueArray.eval();
+    }
+}
+
 template <typename T>
 void Clamp<T>::work()
 {
@@ -121,13 +149,10 @@ void Clamp<T>::work()
         return;
     }
 
-    static const af::dtype afDType = Pothos::Object(dtype).convert<af::dtype>();
-
-    auto afArrayMinValue = af::constant(_afMinValue, elems, afDType);
-    auto afArrayMaxValue = af::constant(_afMaxValue, elems, afDType);
+    this->_updateBoundaryArrays(elems);
 
     auto afInput = this->getInputPortAsAfArray(0);
-    auto afOutput = af::clamp(afInput, afArrayMinValue, afArrayMaxValue);
+    auto afOutput = af::clamp(afInput, _afMinValueArray, _afMaxValueArray);
     this->produceFromAfArray(0, afOutput);
 };
 
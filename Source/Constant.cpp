@@ -1,4 +1,4 @@
-// Copyright (c) 2019-2020 Nicholas Corgan
+// Copyright (c) 2019-2021 Nicholas Corgan
 // SPDX-License-Identifier: BSD-3-Clause
 
 #include "ArrayFireBlock.hpp"
@@ -26,7 +26,8 @@ class Constant: public ArrayFireBlock
             size_t dtypeDims
         ):
             ArrayFireBlock(device),
-            _afDType(Pothos::Object(Class::dtype).convert<af::dtype>())
+            _afDType(Pothos::Object(Class::dtype).convert<af::dtype>()),
+            _afConstantArray()
         {
             this->registerCall(this, POTHOS_FCN_TUPLE(Class, constant));
             this->registerCall(this, POTHOS_FCN_TUPLE(Class, setConstant));
@@ -49,10 +50,17 @@ class Constant: public ArrayFireBlock
             {
                 return;
             }
-            
-            this->produceFromAfArray(
-                0,
-                af::constant(_constant, elems, _afDType));
+
+            this->configArrayFire();
+
+            // Only refill the device buffer when the size or value changes.
+            if(static_cast<size_t>(_afConstantArray.elements()) != elems)
+            {
+                _afConstantArray = af::constant(_constant, elems, _afDType);
+                _afConstantArray.eval();
+            }
+
+            this->produceFromAfArray(0, _afConstantArray);
         }
 
         T constant() const
@@ -63,6 +71,8 @@ class Constant: public ArrayFireBlock
         void setConstant(const T& constant)
         {
             _constant = PothosToAF<T>::to(constant);
+            _afConstantArray = af::array();
+
             this->emitSignal("constantChanged", constant);
         }
 
@@ -72,6 +82,8 @@ class Constant: public ArrayFireBlock
 
         typename PothosToAF<T>::type _constant;
         af::dtype _afDType;
+
+        af::array _afConstantArray;
 };
 
 template <typename T>
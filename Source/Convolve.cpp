@@ -1,4 +1,4 @@
-// Copyright (c) 2019-2020 Nicholas Corgan
+// Copyright (c) 2019-2021 Nicholas Corgan
 // SPDX-License-Identifier: BSD-3-Clause
 
 #include "OneToOneBlock.hpp"
@@ -61,6 +61,9 @@ class ConvolveBaseBlock: public OneToOneBlock
             // Emit the initial signals.
             this->setTaps(_taps);
             this->setMode(_convMode);
+
+            // Depending on the mode, outputs depend on inputs on both sides.
+            _canShard = false;
         }
 
         virtual ~ConvolveBaseBlock() = default;
@@ -120,6 +123,16 @@ class ConvolveBaseBlock: public OneToOneBlock
             OneToOneBlock::work();
         }
 
+    protected:
+        // The bound taps live on the block's device.
+        Pothos::Callable shardFunc() const override
+        {
+            auto func = _func;
+            func.bind(Pothos::Object(_taps).convert<af::array>(), 1);
+
+            return func;
+        }
+
     private:
         std::vector<TapType> _taps;
         af::convMode _convMode;
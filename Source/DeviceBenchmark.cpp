@@ -0,0 +1,121 @@
+// Copyright (c) 2021 Nicholas Corgan
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "DeviceBenchmark.hpp"
+#include "DeviceThreads.hpp"
+
+#include <Poco/Environment.h>
+#include <Poco/Format.h>
+#include <Poco/Logger.h>
+#include <Poco/NumberParser.h>
+
+#include <arrayfire.h>
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <limits>
+#include <vector>
+
+// Large enough to reach steady-state throughput on discrete GPUs, small
+// enough to finish quickly on the CPU.
+static constexpr dim_t BenchmarkElements = 1 << 22;
+static constexpr size_t BenchmarkIterations = 5;
+
+bool deviceBenchmarkEnabled()
+{
+    unsigned value = 0;
+    return Poco::NumberParser::tryParseUnsigned(Poco::Environment::get("POTHOSGPU_BENCHMARK_DEVICES", "0"), value) &&
+           (value > 0);
+}
+
+// Returns the fastest run, after a warmup run, in seconds.
+static double timeBest(const std::function<void()>& func)
+{
+    using Clock = std::chrono::steady_clock;
+
+    func();
+    af::sync();
+
+    double best = std::numeric_limits<double>::max();
+    for(size_t iteration = 0; iteration < BenchmarkIterations; ++iteration)
+    {
+        const auto start = Clock::now();
+        func();
+        af::sync();
+        const std::chrono::duration<double> elapsed = Clock::now() - start;
+
+        best = std::min(best, elapsed.count());
+    }
+
+    return std::max(best, std::numeric_limits<double>::min());
+}
+
+void benchmarkDevice(DeviceCacheEntry& entry)
+{
+    setThreadBackendAndDevice(entry.afBackendEnum, entry.afDeviceIndex);
+
+    static constexpr double elements = static_cast<double>(BenchmarkElements);
+    static constexpr double bytes = elements * sizeof(float);
+
+    std::vector<float> hostBuffer(static_cast<size_t>(BenchmarkElements), 1.0f);
+    af::array afArray(BenchmarkElements, hostBuffer.data());
+
+    const double h2dSecs = timeBest([&]()
+    {
+        af::array uploaded(BenchmarkElements, hostBuffer.data());
+        uploaded.eval();
+    });
+    const double d2hSecs = timeBest([&]()
+    {
+        afArray.host(hostBuffer.data());
+    });
+    const double elementwiseSecs = timeBest([&]()
+    {
+        af::array output = (afArray * 2.0f) + 1.0f;
+        output.eval();
+    });
+    const double fftSecs = timeBest([&]()
+    {
+        af::array output = af::fft(afArray);
+        output.eval();
+    });
+
+    entry.h2dGBPerSec = (bytes / h2dSecs) / 1e9;
+    entry.d2hGBPerSec = (bytes / d2hSecs) / 1e9;
+    entry.elementwiseGElemsPerSec = (elements / elementwiseSecs) / 1e9;
+    entry.fftMSamplesPerSec = (elements / fftSecs) / 1e6;
+
+    poco_information(
+        Poco::Logger::get("PothosGPU"),
+        Poco::format(
+            "Benchmarked %s: H2D %.2f GB/s, D2H %.2f GB/s, elementwise %.2f GElem/s, FFT %.2f MSamples/s",
+            entry.name,
+            entry.h2dGBPerSec,
+            entry.d2hGBPerSec,
+            entry.elementwiseGElemsPerSec,
+            entry.fftMSamplesPerSec));
+}
+
+bool isDeviceBenchmarked(const DeviceCacheEntry& entry)
+{
+    return (entry.h2dGBPerSec > 0.0) &&
+           (entry.d2hGBPerSec > 0.0) &&
+           (entry.elementwiseGElemsPerSec > 0.0) &&
+           (entry.fftMSamplesPerSec > 0.0);
+}
+
+double deviceScore(const DeviceCacheEntry& entry)
+{
+    if(!isDeviceBenchmarked(entry)) return 0.0;
+
+    static constexpr double bytesPerElement = sizeof(float);
+
+    // Seconds per element for each stage
+    const double secsPerElement = (bytesPerElement / (entry.h2dGBPerSec * 1e9)) +
+                                  (1.0 / (entry.elementwiseGElemsPerSec * 1e9)) +
+                                  (1.0 / (entry.fftMSamplesPerSec * 1e6)) +
+                                  (bytesPerElement / (entry.d2hGBPerSec * 1e9));
+
+    return 1.0 / secsPerElement;
+}
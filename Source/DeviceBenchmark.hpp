@@ -0,0 +1,27 @@
+// Copyright (c) 2021 Nicholas Corgan
+// SPDX-License-Identifier: BSD-3-Clause
+
+#pragma once
+
+#include "DeviceCache.hpp"
+
+//
+// Device enumeration order says nothing about speed, so "Auto" can pick a
+// slow device on a host with several. If POTHOSGPU_BENCHMARK_DEVICES is set
+// to a non-zero value, each device is benchmarked once when devices are
+// enumerated, with the results stored in the device cache file, and Auto
+// placement prefers the devices with the best score.
+//
+
+bool deviceBenchmarkEnabled();
+
+// Fills in the entry's benchmark fields. Switches the calling thread's
+// backend and device.
+void benchmarkDevice(DeviceCacheEntry& entry);
+
+bool isDeviceBenchmarked(const DeviceCacheEntry& entry);
+
+// Elements per second for a streaming float32 workload that uploads,
+// applies an elementwise operation and an FFT, and downloads, or 0 if the
+// device hasn't been benchmarked
+double deviceScore(const DeviceCacheEntry& entry);
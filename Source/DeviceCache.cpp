@@ -1,19 +1,35 @@
-// Copyright (c) 2019-2020 Nicholas Corgan
+// Copyright (c) 2019-2021 Nicholas Corgan
 // SPDX-License-Identifier: BSD-3-Clause
 
+#include "DeviceBenchmark.hpp"
 #include "DeviceCache.hpp"
+#include "DeviceThreads.hpp"
+#include "MemoryManager.hpp"
 #include "Utility.hpp"
 
 #include <Pothos/Managed.hpp>
 #include <Pothos/Object.hpp>
 #include <Pothos/Plugin.hpp>
+#include <Pothos/System/Paths.hpp>
 
+#include <nlohmann/json.hpp>
+
+#include <Poco/Environment.h>
+#include <Poco/File.h>
 #include <Poco/Format.h>
 #include <Poco/Logger.h>
+#include <Poco/Path.h>
+#include <Poco/Process.h>
 #include <Poco/RegularExpression.h>
 
 #include <algorithm>
+#include <cstdint>
+#include <fstream>
 #include <sstream>
+#include <string>
+#include <vector>
+
+using json = nlohmann::json;
 
 static Poco::Logger& getLogger()
 {
@@ -98,7 +114,7 @@ static std::vector<af::Backend> _getAvailableBackends()
         {
             if(::AF_BACKEND_CUDA == backend)
             {
-                af::setBackend(backend);
+                setThreadBackend(backend);
                 if(af::getDeviceCount() > 0)
                 {
                     static constexpr size_t bufferLen = 1024;
@@ -124,13 +140,13 @@ static std::vector<af::Backend> _getAvailableBackends()
     return availableBackends;
 }
 
-static std::vector<DeviceCacheEntry> _getDeviceCache()
+static std::vector<DeviceCacheEntry> _getDeviceCache(const std::vector<af::Backend>& availableBackends)
 {
     std::vector<DeviceCacheEntry> deviceCache;
 
-    for(const auto& backend: getAvailableBackends())
+    for(const auto& backend: availableBackends)
     {
-        af::setBackend(backend);
+        setThreadBackend(backend);
 
         // For current backend
         const int numDevices = af::getDeviceCount();
@@ -142,7 +158,7 @@ static std::vector<DeviceCacheEntry> _getDeviceCache()
             char platform[bufferLen] = {0};
             char toolkit[bufferLen] = {0};
             char compute[bufferLen] = {0};
-            af::setDevice(devIndex);
+            setThreadBackendAndDevice(backend, devIndex);
             af::deviceInfo(name, platform, toolkit, compute);
 
             DeviceCacheEntry deviceCacheEntry =
@@ -154,7 +170,12 @@ static std::vector<DeviceCacheEntry> _getDeviceCache()
                 af::getMemStepSize(),
 
                 backend,
-                devIndex
+                devIndex,
+
+                0.0,
+                0.0,
+                0.0,
+                0.0
             };
 
             // ArrayFire only returns the vendor for CPU entry names, so if
@@ -191,20 +212,338 @@ static std::vector<DeviceCacheEntry> _getDeviceCache()
     return deviceCache;
 }
 
-const std::vector<af::Backend>& getAvailableBackends()
+//
+// Enumerating devices initializes every backend and queries every device,
+// which can take seconds, so this is only done on first use, and the
+// results are stored on disk. The stored results are used as long as the
+// ArrayFire version, available backends, and driver versions match. None of
+// these require initializing a backend. After changing hardware without
+// changing drivers, delete the file.
+//
+// The file is stored in the user's Pothos data directory, or at
+// POTHOSGPU_DEVICE_CACHE_FILE if set. Setting it to an empty string
+// disables the file.
+//
+
+struct DeviceEnumeration
+{
+    std::vector<af::Backend> availableBackends;
+    std::vector<DeviceCacheEntry> deviceCache;
+};
+
+std::string getDeviceCacheFilepath()
+{
+    static const std::string EnvVar = "POTHOSGPU_DEVICE_CACHE_FILE";
+    if(Poco::Environment::has(EnvVar)) return Poco::Environment::get(EnvVar);
+
+    Poco::Path path(Pothos::System::getUserDataPath());
+    path.makeDirectory();
+    path.pushDirectory("PothosGPU");
+    path.setFileName("DeviceCache.json");
+
+    return path.toString();
+}
+
+// Only what the OS exposes through files is used, since asking a driver
+// for its version means initializing it. Where these files don't exist,
+// only the ArrayFire version and backends are checked.
+static json getDriverVersions()
+{
+    json driverVersions = json::object();
+
+    // Only the first line has the version. GPUs are listed by PCI address.
+    std::ifstream nvidiaVersionFile("/proc/driver/nvidia/version");
+    std::string nvidiaVersion;
+    if(nvidiaVersionFile && std::getline(nvidiaVersionFile, nvidiaVersion))
+    {
+        driverVersions["NVIDIA"] = nvidiaVersion;
+    }
+
+    const auto listDirectory = [](const std::string& path)
+    {
+        std::vector<Poco::File> files;
+        const Poco::File directory(path);
+        if(directory.exists() && directory.isDirectory()) directory.list(files);
+
+        return files;
+    };
+
+    json nvidiaGPUs = json::array();
+    for(const auto& gpuDirectory: listDirectory("/proc/driver/nvidia/gpus"))
+    {
+        nvidiaGPUs.push_back(Poco::Path(gpuDirectory.path()).getFileName());
+    }
+    if(!nvidiaGPUs.empty()) driverVersions["NVIDIA GPUs"] = nvidiaGPUs;
+
+    // Installing or upgrading an OpenCL driver writes its ICD file.
+    json openCLICDs = json::object();
+    for(const auto& icdFile: listDirectory("/etc/OpenCL/vendors"))
+    {
+        openCLICDs[Poco::Path(icdFile.path()).getFileName()] = static_cast<std::int64_t>(icdFile.getLastModified().epochTime());
+    }
+    if(!openCLICDs.empty()) driverVersions["OpenCL ICDs"] = openCLICDs;
+
+    return driverVersions;
+}
+
+static json getDeviceCacheKey()
+{
+    int major = 0, minor = 0, patch = 0;
+    ::af_get_version(&major, &minor, &patch);
+
+    json key;
+    key["ArrayFire Version"] = Poco::format("%d.%d.%d (%s)", major, minor, patch, std::string(::af_get_revision()));
+    key["Available Backends"] = af::getAvailableBackends();
+    key["Drivers"] = getDriverVersions();
+
+    return key;
+}
+
+static json deviceEnumerationToJSON(
+    const json& key,
+    const DeviceEnumeration& deviceEnumeration)
+{
+    json topObject;
+    topObject["Key"] = key;
+
+    auto& backendsJSON = topObject["Backends"];
+    backendsJSON = json::array();
+    for(const auto& backend: deviceEnumeration.availableBackends)
+    {
+        backendsJSON.push_back(static_cast<int>(backend));
+    }
+
+    auto& devicesJSON = topObject["Devices"];
+    devicesJSON = json::array();
+    for(const auto& entry: deviceEnumeration.deviceCache)
+    {
+        json entryJSON;
+        entryJSON["Name"] = entry.name;
+        entryJSON["Platform"] = entry.platform;
+        entryJSON["Toolkit"] = entry.toolkit;
+        entryJSON["Compute"] = entry.compute;
+        entryJSON["Memory Step Size"] = entry.memoryStepSize;
+        entryJSON["Backend"] = static_cast<int>(entry.afBackendEnum);
+        entryJSON["Device Index"] = entry.afDeviceIndex;
+
+        if(isDeviceBenchmarked(entry))
+        {
+            entryJSON["H2D Bandwidth (GB/s)"] = entry.h2dGBPerSec;
+            entryJSON["D2H Bandwidth (GB/s)"] = entry.d2hGBPerSec;
+            entryJSON["Elementwise Throughput (GElem/s)"] = entry.elementwiseGElemsPerSec;
+            entryJSON["FFT Throughput (MSamples/s)"] = entry.fftMSamplesPerSec;
+        }
+
+        devicesJSON.push_back(entryJSON);
+    }
+
+    return topObject;
+}
+
+static bool loadDeviceEnumeration(
+    const std::string& filepath,
+    const json& key,
+    DeviceEnumeration& deviceEnumerationOut)
+{
+    std::ifstream stream(filepath);
+    if(!stream) return false;
+
+    try
+    {
+        const auto topObject = json::parse(stream);
+        if(topObject.at("Key") != key) return false;
+
+        DeviceEnumeration deviceEnumeration;
+        for(const auto& backendJSON: topObject.at("Backends"))
+        {
+            deviceEnumeration.availableBackends.emplace_back(static_cast<af::Backend>(backendJSON.get<int>()));
+        }
+        for(const auto& entryJSON: topObject.at("Devices"))
+        {
+            DeviceCacheEntry entry =
+            {
+                entryJSON.at("Name").get<std::string>(),
+                entryJSON.at("Platform").get<std::string>(),
+                entryJSON.at("Toolkit").get<std::string>(),
+                entryJSON.at("Compute").get<std::string>(),
+                entryJSON.at("Memory Step Size").get<size_t>(),
+
+                static_cast<af::Backend>(entryJSON.at("Backend").get<int>()),
+                entryJSON.at("Device Index").get<int>(),
+
+                // Not present if the benchmark hasn't been run
+                entryJSON.value("H2D Bandwidth (GB/s)", 0.0),
+                entryJSON.value("D2H Bandwidth (GB/s)", 0.0),
+                entryJSON.value("Elementwise Throughput (GElem/s)", 0.0),
+                entryJSON.value("FFT Throughput (MSamples/s)", 0.0)
+            };
+            deviceEnumeration.deviceCache.emplace_back(std::move(entry));
+        }
+
+        deviceEnumerationOut = std::move(deviceEnumeration);
+    }
+    catch(const std::exception& ex)
+    {
+        poco_warning_f2(
+            getLogger(),
+            "Ignoring invalid device cache file %s: %s",
+            filepath,
+            std::string(ex.what()));
+
+        return false;
+    }
+
+    return true;
+}
+
+static void saveDeviceEnumeration(
+    const std::string& filepath,
+    const json& key,
+    const DeviceEnumeration& deviceEnumeration)
+{
+    try
+    {
+        Poco::File(Poco::Path(filepath).parent()).createDirectories();
+
+        // Write to a temporary file first, so other processes never read a
+        // partial file.
+        const auto tempFilepath = Poco::format("%s.%s", filepath, std::to_string(Poco::Process::id()));
+        std::ofstream stream(tempFilepath);
+        stream << deviceEnumerationToJSON(key, deviceEnumeration).dump(4);
+        stream.close();
+
+        if(stream) Poco::File(tempFilepath).renameTo(filepath);
+        else       Poco::File(tempFilepath).remove();
+    }
+    catch(const Poco::Exception& ex)
+    {
+        poco_warning_f2(
+            getLogger(),
+            "Failed to write device cache file %s: %s",
+            filepath,
+            ex.displayText());
+    }
+}
+
+// Returns whether the stored devices were used.
+static bool loadOrEnumerateDevices(
+    const std::string& filepath,
+    const json& key,
+    DeviceEnumeration& deviceEnumerationOut)
+{
+    if(!filepath.empty() && loadDeviceEnumeration(filepath, key, deviceEnumerationOut))
+    {
+        return true;
+    }
+
+    deviceEnumerationOut.availableBackends = _getAvailableBackends();
+    deviceEnumerationOut.deviceCache = _getDeviceCache(deviceEnumerationOut.availableBackends);
+
+    return false;
+}
+
+bool loadOrEnumerateDeviceCache(
+    const std::string& filepath,
+    std::vector<DeviceCacheEntry>& deviceCacheOut)
+{
+    const auto key = getDeviceCacheKey();
+
+    DeviceEnumeration deviceEnumeration;
+    const bool loaded = loadOrEnumerateDevices(filepath, key, deviceEnumeration);
+    if(!loaded && !deviceEnumeration.deviceCache.empty())
+    {
+        saveDeviceEnumeration(filepath, key, deviceEnumeration);
+    }
+
+    deviceCacheOut = std::move(deviceEnumeration.deviceCache);
+
+    return loaded;
+}
+
+static DeviceEnumeration enumerateDevices()
+{
+    const auto filepath = getDeviceCacheFilepath();
+    const auto key = filepath.empty() ? json() : getDeviceCacheKey();
+
+    DeviceEnumeration deviceEnumeration;
+    bool changed = !loadOrEnumerateDevices(filepath, key, deviceEnumeration) &&
+                   !deviceEnumeration.deviceCache.empty();
+
+    // This is the first thing anything using ArrayFire calls, so install
+    // the memory managers before any arrays are allocated.
+    installMemoryManagers(deviceEnumeration.availableBackends);
+
+    // Benchmark results are stored with the rest of the cache, so this only
+    // runs for devices that haven't been benchmarked on this machine.
+    if(deviceBenchmarkEnabled())
+    {
+        for(auto& entry: deviceEnumeration.deviceCache)
+        {
+            if(isDeviceBenchmarked(entry)) continue;
+
+            try
+            {
+                benchmarkDevice(entry);
+                changed = true;
+            }
+            catch(const af::exception& ex)
+            {
+                poco_warning_f2(
+                    getLogger(),
+                    "Failed to benchmark %s: %s",
+                    entry.name,
+                    std::string(ex.what()));
+            }
+        }
+    }
+
+    if(changed && !filepath.empty())
+    {
+        saveDeviceEnumeration(filepath, key, deviceEnumeration);
+    }
+
+    return deviceEnumeration;
+}
+
+static const DeviceEnumeration& getDeviceEnumeration()
 {
     // Only do this once
-    static const std::vector<af::Backend> availableBackends = _getAvailableBackends();
+    static const DeviceEnumeration deviceEnumeration = enumerateDevices();
 
-    return availableBackends;
+    return deviceEnumeration;
+}
+
+const std::vector<af::Backend>& getAvailableBackends()
+{
+    return getDeviceEnumeration().availableBackends;
 }
 
 const std::vector<DeviceCacheEntry>& getDeviceCache()
 {
-    // Only do this once
-    static const std::vector<DeviceCacheEntry> deviceCache = _getDeviceCache();
+    return getDeviceEnumeration().deviceCache;
+}
 
-    return deviceCache;
+const DeviceCacheEntry& getDeviceCacheEntry(const std::string& device)
+{
+    const auto& deviceCache = getDeviceCache();
+
+    auto deviceCacheIter = std::find_if(
+                               deviceCache.begin(),
+                               deviceCache.end(),
+                               [&device](const DeviceCacheEntry& entry)
+                               {
+                                   return (entry.name == device) ||
+                                          (Poco::format("%s:%d", entry.platform, entry.afDeviceIndex) == device);
+                               });
+    if(deviceCache.end() == deviceCacheIter)
+    {
+        throw Pothos::InvalidArgumentException(
+                  Poco::format(
+                      "Could not find ArrayFire device %s.",
+                      device));
+    }
+
+    return *deviceCacheIter;
 }
 
 std::string getAnyDeviceWithBackend(af::Backend backend)
@@ -241,12 +580,6 @@ std::string getCPUOrBestDevice()
     return device;
 }
 
-// Force device caching on init
-pothos_static_block(arrayFireCacheDevices)
-{
-    (void)getDeviceCache();
-}
-
 //
 // Managed interface to device cache
 //
@@ -260,6 +593,10 @@ static auto managedDeviceCacheEntry = Pothos::ManagedClass()
     .registerField("Toolkit", &DeviceCacheEntry::toolkit)
     .registerField("Compute", &DeviceCacheEntry::compute)
     .registerField("Memory Step Size", &DeviceCacheEntry::memoryStepSize)
+    .registerField("H2D Bandwidth (GB/s)", &DeviceCacheEntry::h2dGBPerSec)
+    .registerField("D2H Bandwidth (GB/s)", &DeviceCacheEntry::d2hGBPerSec)
+    .registerField("Elementwise Throughput (GElem/s)", &DeviceCacheEntry::elementwiseGElemsPerSec)
+    .registerField("FFT Throughput (MSamples/s)", &DeviceCacheEntry::fftMSamplesPerSec)
     .commit("ArrayFire/DeviceCacheEntry");
 
 // Nicer than the error from at()
@@ -1,4 +1,4 @@
-// Copyright (c) 2019-2020 Nicholas Corgan
+// Copyright (c) 2019-2021 Nicholas Corgan
 // SPDX-License-Identifier: BSD-3-Clause
 
 #pragma once
@@ -18,6 +18,13 @@ struct DeviceCacheEntry
 
     af::Backend afBackendEnum;
     int afDeviceIndex;
+
+    // From the optional device benchmark (see DeviceBenchmark.hpp), or 0
+    // if it hasn't been run
+    double h2dGBPerSec;
+    double d2hGBPerSec;
+    double elementwiseGElemsPerSec;
+    double fftMSamplesPerSec;
 };
 using DeviceCache = std::vector<DeviceCacheEntry>;
 
@@ -25,6 +32,20 @@ const std::vector<af::Backend>& getAvailableBackends();
 
 const std::vector<DeviceCacheEntry>& getDeviceCache();
 
+// Where enumerated devices are stored between processes. Empty if disabled.
+std::string getDeviceCacheFilepath();
+
+// What getDeviceCache() does on first use, with the given file: the stored
+// devices are used if the file's key matches this machine, and otherwise
+// devices are enumerated and stored. Returns whether the stored devices
+// were used. This doesn't change getDeviceCache().
+bool loadOrEnumerateDeviceCache(
+    const std::string& filepath,
+    std::vector<DeviceCacheEntry>& deviceCacheOut);
+
+// Takes a device name or "Platform:Index". Throws if not found.
+const DeviceCacheEntry& getDeviceCacheEntry(const std::string& device);
+
 std::string getAnyDeviceWithBackend(af::Backend backend);
 
 std::string getCPUOrBestDevice();
@@ -0,0 +1,239 @@
+// Copyright (c) 2021 Nicholas Corgan
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "DeviceBenchmark.hpp"
+#include "DevicePlacement.hpp"
+#include "DeviceThreads.hpp"
+#include "MemoryManager.hpp"
+
+#include <Pothos/Exception.hpp>
+
+#include <Poco/Environment.h>
+#include <Poco/Logger.h>
+
+#include <arrayfire.h>
+
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <vector>
+
+static const std::string AutoDevice = "Auto";
+static const std::string AutoGroupPrefix = "Auto:";
+
+static const std::vector<std::string> AutoDevicePolicies = {"First", "RoundRobin", "LeastLoaded"};
+
+static void validatePolicy(const std::string& policy)
+{
+    if(AutoDevicePolicies.end() == std::find(AutoDevicePolicies.begin(), AutoDevicePolicies.end(), policy))
+    {
+        throw Pothos::InvalidArgumentException("Invalid auto device policy", policy);
+    }
+}
+
+static std::string getPolicyFromEnvironment()
+{
+    const auto policy = Poco::Environment::get("POTHOSGPU_AUTO_DEVICE_POLICY", "First");
+
+    try
+    {
+        validatePolicy(policy);
+    }
+    catch(const Pothos::Exception& ex)
+    {
+        auto& logger = Poco::Logger::get("PothosGPU");
+        poco_error(logger, ex.displayText());
+
+        return "First";
+    }
+
+    return policy;
+}
+
+struct PlacementState
+{
+    PlacementState():
+        policy(getPolicyFromEnvironment()),
+        nextDevice(0),
+        liveBlocks()
+    {
+    }
+
+    std::mutex mutex;
+    std::string policy;
+    size_t nextDevice;
+
+    // Indexed by candidate
+    std::vector<size_t> liveBlocks;
+
+    std::map<std::string, size_t> groups;
+};
+
+static PlacementState& getPlacementState()
+{
+    static PlacementState placementState;
+
+    return placementState;
+}
+
+static const std::vector<const DeviceCacheEntry*>& getCandidates()
+{
+    static const std::vector<const DeviceCacheEntry*> candidates = []()
+    {
+        std::vector<const DeviceCacheEntry*> ret;
+
+        const auto& deviceCache = getDeviceCache();
+        const bool allBenchmarked = std::all_of(
+                                        deviceCache.begin(),
+                                        deviceCache.end(),
+                                        isDeviceBenchmarked);
+
+        // With benchmark results, rank every device by measured speed
+        // rather than trusting the backend order.
+        if(!deviceCache.empty() && allBenchmarked)
+        {
+            for(const auto& entry: deviceCache) ret.emplace_back(&entry);
+
+            std::stable_sort(
+                ret.begin(),
+                ret.end(),
+                [](const DeviceCacheEntry* entry0, const DeviceCacheEntry* entry1)
+                {
+                    return deviceScore(*entry0) > deviceScore(*entry1);
+                });
+        }
+        else
+        {
+            for(const auto& entry: deviceCache)
+            {
+                if(entry.afBackendEnum == deviceCache[0].afBackendEnum) ret.emplace_back(&entry);
+            }
+        }
+
+        return ret;
+    }();
+
+    return candidates;
+}
+
+static size_t getLockedBytes(const DeviceCacheEntry& entry)
+{
+    // ArrayFire doesn't ask the custom memory manager for its memory info,
+    // so this has to go through the manager. Without it, ArrayFire's info
+    // is for the thread's active device.
+    if(!memoryManagerInstalled())
+    {
+        setThreadBackendAndDevice(entry.afBackendEnum, entry.afDeviceIndex);
+    }
+
+    return memoryUsage(entry.afBackendEnum, entry.afDeviceIndex).lockedBytes;
+}
+
+// Assumes the state's mutex is locked
+static size_t chooseCandidate(PlacementState& state)
+{
+    const auto& candidates = getCandidates();
+
+    if("RoundRobin" == state.policy)
+    {
+        return (state.nextDevice++ % candidates.size());
+    }
+    else if("LeastLoaded" == state.policy)
+    {
+        size_t bestCandidate = 0;
+        auto bestLoad = std::make_pair(
+                            std::numeric_limits<size_t>::max(),
+                            std::numeric_limits<size_t>::max());
+
+        for(size_t candidate = 0; candidate < candidates.size(); ++candidate)
+        {
+            const auto load = std::make_pair(
+                                  getLockedBytes(*candidates[candidate]),
+                                  state.liveBlocks[candidate]);
+            if(load < bestLoad)
+            {
+                bestCandidate = candidate;
+                bestLoad = load;
+            }
+        }
+
+        return bestCandidate;
+    }
+
+    return 0;
+}
+
+bool isAutoDevice(const std::string& device)
+{
+    return (AutoDevice == device) || (0 == device.compare(0, AutoGroupPrefix.size(), AutoGroupPrefix));
+}
+
+DevicePlacement placeAutoDevice(const std::string& device)
+{
+    const auto& candidates = getCandidates();
+    if(candidates.empty())
+    {
+        throw Pothos::RuntimeException("No ArrayFire devices found. Check your ArrayFire installation.");
+    }
+
+    auto& state = getPlacementState();
+    std::lock_guard<std::mutex> lock(state.mutex);
+
+    state.liveBlocks.resize(candidates.size(), 0);
+
+    DevicePlacement placement;
+    size_t candidate = 0;
+
+    if(AutoDevice == device)
+    {
+        candidate = chooseCandidate(state);
+        placement.description = state.policy;
+    }
+    else
+    {
+        const auto group = device.substr(AutoGroupPrefix.size());
+
+        auto groupIter = state.groups.find(group);
+        if(state.groups.end() == groupIter)
+        {
+            groupIter = state.groups.emplace(group, chooseCandidate(state)).first;
+        }
+
+        candidate = groupIter->second;
+        placement.description = "Group " + group;
+    }
+
+    placement.entry = candidates[candidate];
+
+    ++state.liveBlocks[candidate];
+    placement.token = std::shared_ptr<void>(
+                          nullptr,
+                          [candidate](void*)
+                          {
+                              auto& state = getPlacementState();
+                              std::lock_guard<std::mutex> lock(state.mutex);
+                              --state.liveBlocks[candidate];
+                          });
+
+    return placement;
+}
+
+std::string autoDevicePolicy()
+{
+    auto& state = getPlacementState();
+    std::lock_guard<std::mutex> lock(state.mutex);
+
+    return state.policy;
+}
+
+void setAutoDevicePolicy(const std::string& policy)
+{
+    validatePolicy(policy);
+
+    auto& state = getPlacementState();
+    std::lock_guard<std::mutex> lock(state.mutex);
+
+    state.policy = policy;
+    state.nextDevice = 0;
+}
@@ -0,0 +1,48 @@
+// Copyright (c) 2021 Nicholas Corgan
+// SPDX-License-Identifier: BSD-3-Clause
+
+#pragma once
+
+#include "DeviceCache.hpp"
+
+#include <memory>
+#include <string>
+
+//
+// Resolves "Auto" devices. Only devices with the best available backend
+// are considered, so Auto blocks don't land on the CPU on a GPU machine.
+// If every device has been benchmarked (see DeviceBenchmark.hpp), all
+// devices are considered instead, fastest first.
+//
+// Policies:
+//  * First: always use the first device (default)
+//  * RoundRobin: cycle through devices
+//  * LeastLoaded: use the device with the least memory in use by
+//    ArrayFire, then the fewest live Auto blocks
+//
+// Set the policy with POTHOSGPU_AUTO_DEVICE_POLICY or
+// setAutoDevicePolicy().
+//
+// To keep connected blocks on the same device, use "Auto:<group>" as the
+// device. The first block in a group is placed with the current policy,
+// and every other block in the group uses the same device.
+//
+
+struct DevicePlacement
+{
+    const DeviceCacheEntry* entry;
+
+    // Human-readable explanation of the decision
+    std::string description;
+
+    // Counts the block toward its device's load while held.
+    std::shared_ptr<void> token;
+};
+
+bool isAutoDevice(const std::string& device);
+
+DevicePlacement placeAutoDevice(const std::string& device);
+
+std::string autoDevicePolicy();
+
+void setAutoDevicePolicy(const std::string& policy);
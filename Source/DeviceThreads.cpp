@@ -0,0 +1,137 @@
+// Copyright (c) 2021 Nicholas Corgan
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "DeviceThreads.hpp"
+
+#include <Pothos/Framework.hpp>
+
+#include <Poco/Environment.h>
+#include <Poco/NumberParser.h>
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+//
+// Thread-local backend and device
+//
+
+// Indexed by af::Backend, which is a bitmask of single bits
+static constexpr size_t BackendSlots = static_cast<size_t>(::AF_BACKEND_OPENCL) + 1;
+
+struct ThreadContext
+{
+    ThreadContext():
+        backend(::AF_BACKEND_DEFAULT),
+        backendKnown(false)
+    {
+        for(auto& device: devices) device = -1;
+    }
+
+    af::Backend backend;
+    bool backendKnown;
+
+    // ArrayFire tracks the active device separately for each backend.
+    int devices[BackendSlots];
+};
+
+static ThreadContext& getThreadContext()
+{
+    static thread_local ThreadContext threadContext;
+
+    return threadContext;
+}
+
+void setThreadBackend(af::Backend backend)
+{
+    auto& threadContext = getThreadContext();
+    if(!threadContext.backendKnown || (threadContext.backend != backend))
+    {
+        af::setBackend(backend);
+
+        threadContext.backend = backend;
+        threadContext.backendKnown = true;
+    }
+}
+
+void setThreadBackendAndDevice(
+    af::Backend backend,
+    int device)
+{
+    setThreadBackend(backend);
+
+    auto& threadDevice = getThreadContext().devices[static_cast<size_t>(backend)];
+    if(threadDevice != device)
+    {
+        af::setDevice(device);
+        threadDevice = device;
+    }
+}
+
+//
+// Device thread pools
+//
+
+static size_t getThreadsFromEnvironment()
+{
+    unsigned value = 0;
+    return Poco::NumberParser::tryParseUnsigned(Poco::Environment::get("POTHOSGPU_DEVICE_THREADS", "0"), value)
+           ? value : 0;
+}
+
+static std::atomic<size_t>& getThreadsPerPool()
+{
+    static std::atomic<size_t> threadsPerPool(getThreadsFromEnvironment());
+
+    return threadsPerPool;
+}
+
+struct DeviceThreadPools
+{
+    std::mutex mutex;
+
+    // Only keep pools alive as long as blocks use them.
+    std::map<std::pair<af::Backend, int>, std::weak_ptr<void>> pools;
+};
+
+static DeviceThreadPools& getDeviceThreadPools()
+{
+    static DeviceThreadPools deviceThreadPools;
+
+    return deviceThreadPools;
+}
+
+size_t deviceThreadsPerPool()
+{
+    return getThreadsPerPool();
+}
+
+void setDeviceThreadsPerPool(size_t numThreads)
+{
+    auto& deviceThreadPools = getDeviceThreadPools();
+    std::lock_guard<std::mutex> lock(deviceThreadPools.mutex);
+
+    // Existing blocks keep their pools, but new blocks get pools with the
+    // new size.
+    getThreadsPerPool() = numThreads;
+    deviceThreadPools.pools.clear();
+}
+
+Pothos::ThreadPool getDeviceThreadPool(
+    af::Backend backend,
+    int device)
+{
+    auto& deviceThreadPools = getDeviceThreadPools();
+    std::lock_guard<std::mutex> lock(deviceThreadPools.mutex);
+
+    auto& pool = deviceThreadPools.pools[std::make_pair(backend, device)];
+    if(auto container = pool.lock()) return Pothos::ThreadPool(container);
+
+    Pothos::ThreadPoolArgs args(getThreadsPerPool());
+    Pothos::ThreadPool threadPool(args);
+    pool = threadPool.getContainer();
+
+    return threadPool;
+}
@@ -0,0 +1,40 @@
+// Copyright (c) 2021 Nicholas Corgan
+// SPDX-License-Identifier: BSD-3-Clause
+
+#pragma once
+
+#include <Pothos/Framework.hpp>
+
+#include <arrayfire.h>
+
+//
+// Switching the ArrayFire backend or device has a real cost, especially
+// with CUDA, and Pothos may run a block on any thread in its pool. These
+// functions track what each thread is set to, so redundant switches are a
+// thread-local comparison.
+//
+// For this to be accurate, all backend and device changes in this module
+// must go through these functions.
+//
+
+void setThreadBackend(af::Backend backend);
+
+void setThreadBackendAndDevice(
+    af::Backend backend,
+    int device);
+
+//
+// Optionally, blocks can run in thread pools dedicated to their backend and
+// device, so each thread only sets its backend and device once. Set
+// POTHOSGPU_DEVICE_THREADS to a number of threads per device, or call
+// setDeviceThreadsPerPool, to enable this for blocks created afterwards.
+//
+
+size_t deviceThreadsPerPool();
+
+// 0 disables device thread pools.
+void setDeviceThreadsPerPool(size_t numThreads);
+
+Pothos::ThreadPool getDeviceThreadPool(
+    af::Backend backend,
+    int device);
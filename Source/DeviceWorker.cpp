@@ -0,0 +1,60 @@
+// Copyright (c) 2021 Nicholas Corgan
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "DeviceWorker.hpp"
+
+#include <utility>
+
+DeviceWorker::DeviceWorker():
+    _mutex(),
+    _cond(),
+    _tasks(),
+    _done(false),
+    _thread(&DeviceWorker::_loop, this)
+{
+}
+
+DeviceWorker::~DeviceWorker()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _done = true;
+    }
+    _cond.notify_one();
+
+    _thread.join();
+}
+
+std::future<void> DeviceWorker::run(const std::function<void()>& task)
+{
+    std::packaged_task<void()> packagedTask(task);
+    auto future = packagedTask.get_future();
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _tasks.emplace_back(std::move(packagedTask));
+    }
+    _cond.notify_one();
+
+    return future;
+}
+
+void DeviceWorker::_loop()
+{
+    while(true)
+    {
+        std::packaged_task<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _cond.wait(lock, [this](){return _done || !_tasks.empty();});
+
+            // Finish any queued tasks so no caller waits forever.
+            if(_tasks.empty()) return;
+
+            task = std::move(_tasks.front());
+            _tasks.pop_front();
+        }
+
+        task();
+    }
+}
@@ -0,0 +1,43 @@
+// Copyright (c) 2021 Nicholas Corgan
+// SPDX-License-Identifier: BSD-3-Clause
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+//
+// A single thread that runs tasks in order. Since a worker is only used for
+// one device, the thread only has to set its ArrayFire backend and device
+// once.
+//
+class DeviceWorker
+{
+    public:
+        using UPtr = std::unique_ptr<DeviceWorker>;
+
+        DeviceWorker();
+
+        ~DeviceWorker();
+
+        DeviceWorker(const DeviceWorker&) = delete;
+        DeviceWorker& operator=(const DeviceWorker&) = delete;
+
+        // Any exception thrown by the task is rethrown by the future.
+        std::future<void> run(const std::function<void()>& task);
+
+    private:
+        void _loop();
+
+        std::mutex _mutex;
+        std::condition_variable _cond;
+        std::deque<std::packaged_task<void()>> _tasks;
+        bool _done;
+
+        std::thread _thread;
+};
@@ -1,6 +1,7 @@
-// Copyright (c) 2019-2020 Nicholas Corgan
+// Copyright (c) 2019-2021 Nicholas Corgan
 // SPDX-License-Identifier: BSD-3-Clause
 
+#include "EnumConversions.hpp"
 #include "Utility.hpp"
 
 #include <Pothos/Framework.hpp>
@@ -62,14 +63,26 @@ static const std::unordered_map<std::string, af::topkFunction> TopKFunctionEnumM
     {"Default", ::AF_TOPK_DEFAULT},
 };
 
-static af::dtype pothosDTypeToAfDType(const Pothos::DType& pothosDType)
+af::dtype pothosDTypeToAfDType(const Pothos::DType& pothosDType)
 {
     return getValForKey(DTypeEnumMap, pothosDType.name());
 }
 
-static Pothos::DType afDTypeToPothosDType(af::dtype afDType)
+Pothos::DType afDTypeToPothosDType(af::dtype afDType)
 {
-    return Pothos::DType(getKeyForVal(DTypeEnumMap, afDType));
+    // Constructing a DType parses its name, so only do it once per type.
+    static const std::unordered_map<int, Pothos::DType> PothosDTypes = []()
+    {
+        std::unordered_map<int, Pothos::DType> pothosDTypes;
+        for(const auto& mapPair: DTypeEnumMap)
+        {
+            pothosDTypes.emplace(static_cast<int>(mapPair.second), Pothos::DType(mapPair.first));
+        }
+
+        return pothosDTypes;
+    }();
+
+    return getValForKey(PothosDTypes, static_cast<int>(afDType));
 }
 
 template <typename KeyType, typename ValType, typename HasherType>
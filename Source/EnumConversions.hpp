@@ -0,0 +1,18 @@
+// Copyright (c) 2021 Nicholas Corgan
+// SPDX-License-Identifier: BSD-3-Clause
+
+#pragma once
+
+#include <Pothos/Framework.hpp>
+
+#include <arrayfire.h>
+
+//
+// The same conversions registered with Pothos::Object, without the plugin
+// lookup and type-erased call, for use on every work() call. Both throw
+// Pothos::InvalidArgumentException for unsupported types.
+//
+
+af::dtype pothosDTypeToAfDType(const Pothos::DType& pothosDType);
+
+Pothos::DType afDTypeToPothosDType(af::dtype afDType);
@@ -0,0 +1,479 @@
+// Copyright (c) 2021 Nicholas Corgan
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "Expression.hpp"
+
+#include <Pothos/Exception.hpp>
+
+#include <arrayfire.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+using UnaryFunc = af::array(*)(const af::array&);
+using BinaryFunc = af::array(*)(const af::array&, const af::array&);
+
+static af::array afAdd(const af::array& lhs, const af::array& rhs)
+{
+    return lhs + rhs;
+}
+
+static af::array afSubtract(const af::array& lhs, const af::array& rhs)
+{
+    return lhs - rhs;
+}
+
+static af::array afMultiply(const af::array& lhs, const af::array& rhs)
+{
+    return lhs * rhs;
+}
+
+static af::array afDivide(const af::array& lhs, const af::array& rhs)
+{
+    return lhs / rhs;
+}
+
+static af::array afNegate(const af::array& afArray)
+{
+    return -afArray;
+}
+
+// af::rsqrt requires ArrayFire 3.7.
+static af::array afRSqrt(const af::array& afArray)
+{
+    return 1.0 / af::sqrt(afArray);
+}
+
+static const std::unordered_map<std::string, UnaryFunc>& getUnaryFuncs()
+{
+    static const std::unordered_map<std::string, UnaryFunc> unaryFuncs =
+    {
+        {"abs",     static_cast<UnaryFunc>(&af::abs)},
+        {"arg",     static_cast<UnaryFunc>(&af::arg)},
+        {"real",    static_cast<UnaryFunc>(&af::real)},
+        {"imag",    static_cast<UnaryFunc>(&af::imag)},
+        {"conjg",   static_cast<UnaryFunc>(&af::conjg)},
+        {"sqrt",    static_cast<UnaryFunc>(&af::sqrt)},
+        {"cbrt",    static_cast<UnaryFunc>(&af::cbrt)},
+        {"rsqrt",   &afRSqrt},
+        {"exp",     static_cast<UnaryFunc>(&af::exp)},
+        {"expm1",   static_cast<UnaryFunc>(&af::expm1)},
+        {"log",     static_cast<UnaryFunc>(&af::log)},
+        {"log1p",   static_cast<UnaryFunc>(&af::log1p)},
+        {"log2",    static_cast<UnaryFunc>(&af::log2)},
+        {"log10",   static_cast<UnaryFunc>(&af::log10)},
+        {"sin",     static_cast<UnaryFunc>(&af::sin)},
+        {"cos",     static_cast<UnaryFunc>(&af::cos)},
+        {"tan",     static_cast<UnaryFunc>(&af::tan)},
+        {"asin",    static_cast<UnaryFunc>(&af::asin)},
+        {"acos",    static_cast<UnaryFunc>(&af::acos)},
+        {"atan",    static_cast<UnaryFunc>(&af::atan)},
+        {"sinh",    static_cast<UnaryFunc>(&af::sinh)},
+        {"cosh",    static_cast<UnaryFunc>(&af::cosh)},
+        {"tanh",    static_cast<UnaryFunc>(&af::tanh)},
+        {"asinh",   static_cast<UnaryFunc>(&af::asinh)},
+        {"acosh",   static_cast<UnaryFunc>(&af::acosh)},
+        {"atanh",   static_cast<UnaryFunc>(&af::atanh)},
+        {"floor",   static_cast<UnaryFunc>(&af::floor)},
+        {"ceil",    static_cast<UnaryFunc>(&af::ceil)},
+        {"round",   static_cast<UnaryFunc>(&af::round)},
+        {"trunc",   static_cast<UnaryFunc>(&af::trunc)},
+        {"sigmoid", static_cast<UnaryFunc>(&af::sigmoid)},
+        {"erf",     static_cast<UnaryFunc>(&af::erf)},
+        {"erfc",    static_cast<UnaryFunc>(&af::erfc)},
+        {"tgamma",  static_cast<UnaryFunc>(&af::tgamma)},
+        {"lgamma",  static_cast<UnaryFunc>(&af::lgamma)},
+    };
+
+    return unaryFuncs;
+}
+
+static const std::unordered_map<std::string, BinaryFunc>& getBinaryFuncs()
+{
+    static const std::unordered_map<std::string, BinaryFunc> binaryFuncs =
+    {
+        {"pow",   static_cast<BinaryFunc>(&af::pow)},
+        {"atan2", static_cast<BinaryFunc>(&af::atan2)},
+        {"hypot", static_cast<BinaryFunc>(&af::hypot)},
+        {"min",   static_cast<BinaryFunc>(&af::min)},
+        {"max",   static_cast<BinaryFunc>(&af::max)},
+        {"rem",   static_cast<BinaryFunc>(&af::rem)},
+        {"mod",   static_cast<BinaryFunc>(&af::mod)},
+    };
+
+    return binaryFuncs;
+}
+
+//
+// Expression tree
+//
+
+struct Expression::Node
+{
+    enum class Type
+    {
+        Constant,
+        Input,
+        Parameter,
+        Unary,
+        Binary
+    };
+
+    Type type;
+    double value;
+    size_t index;
+    UnaryFunc unaryFunc;
+    BinaryFunc binaryFunc;
+    std::unique_ptr<Node> lhs;
+    std::unique_ptr<Node> rhs;
+
+    explicit Node(Type nodeType):
+        type(nodeType),
+        value(0.0),
+        index(0),
+        unaryFunc(nullptr),
+        binaryFunc(nullptr),
+        lhs(),
+        rhs()
+    {
+    }
+
+    af::array evaluate(
+        const std::vector<af::array>& inputs,
+        const std::vector<double>& parameterValues,
+        const af::dim4& dims,
+        af::dtype afDType) const
+    {
+        switch(type)
+        {
+            case Type::Constant:
+                return af::constant(value, dims, afDType);
+
+            case Type::Input:
+                return inputs[index];
+
+            case Type::Parameter:
+                return af::constant(parameterValues[index], dims, afDType);
+
+            case Type::Unary:
+                return unaryFunc(lhs->evaluate(inputs, parameterValues, dims, afDType));
+
+            case Type::Binary:
+            default:
+                return binaryFunc(
+                           lhs->evaluate(inputs, parameterValues, dims, afDType),
+                           rhs->evaluate(inputs, parameterValues, dims, afDType));
+        }
+    }
+};
+
+//
+// Parser
+//
+// expr    := term (('+' | '-') term)*
+// term    := unary (('*' | '/') unary)*
+// unary   := '-' unary | '+' unary | power
+// power   := primary ('^' unary)?
+// primary := number | name | name '(' expr (',' expr)* ')' | '(' expr ')'
+//
+
+class ExpressionParser
+{
+    public:
+        using Node = Expression::Node;
+        using NodePtr = std::unique_ptr<Node>;
+
+        ExpressionParser(
+            const std::string& expression,
+            size_t* numInputs,
+            std::vector<std::string>* parameterNames
+        ):
+            _expression(expression),
+            _pos(0),
+            _numInputs(numInputs),
+            _parameterNames(parameterNames)
+        {
+        }
+
+        NodePtr parse()
+        {
+            auto root = this->_parseExpr();
+
+            this->_skipSpace();
+            if(_pos < _expression.size()) this->_throw("Unexpected character");
+
+            return root;
+        }
+
+    private:
+        const std::string& _expression;
+        size_t _pos;
+        size_t* _numInputs;
+        std::vector<std::string>* _parameterNames;
+
+        [[noreturn]] void _throw(const std::string& message) const
+        {
+            throw Pothos::InvalidArgumentException(
+                      "Invalid expression: " + _expression,
+                      message + " at position " + std::to_string(_pos));
+        }
+
+        void _skipSpace()
+        {
+            while((_pos < _expression.size()) && std::isspace(static_cast<unsigned char>(_expression[_pos]))) ++_pos;
+        }
+
+        bool _accept(char ch)
+        {
+            this->_skipSpace();
+            if((_pos < _expression.size()) && (_expression[_pos] == ch))
+            {
+                ++_pos;
+                return true;
+            }
+
+            return false;
+        }
+
+        void _expect(char ch)
+        {
+            if(!this->_accept(ch)) this->_throw(std::string("Expected '") + ch + "'");
+        }
+
+        static NodePtr _makeBinary(
+            BinaryFunc func,
+            NodePtr lhs,
+            NodePtr rhs)
+        {
+            NodePtr node(new Node(Node::Type::Binary));
+            node->binaryFunc = func;
+            node->lhs = std::move(lhs);
+            node->rhs = std::move(rhs);
+
+            return node;
+        }
+
+        static NodePtr _makeUnary(
+            UnaryFunc func,
+            NodePtr arg)
+        {
+            NodePtr node(new Node(Node::Type::Unary));
+            node->unaryFunc = func;
+            node->lhs = std::move(arg);
+
+            return node;
+        }
+
+        NodePtr _parseExpr()
+        {
+            auto node = this->_parseTerm();
+            while(true)
+            {
+                if(this->_accept('+'))      node = _makeBinary(&afAdd, std::move(node), this->_parseTerm());
+                else if(this->_accept('-')) node = _makeBinary(&afSubtract, std::move(node), this->_parseTerm());
+                else                        return node;
+            }
+        }
+
+        NodePtr _parseTerm()
+        {
+            auto node = this->_parseUnary();
+            while(true)
+            {
+                if(this->_accept('*'))      node = _makeBinary(&afMultiply, std::move(node), this->_parseUnary());
+                else if(this->_accept('/')) node = _makeBinary(&afDivide, std::move(node), this->_parseUnary());
+                else                        return node;
+            }
+        }
+
+        NodePtr _parseUnary()
+        {
+            if(this->_accept('-')) return _makeUnary(&afNegate, this->_parseUnary());
+            if(this->_accept('+')) return this->_parseUnary();
+
+            return this->_parsePower();
+        }
+
+        NodePtr _parsePower()
+        {
+            auto node = this->_parsePrimary();
+
+            // Right-associative, and binds tighter than unary minus on its
+            // left, so -x^2 == -(x^2).
+            if(this->_accept('^'))
+            {
+                node = _makeBinary(
+                           static_cast<BinaryFunc>(&af::pow),
+                           std::move(node),
+                           this->_parseUnary());
+            }
+
+            return node;
+        }
+
+        NodePtr _parsePrimary()
+        {
+            this->_skipSpace();
+            if(_pos >= _expression.size()) this->_throw("Unexpected end of expression");
+
+            if(this->_accept('('))
+            {
+                auto node = this->_parseExpr();
+                this->_expect(')');
+
+                return node;
+            }
+
+            const char ch = _expression[_pos];
+            if(std::isdigit(static_cast<unsigned char>(ch)) || ('.' == ch)) return this->_parseNumber();
+            if(std::isalpha(static_cast<unsigned char>(ch)) || ('_' == ch)) return this->_parseName();
+
+            this->_throw("Unexpected character");
+        }
+
+        NodePtr _parseNumber()
+        {
+            const char* begin = _expression.c_str() + _pos;
+            char* end = nullptr;
+            const double value = std::strtod(begin, &end);
+            if(end == begin) this->_throw("Invalid number");
+
+            _pos += static_cast<size_t>(end - begin);
+
+            NodePtr node(new Node(Node::Type::Constant));
+            node->value = value;
+
+            return node;
+        }
+
+        NodePtr _parseName()
+        {
+            const size_t begin = _pos;
+            while((_pos < _expression.size()) &&
+                  (std::isalnum(static_cast<unsigned char>(_expression[_pos])) || ('_' == _expression[_pos])))
+            {
+                ++_pos;
+            }
+            const auto name = _expression.substr(begin, _pos - begin);
+
+            if(this->_accept('(')) return this->_parseCall(name);
+
+            if("pi" == name)
+            {
+                NodePtr node(new Node(Node::Type::Constant));
+                node->value = M_PI;
+
+                return node;
+            }
+
+            // xN is an input.
+            if((name.size() > 1) && ('x' == name[0]) &&
+               std::all_of(name.begin()+1, name.end(), [](char c){return std::isdigit(static_cast<unsigned char>(c));}))
+            {
+                NodePtr node(new Node(Node::Type::Input));
+                try
+                {
+                    node->index = static_cast<size_t>(std::stoul(name.substr(1)));
+                }
+                catch(const std::invalid_argument&)
+                {
+                    this->_throw("Invalid input " + name);
+                }
+                catch(const std::out_of_range&)
+                {
+                    this->_throw("Input index out of range: " + name);
+                }
+                *_numInputs = std::max(*_numInputs, node->index+1);
+
+                return node;
+            }
+
+            auto nameIter = std::find(_parameterNames->begin(), _parameterNames->end(), name);
+            if(_parameterNames->end() == nameIter)
+            {
+                nameIter = _parameterNames->insert(_parameterNames->end(), name);
+            }
+
+            NodePtr node(new Node(Node::Type::Parameter));
+            node->index = static_cast<size_t>(nameIter - _parameterNames->begin());
+
+            return node;
+        }
+
+        NodePtr _parseCall(const std::string& name)
+        {
+            std::vector<NodePtr> args;
+            args.emplace_back(this->_parseExpr());
+            while(this->_accept(',')) args.emplace_back(this->_parseExpr());
+            this->_expect(')');
+
+            const auto& unaryFuncs = getUnaryFuncs();
+            const auto& binaryFuncs = getBinaryFuncs();
+
+            auto unaryIter = unaryFuncs.find(name);
+            if(unaryFuncs.end() != unaryIter)
+            {
+                if(1 != args.size()) this->_throw(name + " takes 1 argument");
+
+                return _makeUnary(unaryIter->second, std::move(args[0]));
+            }
+
+            auto binaryIter = binaryFuncs.find(name);
+            if(binaryFuncs.end() != binaryIter)
+            {
+                if(2 != args.size()) this->_throw(name + " takes 2 arguments");
+
+                return _makeBinary(binaryIter->second, std::move(args[0]), std::move(args[1]));
+            }
+
+            this->_throw("Unknown function " + name);
+        }
+};
+
+//
+// Expression
+//
+
+Expression::Expression(const std::string& expression):
+    _expression(expression),
+    _numInputs(0),
+    _parameterNames(),
+    _root()
+{
+    _root = ExpressionParser(_expression, &_numInputs, &_parameterNames).parse();
+}
+
+Expression::~Expression() = default;
+
+Expression::Expression(Expression&&) = default;
+
+Expression& Expression::operator=(Expression&&) = default;
+
+af::array Expression::evaluate(
+    const std::vector<af::array>& inputs,
+    const std::vector<double>& parameterValues,
+    const af::dim4& dims,
+    af::dtype afDType) const
+{
+    if(inputs.size() < _numInputs)
+    {
+        throw Pothos::InvalidArgumentException(
+                  "Expression uses more inputs than given",
+                  std::to_string(_numInputs));
+    }
+    if(parameterValues.size() != _parameterNames.size())
+    {
+        throw Pothos::InvalidArgumentException(
+                  "Expected one value per parameter",
+                  std::to_string(_parameterNames.size()));
+    }
+
+    return _root->evaluate(inputs, parameterValues, dims, afDType);
+}
@@ -0,0 +1,73 @@
+// Copyright (c) 2021 Nicholas Corgan
+// SPDX-License-Identifier: BSD-3-Clause
+
+#pragma once
+
+#include <arrayfire.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+//
+// An arithmetic expression over input arrays and named scalar parameters,
+// parsed once and then evaluated as a single ArrayFire JIT expression.
+//
+// Syntax:
+//  * Inputs: x0, x1, ...
+//  * Numbers: 2, 0.5, 1e-3, and the constant pi
+//  * Operators: + - * / ^ (power), unary -, and parentheses
+//  * Functions taking one argument: abs, arg, real, imag, conjg, sqrt,
+//    cbrt, rsqrt, exp, expm1, log, log1p, log2, log10, sin, cos, tan,
+//    asin, acos, atan, sinh, cosh, tanh, asinh, acosh, atanh, floor, ceil,
+//    round, trunc, sigmoid, erf, erfc, tgamma, lgamma
+//  * Functions taking two arguments: pow, atan2, hypot, min, max, rem, mod
+//  * Any other name is a parameter, whose value is given on evaluation.
+//
+class Expression
+{
+    public:
+        // Throws Pothos::InvalidArgumentException, with the position of the
+        // error, if the expression is invalid.
+        explicit Expression(const std::string& expression);
+
+        ~Expression();
+
+        Expression(Expression&&);
+        Expression& operator=(Expression&&);
+
+        const std::string& toString() const
+        {
+            return _expression;
+        }
+
+        // One more than the highest input index used
+        size_t numInputs() const
+        {
+            return _numInputs;
+        }
+
+        // In order of first use. evaluate() takes values in this order.
+        const std::vector<std::string>& parameterNames() const
+        {
+            return _parameterNames;
+        }
+
+        // Nothing is computed until the result is evaluated, so ArrayFire
+        // fuses the whole expression into one kernel. Constants are
+        // generated with the given dimensions and type.
+        af::array evaluate(
+            const std::vector<af::array>& inputs,
+            const std::vector<double>& parameterValues,
+            const af::dim4& dims,
+            af::dtype afDType) const;
+
+    private:
+        struct Node;
+        friend class ExpressionParser;
+
+        std::string _expression;
+        size_t _numInputs;
+        std::vector<std::string> _parameterNames;
+        std::unique_ptr<Node> _root;
+};
@@ -0,0 +1,301 @@
+// Copyright (c) 2021 Nicholas Corgan
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "ArrayFireBlock.hpp"
+#include "Expression.hpp"
+#include "Utility.hpp"
+
+#include <Pothos/Exception.hpp>
+#include <Pothos/Framework.hpp>
+#include <Pothos/Object.hpp>
+#include <Pothos/Object/Containers.hpp>
+
+#include <Poco/Format.h>
+#include <Poco/NumberFormatter.h>
+
+#include <arrayfire.h>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+class ExpressionBlock: public ArrayFireBlock
+{
+    public:
+        using Class = ExpressionBlock;
+
+        ExpressionBlock(
+            const std::string& device,
+            const Pothos::DType& dtype,
+            size_t numInputs
+        ):
+            ArrayFireBlock(device),
+            _afDType(Pothos::Object(dtype).convert<af::dtype>()),
+            _nchans(numInputs),
+            _expression(),
+            _parameterValues(),
+            _parametersSet()
+        {
+            if(0 == numInputs)
+            {
+                throw Pothos::InvalidArgumentException("numInputs must be >= 1.");
+            }
+
+            for(size_t chan = 0; chan < _nchans; ++chan)
+            {
+                this->setupInput(chan, dtype, _domain);
+            }
+            this->setupOutput(0, dtype, _domain);
+
+            this->registerCall(this, POTHOS_FCN_TUPLE(Class, expression));
+            this->registerCall(this, POTHOS_FCN_TUPLE(Class, setExpression));
+            this->registerCall(this, POTHOS_FCN_TUPLE(Class, parameterNames));
+            this->registerCall(this, POTHOS_FCN_TUPLE(Class, parameter));
+            this->registerCall(this, POTHOS_FCN_TUPLE(Class, setParameter));
+            this->registerCall(this, POTHOS_FCN_TUPLE(Class, setParameters));
+
+            this->registerProbe("expression");
+
+            this->registerSignal("expressionChanged");
+
+            this->enableBatching();
+            this->enableFailover();
+        }
+
+        virtual ~ExpressionBlock() = default;
+
+        std::string expression() const
+        {
+            return _expression ? _expression->toString() : "";
+        }
+
+        void setExpression(const std::string& expression)
+        {
+            std::unique_ptr<Expression> newExpression(new Expression(expression));
+            if(newExpression->numInputs() > _nchans)
+            {
+                throw Pothos::InvalidArgumentException(
+                          Poco::format(
+                              "The expression uses %s inputs, but the block only has %s.",
+                              Poco::NumberFormatter::format(newExpression->numInputs()),
+                              Poco::NumberFormatter::format(_nchans)),
+                          expression);
+            }
+
+            // Keep the values of parameters the new expression still uses.
+            const auto& newNames = newExpression->parameterNames();
+            std::vector<double> newValues(newNames.size(), 0.0);
+            std::vector<bool> newSet(newNames.size(), false);
+            if(_expression)
+            {
+                const auto& oldNames = _expression->parameterNames();
+                for(size_t newIndex = 0; newIndex < newNames.size(); ++newIndex)
+                {
+                    auto oldIter = std::find(oldNames.begin(), oldNames.end(), newNames[newIndex]);
+                    if(oldNames.end() != oldIter)
+                    {
+                        const auto oldIndex = static_cast<size_t>(oldIter - oldNames.begin());
+                        newValues[newIndex] = _parameterValues[oldIndex];
+                        newSet[newIndex] = _parametersSet[oldIndex];
+                    }
+                }
+            }
+
+            _expression = std::move(newExpression);
+            _parameterValues = std::move(newValues);
+            _parametersSet = std::move(newSet);
+
+            this->emitSignal("expressionChanged", expression);
+        }
+
+        std::vector<std::string> parameterNames() const
+        {
+            return _expression ? _expression->parameterNames() : std::vector<std::string>();
+        }
+
+        double parameter(const std::string& name) const
+        {
+            return _parameterValues[this->_getParameterIndex(name)];
+        }
+
+        void setParameter(
+            const std::string& name,
+            double value)
+        {
+            const auto index = this->_getParameterIndex(name);
+
+            _parameterValues[index] = value;
+            _parametersSet[index] = true;
+        }
+
+        void setParameters(const Pothos::ObjectMap& parameters)
+        {
+            for(const auto& mapPair: parameters)
+            {
+                this->setParameter(
+                    mapPair.first.convert<std::string>(),
+                    mapPair.second.convert<double>());
+            }
+        }
+
+        void activate() override
+        {
+            if(!_expression)
+            {
+                throw Pothos::AssertionViolationException("No expression has been set.");
+            }
+
+            const auto& names = _expression->parameterNames();
+            for(size_t index = 0; index < names.size(); ++index)
+            {
+                if(!_parametersSet[index])
+                {
+                    throw Pothos::AssertionViolationException(
+                              "No value has been set for parameter",
+                              names[index]);
+                }
+            }
+
+            ArrayFireBlock::activate();
+        }
+
+        void work() override
+        {
+            const size_t elems = this->workInfo().minAllElements;
+
+            if(0 == elems)
+            {
+                return;
+            }
+
+            if(this->deferForMemory() || this->deferForBatch(elems))
+            {
+                return;
+            }
+
+            auto workTimer = this->timeStage(BlockStage::Work);
+
+            this->runWithFailover([&]()
+            {
+                std::vector<af::array> afInputs;
+                afInputs.reserve(_nchans);
+                for(size_t chan = 0; chan < _nchans; ++chan)
+                {
+                    afInputs.emplace_back(this->getInputPortAsAfArray(chan));
+                }
+
+                af::array afOutput;
+                {
+                    auto timer = this->timeStage(BlockStage::Compute);
+
+                    afOutput = _expression->evaluate(
+                                   afInputs,
+                                   _parameterValues,
+                                   af::dim4(static_cast<dim_t>(elems)),
+                                   _afDType);
+                    if(afOutput.type() != _afDType) afOutput = afOutput.as(_afDType);
+                }
+
+                this->produceFromAfArray(0, afOutput);
+            });
+        }
+
+    private:
+        af::dtype _afDType;
+        size_t _nchans;
+
+        std::unique_ptr<Expression> _expression;
+        std::vector<double> _parameterValues;
+        std::vector<bool> _parametersSet;
+
+        size_t _getParameterIndex(const std::string& name) const
+        {
+            const auto names = this->parameterNames();
+            auto nameIter = std::find(names.begin(), names.end(), name);
+            if(names.end() == nameIter)
+            {
+                throw Pothos::InvalidArgumentException(
+                          "The expression has no parameter",
+                          name);
+            }
+
+            return static_cast<size_t>(nameIter - names.begin());
+        }
+};
+
+//
+// Factory
+//
+
+static Pothos::Block* expressionBlockFactory(
+    const std::string& device,
+    const Pothos::DType& dtype,
+    size_t numInputs)
+{
+    static const DTypeSupport dtypeSupport{false,false,true,true};
+    validateDType(dtype, dtypeSupport);
+
+    return new ExpressionBlock(device, dtype, numInputs);
+}
+
+//
+// Block registries
+//
+
+/*
+ * |PothosDoc Expression (GPU)
+ *
+ * Evaluates an arithmetic expression over its inputs, as a single ArrayFire
+ * JIT kernel per work() call. This replaces a chain of arithmetic blocks,
+ * each of which would upload, compute, and download separately.
+ *
+ * Inputs are named <b>x0</b>, <b>x1</b>, and so on. Any other name, such as
+ * <b>gain</b> in <b>sqrt(x0*x0 + x1*x1) * gain</b>, is a real-valued parameter,
+ * which must be set with <b>setParameter</b> or <b>setParameters</b> before
+ * the block is activated. Parameters can be changed while running without
+ * re-parsing the expression.
+ *
+ * Supported operators are <b>+ - * / ^</b> and parentheses, along with the
+ * constant <b>pi</b> and the following functions:
+ * <ul>
+ * <li><b>One argument:</b> abs, arg, real, imag, conjg, sqrt, cbrt, rsqrt,
+ * exp, expm1, log, log1p, log2, log10, sin, cos, tan, asin, acos, atan, sinh,
+ * cosh, tanh, asinh, acosh, atanh, floor, ceil, round, trunc, sigmoid, erf,
+ * erfc, tgamma, lgamma</li>
+ * <li><b>Two arguments:</b> pow, atan2, hypot, min, max, rem, mod</li>
+ * </ul>
+ *
+ * The result is converted to the output type.
+ *
+ * |category /GPU/Arith
+ * |keywords array arith expression math fuse jit
+ * |factory /gpu/arith/expression(device,dtype,numInputs)
+ * |setter setExpression(expression)
+ * |setter setParameters(parameters)
+ *
+ * |param device[Device] Device to use for processing.
+ * |default "Auto"
+ *
+ * |param dtype[Data Type] The output's data type.
+ * |widget DTypeChooser(float=1,cfloat=1,dim=1)
+ * |default "float64"
+ * |preview disable
+ *
+ * |param numInputs[Num Inputs]
+ * |widget SpinBox(minimum=1)
+ * |default 2
+ * |preview disable
+ *
+ * |param expression[Expression]
+ * |widget StringEntry()
+ * |default "x0"
+ * |preview enable
+ *
+ * |param parameters[Parameters] A map of parameter names to values.
+ * |default {}
+ * |preview enable
+ */
+static Pothos::BlockRegistry registerExpression(
+    "/gpu/arith/expression",
+    Pothos::Callable(&expressionBlockFactory));
@@ -1,4 +1,4 @@
-// Copyright (c) 2019-2020 Nicholas Corgan
+// Copyright (c) 2019-2021 Nicholas Corgan
 // SPDX-License-Identifier: BSD-3-Clause
 
 #include "ArrayFireBlock.hpp"
@@ -124,13 +124,13 @@ class FFTBlock: public ArrayFireBlock
             bufferChunk.length = elems * bufferChunk.dtype.size();
 
             this->input(0)->consume(elems);
-            return Pothos::Object(bufferChunk).convert<af::array>();
+            return bufferChunkToAfArray(bufferChunk);
         }
 
         void work() override
         {
             auto elems = this->workInfo().minElements;
-            if(0 == elems)
+            if((0 == elems) || this->deferForMemory())
             {
                 return;
             }
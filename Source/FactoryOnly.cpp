@@ -1,4 +1,4 @@
-// Copyright (c) 2019-2020 Nicholas Corgan
+// Copyright (c) 2019-2021 Nicholas Corgan
 // SPDX-License-Identifier: BSD-3-Clause
 
 #include "OneToOneBlock.hpp"
@@ -9,82 +9,69 @@
 
 #include <Pothos/Framework.hpp>
 
-static Pothos::BlockRegistry registerSec(
+static const auto registerSec = makeOneToOneBlockRegistries(
     "/gpu/arith/sec",
-    Pothos::Callable(&OneToOneBlock::makeFromOneType)
-        .bind(sec, 1)
+    Pothos::Callable(&DirectOneToOneBlock<OneToOneFuncCaller<&sec>>::makeFromOneType)
         .bind<DTypeSupport>({false,false,true,false}, 3));
 
-static Pothos::BlockRegistry registerCsc(
+static const auto registerCsc = makeOneToOneBlockRegistries(
     "/gpu/arith/csc",
-    Pothos::Callable(&OneToOneBlock::makeFromOneType)
-        .bind(csc, 1)
+    Pothos::Callable(&DirectOneToOneBlock<OneToOneFuncCaller<&csc>>::makeFromOneType)
         .bind<DTypeSupport>({false,false,true,false}, 3));
 
-static Pothos::BlockRegistry registerCot(
+static const auto registerCot = makeOneToOneBlockRegistries(
     "/gpu/arith/cot",
-    Pothos::Callable(&OneToOneBlock::makeFromOneType)
-        .bind(cot, 1)
+    Pothos::Callable(&DirectOneToOneBlock<OneToOneFuncCaller<&cot>>::makeFromOneType)
         .bind<DTypeSupport>({false,false,true,false}, 3));
 
-static Pothos::BlockRegistry registerASec(
+static const auto registerASec = makeOneToOneBlockRegistries(
     "/gpu/arith/asec",
-    Pothos::Callable(&OneToOneBlock::makeFromOneType)
-        .bind(asec, 1)
+    Pothos::Callable(&DirectOneToOneBlock<OneToOneFuncCaller<&asec>>::makeFromOneType)
         .bind<DTypeSupport>({false,false,true,false}, 3));
 
-static Pothos::BlockRegistry registerACsc(
+static const auto registerACsc = makeOneToOneBlockRegistries(
     "/gpu/arith/acsc",
-    Pothos::Callable(&OneToOneBlock::makeFromOneType)
-        .bind(acsc, 1)
+    Pothos::Callable(&DirectOneToOneBlock<OneToOneFuncCaller<&acsc>>::makeFromOneType)
         .bind<DTypeSupport>({false,false,true,false}, 3));
 
-static Pothos::BlockRegistry registerACot(
+static const auto registerACot = makeOneToOneBlockRegistries(
     "/gpu/arith/acot",
-    Pothos::Callable(&OneToOneBlock::makeFromOneType)
-        .bind(acot, 1)
+    Pothos::Callable(&DirectOneToOneBlock<OneToOneFuncCaller<&acot>>::makeFromOneType)
         .bind<DTypeSupport>({false,false,true,false}, 3));
 
-static Pothos::BlockRegistry registerSecH(
+static const auto registerSecH = makeOneToOneBlockRegistries(
     "/gpu/arith/sech",
-    Pothos::Callable(&OneToOneBlock::makeFromOneType)
-        .bind(sech, 1)
+    Pothos::Callable(&DirectOneToOneBlock<OneToOneFuncCaller<&sech>>::makeFromOneType)
         .bind<DTypeSupport>({false,false,true,false}, 3));
 
-static Pothos::BlockRegistry registerCscH(
+static const auto registerCscH = makeOneToOneBlockRegistries(
     "/gpu/arith/csch",
-    Pothos::Callable(&OneToOneBlock::makeFromOneType)
-        .bind(csch, 1)
+    Pothos::Callable(&DirectOneToOneBlock<OneToOneFuncCaller<&csch>>::makeFromOneType)
         .bind<DTypeSupport>({false,false,true,false}, 3));
 
-static Pothos::BlockRegistry registerCotH(
+static const auto registerCotH = makeOneToOneBlockRegistries(
     "/gpu/arith/coth",
-    Pothos::Callable(&OneToOneBlock::makeFromOneType)
-        .bind(coth, 1)
+    Pothos::Callable(&DirectOneToOneBlock<OneToOneFuncCaller<&coth>>::makeFromOneType)
         .bind<DTypeSupport>({false,false,true,false}, 3));
 
-static Pothos::BlockRegistry registerASecH(
+static const auto registerASecH = makeOneToOneBlockRegistries(
     "/gpu/arith/asech",
-    Pothos::Callable(&OneToOneBlock::makeFromOneType)
-        .bind(asech, 1)
+    Pothos::Callable(&DirectOneToOneBlock<OneToOneFuncCaller<&asech>>::makeFromOneType)
         .bind<DTypeSupport>({false,false,true,false}, 3));
 
-static Pothos::BlockRegistry registerACscH(
+static const auto registerACscH = makeOneToOneBlockRegistries(
     "/gpu/arith/acsch",
-    Pothos::Callable(&OneToOneBlock::makeFromOneType)
-        .bind(acsch, 1)
+    Pothos::Callable(&DirectOneToOneBlock<OneToOneFuncCaller<&acsch>>::makeFromOneType)
         .bind<DTypeSupport>({false,false,true,false}, 3));
 
-static Pothos::BlockRegistry registerACotH(
+static const auto registerACotH = makeOneToOneBlockRegistries(
     "/gpu/arith/acoth",
-    Pothos::Callable(&OneToOneBlock::makeFromOneType)
-        .bind(acoth, 1)
+    Pothos::Callable(&DirectOneToOneBlock<OneToOneFuncCaller<&acoth>>::makeFromOneType)
         .bind<DTypeSupport>({false,false,true,false}, 3));
 
-static Pothos::BlockRegistry registerSinc(
+static const auto registerSinc = makeOneToOneBlockRegistries(
     "/gpu/signal/sinc",
-    Pothos::Callable(&OneToOneBlock::makeFromOneType)
-        .bind(sinc, 1)
+    Pothos::Callable(&DirectOneToOneBlock<OneToOneFuncCaller<&sinc>>::makeFromOneType)
         .bind<DTypeSupport>({false,false,true,false}, 3));
 
 static Pothos::BlockRegistry registerSetUnique(
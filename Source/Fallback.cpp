@@ -1,4 +1,4 @@
-// Copyright (c) 2020 Nicholas Corgan
+// Copyright (c) 2020-2021 Nicholas Corgan
 // SPDX-License-Identifier: BSD-3-Clause
 
 #include "OneToOneBlock.hpp"
@@ -22,10 +22,9 @@ static af::array afRSqrt(const af::array& afArray)
     return 1.0f / af::sqrt(afArray);
 }
 
-static Pothos::BlockRegistry registerRSqrt(
+static const auto registerRSqrt = makeOneToOneBlockRegistries(
     "/gpu/arith/rsqrt",
-    Pothos::Callable(&OneToOneBlock::makeFromOneType)
-        .bind<OneToOneFunc>(&afRSqrt, 1)
+    Pothos::Callable(&DirectOneToOneBlock<OneToOneFuncCaller<&afRSqrt>>::makeFromOneType)
         .bind<DTypeSupport>({
             true,
             false,
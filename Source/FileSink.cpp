@@ -1,6 +1,7 @@
-// Copyright (c) 2019-2020 Nicholas Corgan
+// Copyright (c) 2019-2021 Nicholas Corgan
 // SPDX-License-Identifier: BSD-3-Clause
 
+#include "ArrayFireBinary.hpp"
 #include "ArrayFireBlock.hpp"
 #include "DeviceCache.hpp"
 #include "Utility.hpp"
@@ -18,10 +19,17 @@
 #include <arrayfire.h>
 
 #include <algorithm>
+#include <cstring>
 #include <iostream>
+#include <memory>
 #include <string>
 #include <vector>
 
+// Incoming data is written in chunks of this size, and at most
+// MaxQueuedChunks chunks wait for the background writer at a time.
+static constexpr size_t ChunkBytes = 4 << 20;
+static constexpr size_t MaxQueuedChunks = 4;
+
 class FileSinkBlock: public ArrayFireBlock
 {
     public:
@@ -46,7 +54,10 @@ class FileSinkBlock: public ArrayFireBlock
             _filepath(filepath),
             _key(key),
             _append(append),
-            _nchans(numChannels)
+            _nchans(numChannels),
+            _afDType(Pothos::Object(dtype).convert<af::dtype>()),
+            _writer(),
+            _chunk()
         {
             const Poco::File pocoFile(_filepath);
             if(pocoFile.exists())
@@ -63,10 +74,12 @@ class FileSinkBlock: public ArrayFireBlock
                     throw Pothos::FileReadOnlyException(_filepath);
                 }
 
-                // Make sure this is an ArrayFire binary.
+                // Make sure this is an ArrayFire binary. Only the header is
+                // read, so this is fast for any file size.
+                std::vector<ArrayFireBinaryEntry> entries;
                 try
                 {
-                    af::readArray(_filepath.c_str(), 0U);
+                    entries = getArrayFireBinaryEntries(_filepath);
                 }
                 catch(...)
                 {
@@ -78,18 +91,24 @@ class FileSinkBlock: public ArrayFireBlock
                 // If the file already contains an array with the given key,
                 // and we want to append to it, we need to adhere to this
                 // type.
-                if(_append && (-1 != af::readArrayCheck(_filepath.c_str(), _key.c_str())))
+                auto entryIter = std::find_if(
+                                     entries.begin(),
+                                     entries.end(),
+                                     [&key](const ArrayFireBinaryEntry& entry)
+                                     {
+                                         return (entry.key == key);
+                                     });
+                if(_append && (entries.end() != entryIter))
                 {
-                    auto arr = af::readArray(_filepath.c_str(), _key.c_str());
-                    const auto numDims = arr.numdims();
+                    const auto numDims = entryIter->numDims();
                     if((1 != numDims) && (2 != numDims))
                     {
                         throw Pothos::DataFormatException(
                                   "Only arrays of 1-2 dimensions are supported.");
                     }
 
-                    auto arrNChans = static_cast<size_t>(arr.dims().dims[0]);
-                    auto arrDType = Pothos::Object(arr.type()).convert<Pothos::DType>();
+                    auto arrNChans = (1 == numDims) ? size_t(1) : static_cast<size_t>(entryIter->dims[0]);
+                    auto arrDType = entryIter->dtype();
 
                     if(!isSupportedFileSinkType(arrDType))
                     {
@@ -131,52 +150,42 @@ class FileSinkBlock: public ArrayFireBlock
                 this->setupInput(chan, dtype, _domain);
             }
 
-            _buffers.resize(_nchans);
-
             this->registerCall(this, POTHOS_FCN_TUPLE(FileSinkBlock, filepath));
             this->registerCall(this, POTHOS_FCN_TUPLE(FileSinkBlock, key));
             this->registerCall(this, POTHOS_FCN_TUPLE(FileSinkBlock, append));
         }
 
-        void deactivate()
+        void activate() override
         {
-            this->configArrayFire();
+            ArrayFireBlock::activate();
 
-            static const auto bufElemCmp =
-                [](const Pothos::BufferChunk& buf1, const Pothos::BufferChunk& buf2)
-                {
-                    return (buf1.elements() < buf2.elements());
-                };
+            _writer.reset(new ArrayFireBinaryWriter(
+                              _filepath,
+                              _key,
+                              _afDType,
+                              _nchans,
+                              _append,
+                              MaxQueuedChunks));
+            _chunk.clear();
+            _chunk.reserve(ChunkBytes);
+        }
 
-            af::array afArray;
-            if(1 == _nchans)
-            {
-                afArray = Pothos::Object(_buffers[0]).convert<af::array>();
-            }
-            else
-            {
-                auto afDType = Pothos::Object(this->input(0)->dtype()).convert<af::dtype>();
-                auto maxElementsIter = std::max_element(
-                                           _buffers.begin(),
-                                           _buffers.end(),
-                                           bufElemCmp);
-                const auto maxElements = maxElementsIter->elements();
+        void deactivate() override
+        {
+            ArrayFireBlock::deactivate();
 
-                afArray = af::array(
-                              static_cast<dim_t>(_nchans),
-                              static_cast<dim_t>(maxElements),
-                              afDType);
-                for(size_t chan = 0; chan < _nchans; ++chan)
+            if(_writer)
+            {
+                if(!_chunk.empty())
                 {
-                    afArray.row(chan) = Pothos::Object(_buffers[chan]).convert<af::array>();
+                    _writer->write(std::move(_chunk));
                 }
-            }
 
-            af::saveArray(
-                _key.c_str(),
-                afArray,
-                _filepath.c_str(),
-                _append);
+                // Waits for all queued chunks to be written.
+                _writer->close();
+                _writer.reset();
+            }
+            _chunk.clear();
         }
 
         std::string filepath() const
@@ -194,7 +203,7 @@ class FileSinkBlock: public ArrayFireBlock
             return _append;
         }
 
-        void work()
+        void work() override
         {
             const auto elems = this->workInfo().minInElements;
             if(0 == elems)
@@ -202,18 +211,50 @@ class FileSinkBlock: public ArrayFireBlock
                 return;
             }
 
-            // Just accumulate the buffers we're given.
-            for(size_t chan = 0; chan < _nchans; ++chan)
+            // The array is stored column-major, so samples from each channel
+            // are interleaved. Only whole columns can be written, so take
+            // what is available on all channels.
+            const auto& inputs = this->inputs();
+            const size_t elemSize = inputs[0]->dtype().size();
+            const size_t columnSize = _nchans * elemSize;
+
+            const size_t oldSize = _chunk.size();
+            _chunk.resize(oldSize + (elems * columnSize));
+            char* columns = _chunk.data() + oldSize;
+
+            if(1 == _nchans)
+            {
+                std::memcpy(
+                    columns,
+                    inputs[0]->buffer().as<const void*>(),
+                    (elems * elemSize));
+            }
+            else
             {
-                auto* inputPort = this->input(chan);
-                if(inputPort->elements() > 0)
+                for(size_t chan = 0; chan < _nchans; ++chan)
                 {
-                    const auto& buffer = inputPort->buffer();
-
-                    inputPort->consume(buffer.elements());
-                    _buffers[chan].append(buffer);
+                    const auto* in = inputs[chan]->buffer().as<const char*>();
+                    for(size_t elem = 0; elem < elems; ++elem)
+                    {
+                        std::memcpy(
+                            columns + (elem * columnSize) + (chan * elemSize),
+                            in + (elem * elemSize),
+                            elemSize);
+                    }
                 }
             }
+
+            for(auto* input: inputs)
+            {
+                input->consume(elems);
+            }
+
+            if(_chunk.size() >= ChunkBytes)
+            {
+                _writer->write(std::move(_chunk));
+                _chunk = std::vector<char>();
+                _chunk.reserve(ChunkBytes);
+            }
         }
 
     private:
@@ -221,16 +262,18 @@ class FileSinkBlock: public ArrayFireBlock
         std::string _key;
         bool _append;
         size_t _nchans;
+        af::dtype _afDType;
 
-        std::vector<Pothos::BufferChunk> _buffers;
+        std::unique_ptr<ArrayFireBinaryWriter> _writer;
+        std::vector<char> _chunk;
 };
 
 /*
  * |PothosDoc ArrayFire File Sink
  *
- * Calls <b>af::writeArray</b> to write an array to an ArrayFire binary file.
- * These binary files can store multiple arrays, so a key parameter is given
- * to select a specific array. This block supports:
+ * Writes an array to an ArrayFire binary file, readable with
+ * <b>af::readArray</b>. These binary files can store multiple arrays, so a key
+ * parameter is given to select a specific array. This block supports:
  * <ol>
  * <li>Creating a new file</li>
  * <li>Adding an array to an existing file</li>
@@ -238,6 +281,12 @@ class FileSinkBlock: public ArrayFireBlock
  * <li>Appending to an array in an existing file</li>
  * </ol>
  *
+ * Incoming data is written to disk in fixed-size chunks on a background
+ * thread as it arrives, so memory usage is bounded. The array's header is
+ * updated after every chunk, so the file remains valid if the topology is
+ * interrupted. For multiple channels, only samples received on all channels
+ * are written.
+ *
  * <b>NOTE:</b> Unlike other ArrayFire blocks, this block does not support the
  * following types, due to an ArrayFire bug that doesn't preserve the values
  * passed into <b>af::writeArray</b>.
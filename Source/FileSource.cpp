@@ -1,8 +1,11 @@
-// Copyright (c) 2019-2020 Nicholas Corgan
+// Copyright (c) 2019-2021 Nicholas Corgan
 // SPDX-License-Identifier: BSD-3-Clause
 
+#include "ArrayFireBinary.hpp"
 #include "ArrayFireBlock.hpp"
+#include "CaptureFile.hpp"
 #include "DeviceCache.hpp"
+#include "SharedBufferAllocator.hpp"
 #include "Utility.hpp"
 
 #include <Pothos/Exception.hpp>
@@ -16,37 +19,66 @@
 
 #include <arrayfire.h>
 
-#include <cstring>
+#include <algorithm>
+#include <future>
 #include <string>
 #include <typeinfo>
+#include <vector>
 
 static const std::string blockRegistryPath = "/gpu/array/file_source";
 
+// Upper bound on the host memory used per read. Windows are read into pinned
+// memory and posted downstream as-is, so each window can only be reused once
+// all consumers have uploaded it.
+static constexpr size_t WindowBytes = 4 << 20;
+
+// Pinned windows kept for reuse, enough for the window being posted and the
+// one being read. If downstream blocks still hold both, a new window is
+// allocated.
+static constexpr size_t NumPooledWindows = 2;
+
+struct FileSourceWindow
+{
+    size_t start;
+    size_t numSamples;
+    std::vector<Pothos::SharedBuffer> channels;
+};
+
 class FileSourceBlock: public ArrayFireBlock
 {
     public:
         static Pothos::Block* make(
+            const std::string& device,
             const std::string& filepath,
             const std::string& key,
             bool repeat)
         {
-            return new FileSourceBlock(filepath, key, repeat);
+            return new FileSourceBlock(device, filepath, key, repeat);
         }
 
         FileSourceBlock(
+            const std::string& device,
             const std::string& filepath,
             const std::string& key,
             bool repeat
         ):
-            ArrayFireBlock(getCPUOrBestDevice()),
+            ArrayFireBlock(device),
             _filepath(filepath),
             _key(key),
             _repeat(repeat),
-            _nchans(0),
-            _rowSize(0),
-            _pos(0),
-            _afFileContents(),
-            _fileContents()
+            _reader(),
+            _labels(),
+            _readSamples(0),
+            _rangeStart(0),
+            _rangeStop(0),
+            _window(),
+            _windowPos(0),
+            _position(0),
+            _nextReadPos(0),
+            _readahead(),
+            _readaheadStart(0),
+            _windowPool(),
+            _windowPoolBackend(::AF_BACKEND_DEFAULT)
         {
             const Poco::File pocoFile(_filepath);
             if(!pocoFile.exists())
@@ -54,53 +86,53 @@ class FileSourceBlock: public ArrayFireBlock
                 throw Pothos::FileNotFoundException(filepath);
             }
 
-            if(-1 == af::readArrayCheck(_filepath.c_str(), _key.c_str()))
-            {
-                throw Pothos::InvalidArgumentException(
-                          "Could not find key in ArrayFire binary",
-                          _key);
-            }
+            // Only the header (and for capture files, the index) is parsed
+            // here. Samples are streamed from the file in work().
+            if(isCaptureFile(_filepath)) _reader.reset(new CaptureFileReader(_filepath));
+            else                         _reader.reset(new ArrayFireBinaryReader(_filepath, _key));
 
-            _afFileContents = af::readArray(_filepath.c_str(), _key.c_str());
-            const auto numDims = _afFileContents.numdims();
-            if((1 != numDims) && (2 != numDims))
+            // Now that we know the file is valid, initialize our ports.
+            for(size_t chan = 0; chan < _reader->numChannels(); ++chan)
             {
-                throw Pothos::DataFormatException(
-                          "Only arrays of 1-2 dimensions are supported.");
+                this->setupOutput(chan, _reader->dtype(chan), _domain);
             }
 
-            // Now that we know the file is valid, store the array and
-            // initialize our ports.
-            const auto dtype = Pothos::Object(_afFileContents.type()).convert<Pothos::DType>();
-
-            if(1 == numDims)
-            {
-                _nchans = 1;
-                _rowSize = _afFileContents.bytes();
-                this->setupOutput(0, dtype);
-            }
-            else
-            {
-                _nchans = static_cast<size_t>(_afFileContents.dims(0));
-                _rowSize = _afFileContents.bytes() / _nchans;
-
-                for(size_t chan = 0; chan < _nchans; ++chan)
-                {
-                    this->setupOutput(chan, dtype);
-                }
-            }
+            _labels = _reader->labels();
+            _readSamples = _reader->preferredReadSamples(WindowBytes);
+            _rangeStop = _reader->numSamples();
 
             this->registerCall(this, POTHOS_FCN_TUPLE(FileSourceBlock, filepath));
             this->registerCall(this, POTHOS_FCN_TUPLE(FileSourceBlock, key));
             this->registerCall(this, POTHOS_FCN_TUPLE(FileSourceBlock, repeat));
             this->registerCall(this, POTHOS_FCN_TUPLE(FileSourceBlock, setRepeat));
+            this->registerCall(this, POTHOS_FCN_TUPLE(FileSourceBlock, numSamples));
+            this->registerCall(this, POTHOS_FCN_TUPLE(FileSourceBlock, position));
+            this->registerCall(this, POTHOS_FCN_TUPLE(FileSourceBlock, seek));
+            this->registerCall(this, POTHOS_FCN_TUPLE(FileSourceBlock, seekToLabel));
+            this->registerCall(this, POTHOS_FCN_TUPLE(FileSourceBlock, range));
+            this->registerCall(this, POTHOS_FCN_TUPLE(FileSourceBlock, setRange));
+
+            this->registerProbe("position");
+            this->registerSignal("positionChanged");
+        }
+
+        virtual ~FileSourceBlock()
+        {
+            this->_waitForReadahead();
         }
 
+        // Windows are posted directly, so the output buffer manager is
+        // never used. Accept consumers in any domain.
         Pothos::BufferManager::Sptr getOutputBufferManager(
             const std::string& name,
             const std::string& domain) override
         {
-            return Pothos::Block::getOutputBufferManager(name, domain);
+            if(domain.empty() || (domain == _domain))
+            {
+                return ArrayFireBlock::getOutputBufferManager(name, domain);
+            }
+
+            return Pothos::BufferManager::make("generic");
         }
 
         std::string filepath() const
@@ -123,62 +155,146 @@ class FileSourceBlock: public ArrayFireBlock
             _repeat = repeat;
         }
 
-        void activate() override
+        size_t numSamples() const
         {
-            ArrayFireBlock::activate();
+            return _reader->numSamples();
+        }
 
-            const auto arrayLen = _afFileContents.bytes();
+        // The index of the next sample to be posted
+        size_t position() const
+        {
+            return _position;
+        }
 
-            if(1 == _nchans)
+        void seek(size_t sampleIndex)
+        {
+            if((sampleIndex < _rangeStart) || (sampleIndex >= _rangeStop))
             {
-                _fileContents.emplace_back(Pothos::SharedBuffer::makeCirc(arrayLen));
-                _afFileContents.host(reinterpret_cast<void*>(_fileContents.back().getAddress()));
-            }
-            else
-            {
-                for(size_t chan = 0; chan < _nchans; ++chan)
-                {
-                    _fileContents.emplace_back(Pothos::SharedBuffer::makeCirc(arrayLen));
-                    _afFileContents.row(chan).host(reinterpret_cast<void*>(_fileContents.back().getAddress()));
-                }
+                throw Pothos::RangeException(
+                          Poco::format(
+                              "Cannot seek to sample %s",
+                              Poco::NumberFormatter::format(sampleIndex)),
+                          Poco::format(
+                              "Valid range: [%s, %s)",
+                              Poco::NumberFormatter::format(_rangeStart),
+                              Poco::NumberFormatter::format(_rangeStop)));
             }
+
+            // Anything already read is now stale.
+            this->_waitForReadahead();
+            _window = FileSourceWindow();
+            _windowPos = 0;
+            _nextReadPos = sampleIndex;
+            _position = sampleIndex;
+
+            if(this->isActive()) this->_startReadahead();
+
+            this->emitSignal("positionChanged", _position);
         }
 
-        void work() override
+        // Seeks to the first label with the given ID within the range.
+        void seekToLabel(const std::string& labelID)
         {
-            const size_t elems = this->workInfo().minElements;
-            if((0 == elems) || (!_repeat && (_pos >= _rowSize)))
+            auto labelIter = std::find_if(
+                                 _labels.begin(),
+                                 _labels.end(),
+                                 [&](const StreamFileLabel& label)
+                                 {
+                                     return (label.label.id == labelID) &&
+                                            (label.index >= _rangeStart) &&
+                                            (label.index < _rangeStop);
+                                 });
+            if(_labels.end() == labelIter)
             {
-                return;
+                throw Pothos::NotFoundException(
+                          "No label with this ID in the playback range",
+                          labelID);
             }
 
-            const auto elemsBytes = elems * this->output(0)->dtype().size();
-            size_t memcpySize = 0;
-            size_t actualElems = 0;
+            this->seek(labelIter->index);
+        }
 
-            if(_repeat)
+        std::vector<size_t> range() const
+        {
+            return {_rangeStart, _rangeStop};
+        }
+
+        // Plays back samples [start, stop). Repeating loops over this range.
+        void setRange(size_t start, size_t stop)
+        {
+            if((start >= stop) || (stop > _reader->numSamples()))
             {
-                memcpySize = elemsBytes;
-                actualElems = elems;
+                throw Pothos::RangeException(
+                          Poco::format(
+                              "Invalid range [%s, %s)",
+                              Poco::NumberFormatter::format(start),
+                              Poco::NumberFormatter::format(stop)),
+                          Poco::format(
+                              "The file contains %s samples",
+                              Poco::NumberFormatter::format(_reader->numSamples())));
             }
-            else
+
+            _rangeStart = start;
+            _rangeStop = stop;
+            this->seek(start);
+        }
+
+        void activate() override
+        {
+            ArrayFireBlock::activate();
+
+            _window = FileSourceWindow();
+            _windowPos = 0;
+            _nextReadPos = _position;
+            this->_startReadahead();
+        }
+
+        void deactivate() override
+        {
+            ArrayFireBlock::deactivate();
+
+            this->_waitForReadahead();
+        }
+
+        void work() override
+        {
+            if(_windowPos >= _window.numSamples)
             {
-                memcpySize = std::min(elemsBytes, (_rowSize-_pos));
-                actualElems = memcpySize / this->output(0)->dtype().size();
+                if(!_readahead.valid())
+                {
+                    return; // End of range, not repeating
+                }
+
+                _window = _readahead.get();
+                _windowPos = 0;
+                this->_startReadahead();
             }
 
-            for(size_t chan = 0; chan < _nchans; ++chan)
+            // The rest of the window is posted as-is. Consumers on this
+            // device upload straight from the pinned window, with no copy
+            // into an intermediate buffer.
+            const size_t numSamples = _window.numSamples - _windowPos;
+            const size_t firstSample = _window.start + _windowPos;
+
+            this->_postLabels(firstSample, numSamples);
+
+            const auto& outputs = this->outputs();
+            for(size_t chan = 0; chan < outputs.size(); ++chan)
             {
-                auto* outputPort = this->output(chan);
-                const void* srcPtr = reinterpret_cast<const void*>(_fileContents[chan].getAddress() + _pos);
-                void* out = outputPort->buffer().as<void*>();
+                const auto& dtype = outputs[chan]->dtype();
 
-                std::memcpy(out, srcPtr, memcpySize);
-                outputPort->produce(actualElems);
+                Pothos::BufferChunk bufferChunk(_window.channels[chan]);
+                bufferChunk.dtype = dtype;
+                bufferChunk.address += (_windowPos * dtype.size());
+                bufferChunk.length = numSamples * dtype.size();
+
+                outputs[chan]->postBuffer(std::move(bufferChunk));
             }
 
-            _pos += memcpySize;
-            if(_repeat && (_pos >= _rowSize)) _pos -= _rowSize;
+            _windowPos += numSamples;
+            _position = (_windowPos < _window.numSamples) ? (_window.start + _windowPos)
+                      : _readahead.valid() ? _readaheadStart
+                      : _rangeStop;
         }
 
     private:
@@ -186,30 +302,161 @@ class FileSourceBlock: public ArrayFireBlock
         std::string _key;
         bool _repeat;
 
-        size_t _nchans;
-        size_t _rowSize;
-        size_t _pos;
+        StreamFileReader::UPtr _reader;
+        std::vector<StreamFileLabel> _labels;
+        size_t _readSamples;
+
+        size_t _rangeStart;
+        size_t _rangeStop;
+
+        FileSourceWindow _window;
+        size_t _windowPos;
+        size_t _position;
 
-        af::array _afFileContents;
-        std::vector<Pothos::SharedBuffer> _fileContents;
+        size_t _nextReadPos;
+        std::future<FileSourceWindow> _readahead;
+        size_t _readaheadStart;
+
+        // Indexed by window, then channel
+        std::vector<std::vector<Pothos::SharedBuffer>> _windowPool;
+        af::Backend _windowPoolBackend;
+
+        // Only one read is in flight at a time, so the reader is never
+        // accessed concurrently.
+        void _startReadahead()
+        {
+            if(_nextReadPos >= _rangeStop)
+            {
+                if(!_repeat) return;
+                _nextReadPos = _rangeStart;
+            }
+
+            // Keep reads aligned to the reader's preferred size, so after a
+            // seek, capture file chunks aren't read twice.
+            const size_t startPos = _nextReadPos;
+            const size_t numSamples = std::min(
+                                          (_readSamples - (startPos % _readSamples)),
+                                          (_rangeStop - startPos));
+            _nextReadPos += numSamples;
+
+            // Allocate here rather than in the background thread, since
+            // ArrayFire's backend and device selection is per-thread.
+            FileSourceWindow window{startPos, numSamples, this->_getWindowBuffers()};
+            std::vector<void*> channels;
+            for(const auto& channel: window.channels)
+            {
+                channels.emplace_back(reinterpret_cast<void*>(channel.getAddress()));
+            }
+
+            _readaheadStart = startPos;
+            _readahead = std::async(
+                             std::launch::async,
+                             [this, startPos, numSamples, channels](FileSourceWindow window)
+                             {
+                                 _reader->read(startPos, numSamples, channels);
+                                 return window;
+                             },
+                             std::move(window));
+        }
+
+        // Returns a pooled window that nothing else holds anymore, or a new
+        // one if every pooled window is still in use. Windows are
+        // full-sized, so any read fits.
+        std::vector<Pothos::SharedBuffer> _getWindowBuffers()
+        {
+            if(_windowPoolBackend != _afBackend)
+            {
+                _windowPool.clear();
+                _windowPoolBackend = _afBackend;
+            }
+
+            for(const auto& window: _windowPool)
+            {
+                const bool unused = std::all_of(
+                                        window.begin(),
+                                        window.end(),
+                                        [](const Pothos::SharedBuffer& channel)
+                                        {
+                                            return (1 == channel.useCount());
+                                        });
+                if(unused) return window;
+            }
+
+            const size_t windowSamples = std::min(_readSamples, _reader->numSamples());
+
+            std::vector<Pothos::SharedBuffer> window;
+            for(size_t chan = 0; chan < _reader->numChannels(); ++chan)
+            {
+                window.emplace_back(allocateSharedBuffer(
+                                        _afBackend,
+                                        (windowSamples * _reader->dtype(chan).size())));
+            }
+            if(_windowPool.size() < NumPooledWindows) _windowPool.emplace_back(window);
+
+            return window;
+        }
+
+        void _waitForReadahead()
+        {
+            if(_readahead.valid())
+            {
+                try {_readahead.get();}
+                catch(...) {}
+            }
+        }
+
+        void _postLabels(size_t firstSample, size_t numSamples)
+        {
+            auto labelIter = std::lower_bound(
+                                 _labels.begin(),
+                                 _labels.end(),
+                                 firstSample,
+                                 [](const StreamFileLabel& label, size_t index)
+                                 {
+                                     return (label.index < index);
+                                 });
+            for(; (_labels.end() != labelIter) && (labelIter->index < (firstSample + numSamples)); ++labelIter)
+            {
+                auto label = labelIter->label;
+                label.index = labelIter->index - firstSample;
+                this->output(labelIter->channel)->postLabel(label);
+            }
+        }
 };
 
 /*
  * |PothosDoc ArrayFire File Source
  *
- * Calls <b>af::readArray</b> to load an array from an ArrayFire binary file.
- * These binary files can store multiple arrays, so a key parameter is given
- * to select a specific array.
+ * Streams an array from an ArrayFire binary file, as written by
+ * <b>af::saveArray</b>, or a stream from a PothosGPU capture file, as written
+ * by <b>/gpu/array/capture_sink</b>. ArrayFire binary files can store multiple
+ * arrays, so a key parameter is given to select a specific array. The key is
+ * ignored for capture files.
+ *
+ * Only the file header is parsed on construction. Samples are read in
+ * fixed-size windows, with the next window read in the background, so memory
+ * usage does not depend on the size of the file. Windows are read into pinned
+ * memory for the given device and posted without copying, so ArrayFire blocks
+ * on the same device upload them with a single host-to-device transfer.
  *
  * This block supports any 1D or 2D array. 2D arrays are posted per row in
  * a given channel. The DType of each OutputPort is determined by the type
- * of the given array.
+ * of the given array. Capture files post each stored channel, with its own
+ * DType, along with any labels stored with the capture.
+ *
+ * Playback can be limited to a range of samples with <b>setRange</b>, and
+ * <b>seek</b> jumps to any sample in the range. Capture files are indexed, so
+ * seeking only reads the chunk containing the new position.
  *
  * |category /GPU/File IO
  * |category /File IO
  * |category /Sources
  * |keywords array file source io
- * |factory /gpu/array/file_source(filepath,key,repeat)
+ * |factory /gpu/array/file_source(device,filepath,key,repeat)
+ *
+ * |param device[Device] The device whose consumers this block feeds. This
+ * determines the type of pinned memory the file is read into.
+ * |default "Auto"
  *
  * |param filepath[Filepath] The path of the ArrayFire binary file.
  * |widget FileEntry(mode=open)
@@ -1,4 +1,4 @@
-// Copyright (c) 2019-2020 Nicholas Corgan
+// Copyright (c) 2019-2021 Nicholas Corgan
 // SPDX-License-Identifier: BSD-3-Clause
 
 #include "OneToOneBlock.hpp"
@@ -91,6 +91,21 @@ class FIRBlock: public OneToOneBlock
             OneToOneBlock::work();
         }
 
+    protected:
+        size_t shardHalo() const override
+        {
+            return _taps.size() - 1;
+        }
+
+        // The bound taps live on the block's device.
+        Pothos::Callable shardFunc() const override
+        {
+            auto func = _func;
+            func.bind(Pothos::Object(_taps).convert<af::array>(), 0);
+
+            return func;
+        }
+
     private:
         std::vector<TapType> _taps;
         bool _waitTaps;
@@ -133,6 +148,9 @@ class IIRBlock: public OneToOneBlock
             this->registerCall(this, POTHOS_FCN_TUPLE(Class, setFeedForwardCoeffs));
             this->registerCall(this, POTHOS_FCN_TUPLE(Class, setFeedbackCoeffs));
             this->registerCall(this, POTHOS_FCN_TUPLE(Class, setTapsFromCommsIIRDesigner));
+
+            // Each output depends on all previous outputs.
+            _canShard = false;
         }
 
         virtual ~IIRBlock() = default;
@@ -232,6 +250,17 @@ class IIRBlock: public OneToOneBlock
             OneToOneBlock::work();
         }
 
+    protected:
+        // The bound coefficients live on the block's device.
+        Pothos::Callable shardFunc() const override
+        {
+            auto func = _func;
+            func.bind(Pothos::Object(_feedForwardCoeffs).convert<af::array>(), 0);
+            func.bind(Pothos::Object(_feedbackCoeffs).convert<af::array>(), 1);
+
+            return func;
+        }
+
     private:
         std::vector<TapType> _feedForwardCoeffs;
         std::vector<TapType> _feedbackCoeffs;
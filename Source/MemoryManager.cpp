@@ -0,0 +1,819 @@
+// Copyright (c) 2021 Nicholas Corgan
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "DeviceCache.hpp"
+#include "DeviceThreads.hpp"
+#include "MemoryManager.hpp"
+
+#include <Pothos/Object.hpp>
+
+#include <Poco/Environment.h>
+#include <Poco/Format.h>
+#include <Poco/Logger.h>
+#include <Poco/NumberParser.h>
+#include <Poco/String.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+using json = nlohmann::json;
+
+static Poco::Logger& getLogger()
+{
+    auto& logger = Poco::Logger::get("PothosGPU");
+    return logger;
+}
+
+static constexpr size_t DefaultCacheLimitMB = 256;
+
+static size_t getCacheLimitFromEnvironment()
+{
+    unsigned value = 0;
+    const bool valid = Poco::NumberParser::tryParseUnsigned(
+                           Poco::Environment::get(
+                               "POTHOSGPU_MEMORY_CACHE_MB",
+                               std::to_string(DefaultCacheLimitMB)),
+                           value);
+
+    return (valid ? value : DefaultCacheLimitMB) * 1024 * 1024;
+}
+
+static std::atomic<size_t>& getCacheLimit()
+{
+    static std::atomic<size_t> cacheLimit(getCacheLimitFromEnvironment());
+
+    return cacheLimit;
+}
+
+size_t memoryCacheLimit()
+{
+    return getCacheLimit();
+}
+
+void setMemoryCacheLimit(size_t bytes)
+{
+    // Caches shrink as buffers are freed, not immediately.
+    getCacheLimit() = bytes;
+}
+
+//
+// Budgets
+//
+
+// Blocks start waiting when this much of the budget is in use, leaving
+// headroom for work already in progress.
+static constexpr double PressureFraction = 0.9;
+
+struct MemoryBudgets
+{
+    MemoryBudgets():
+        defaultBudget(0)
+    {
+        unsigned value = 0;
+        if(Poco::NumberParser::tryParseUnsigned(Poco::Environment::get("POTHOSGPU_MEMORY_BUDGET_MB", "0"), value))
+        {
+            defaultBudget = static_cast<size_t>(value) * 1024 * 1024;
+        }
+    }
+
+    std::mutex mutex;
+    size_t defaultBudget;
+    std::map<std::pair<af::Backend, int>, size_t> budgets;
+};
+
+static MemoryBudgets& getMemoryBudgets()
+{
+    static MemoryBudgets memoryBudgets;
+
+    return memoryBudgets;
+}
+
+size_t deviceMemoryBudget(
+    af::Backend backend,
+    int device)
+{
+    auto& memoryBudgets = getMemoryBudgets();
+    std::lock_guard<std::mutex> lock(memoryBudgets.mutex);
+
+    auto budgetIter = memoryBudgets.budgets.find(std::make_pair(backend, device));
+
+    return (memoryBudgets.budgets.end() != budgetIter) ? budgetIter->second : memoryBudgets.defaultBudget;
+}
+
+size_t memoryBudget(const std::string& device)
+{
+    const auto& entry = getDeviceCacheEntry(device);
+
+    return deviceMemoryBudget(entry.afBackendEnum, entry.afDeviceIndex);
+}
+
+void setMemoryBudget(
+    const std::string& device,
+    size_t bytes)
+{
+    const auto& entry = getDeviceCacheEntry(device);
+
+    auto& memoryBudgets = getMemoryBudgets();
+    std::lock_guard<std::mutex> lock(memoryBudgets.mutex);
+
+    memoryBudgets.budgets[std::make_pair(entry.afBackendEnum, entry.afDeviceIndex)] = bytes;
+}
+
+#if AF_API_VERSION >= 37
+
+static std::string getDeviceName(
+    af::Backend backend,
+    int device)
+{
+    const auto& deviceCache = getDeviceCache();
+    auto deviceCacheIter = std::find_if(
+                               deviceCache.begin(),
+                               deviceCache.end(),
+                               [&](const DeviceCacheEntry& entry)
+                               {
+                                   return (entry.afBackendEnum == backend) &&
+                                          (entry.afDeviceIndex == device);
+                               });
+
+    return (deviceCache.end() != deviceCacheIter)
+           ? deviceCacheIter->name
+           : Poco::format("%s:%d", Pothos::Object(backend).convert<std::string>(), device);
+}
+
+//
+// Arena state
+//
+
+struct Allocation
+{
+    size_t bytes;
+
+    // ArrayFire releases its own lock and the user's lock separately, and
+    // the buffer can only be reused once both are released.
+    bool managerLocked;
+    bool userLocked;
+};
+
+struct DeviceArena
+{
+    std::unordered_map<size_t, std::vector<void*>> freeLists;
+    std::unordered_map<void*, Allocation> allocations;
+
+    size_t liveBytes = 0;
+    size_t peakLiveBytes = 0;
+    size_t cachedBytes = 0;
+
+    std::uint64_t allocCalls = 0;
+    std::uint64_t cacheHits = 0;
+    std::uint64_t nativeAllocs = 0;
+    std::uint64_t nativeFrees = 0;
+    std::uint64_t cacheReleases = 0;
+};
+
+struct BackendArena
+{
+    explicit BackendArena(af::Backend backend):
+        backend(backend),
+        handle(nullptr)
+    {
+    }
+
+    af::Backend backend;
+    af_memory_manager handle;
+
+    std::mutex mutex;
+    std::map<int, DeviceArena> devices;
+};
+
+// Only written by installMemoryManagers(), which runs once while devices are
+// first enumerated. Anything reading this outside of the managers themselves
+// should go through getInstalledBackendArenas().
+static std::map<af::Backend, BackendArena*>& getBackendArenas()
+{
+    static std::map<af::Backend, BackendArena*> backendArenas;
+
+    return backendArenas;
+}
+
+static BackendArena* getBackendArena(af_memory_manager handle)
+{
+    void* payload = nullptr;
+    ::af_memory_manager_get_payload(handle, &payload);
+
+    return static_cast<BackendArena*>(payload);
+}
+
+static int getActiveDevice(af_memory_manager handle)
+{
+    int device = 0;
+    ::af_memory_manager_get_active_device_id(handle, &device);
+
+    return device;
+}
+
+// Assumes the arena's mutex is locked
+static void releaseDeviceCache(
+    BackendArena& arena,
+    DeviceArena& deviceArena)
+{
+    for(auto& freeList: deviceArena.freeLists)
+    {
+        for(void* ptr: freeList.second)
+        {
+            ::af_memory_manager_native_free(arena.handle, ptr);
+            ++deviceArena.nativeFrees;
+        }
+    }
+
+    deviceArena.freeLists.clear();
+    deviceArena.cachedBytes = 0;
+    ++deviceArena.cacheReleases;
+}
+
+// Assumes the arena's mutex is locked. Buffers are usually freed on the
+// device they were allocated on, so check that first.
+static bool findAllocation(
+    BackendArena& arena,
+    int activeDevice,
+    void* ptr,
+    DeviceArena** deviceArenaOut,
+    std::unordered_map<void*, Allocation>::iterator* allocationIterOut)
+{
+    auto tryDevice = [&](DeviceArena& deviceArena)
+    {
+        auto allocationIter = deviceArena.allocations.find(ptr);
+        if(deviceArena.allocations.end() == allocationIter) return false;
+
+        *deviceArenaOut = &deviceArena;
+        *allocationIterOut = allocationIter;
+        return true;
+    };
+
+    auto activeIter = arena.devices.find(activeDevice);
+    if((arena.devices.end() != activeIter) && tryDevice(activeIter->second)) return true;
+
+    for(auto& device: arena.devices)
+    {
+        if((device.first != activeDevice) && tryDevice(device.second)) return true;
+    }
+
+    return false;
+}
+
+//
+// af_memory_manager callbacks
+//
+
+static af_err arenaInitialize(af_memory_manager)
+{
+    return ::AF_SUCCESS;
+}
+
+static af_err arenaShutdown(af_memory_manager handle)
+{
+    auto* arena = getBackendArena(handle);
+    std::lock_guard<std::mutex> lock(arena->mutex);
+
+    for(auto& device: arena->devices) releaseDeviceCache(*arena, device.second);
+
+    return ::AF_SUCCESS;
+}
+
+static af_err arenaAlloc(
+    af_memory_manager handle,
+    void** ptr,
+    int userLock,
+    const unsigned ndims,
+    dim_t* dims,
+    const unsigned elementSize)
+{
+    size_t bytes = elementSize;
+    for(unsigned dim = 0; dim < ndims; ++dim) bytes *= static_cast<size_t>(dims[dim]);
+
+    *ptr = nullptr;
+    if(0 == bytes) return ::AF_SUCCESS;
+
+    auto* arena = getBackendArena(handle);
+    const int device = getActiveDevice(handle);
+
+    std::lock_guard<std::mutex> lock(arena->mutex);
+    auto& deviceArena = arena->devices[device];
+    ++deviceArena.allocCalls;
+
+    auto freeListIter = deviceArena.freeLists.find(bytes);
+    if((deviceArena.freeLists.end() != freeListIter) && !freeListIter->second.empty())
+    {
+        *ptr = freeListIter->second.back();
+        freeListIter->second.pop_back();
+
+        deviceArena.cachedBytes -= bytes;
+        ++deviceArena.cacheHits;
+    }
+    else
+    {
+        // Cached buffers count toward the budget, since they're still
+        // allocated on the device.
+        const size_t budget = deviceMemoryBudget(arena->backend, device);
+        if(budget > 0)
+        {
+            if((deviceArena.liveBytes + deviceArena.cachedBytes + bytes) > budget)
+            {
+                releaseDeviceCache(*arena, deviceArena);
+            }
+            if((deviceArena.liveBytes + bytes) > budget) return ::AF_ERR_NO_MEM;
+        }
+
+        auto err = ::af_memory_manager_native_alloc(handle, ptr, bytes);
+        if(::AF_SUCCESS != err)
+        {
+            // Cached buffers of other sizes may be what's in the way.
+            releaseDeviceCache(*arena, deviceArena);
+            err = ::af_memory_manager_native_alloc(handle, ptr, bytes);
+            if(::AF_SUCCESS != err) return err;
+        }
+
+        ++deviceArena.nativeAllocs;
+    }
+
+    deviceArena.allocations[*ptr] = {bytes, (0 == userLock), (0 != userLock)};
+    deviceArena.liveBytes += bytes;
+    deviceArena.peakLiveBytes = std::max(deviceArena.peakLiveBytes, deviceArena.liveBytes);
+
+    return ::AF_SUCCESS;
+}
+
+static af_err arenaAllocated(
+    af_memory_manager handle,
+    size_t* size,
+    void* ptr)
+{
+    *size = 0;
+
+    auto* arena = getBackendArena(handle);
+    std::lock_guard<std::mutex> lock(arena->mutex);
+
+    DeviceArena* deviceArena = nullptr;
+    std::unordered_map<void*, Allocation>::iterator allocationIter;
+    if(findAllocation(*arena, getActiveDevice(handle), ptr, &deviceArena, &allocationIter))
+    {
+        *size = allocationIter->second.bytes;
+    }
+
+    return ::AF_SUCCESS;
+}
+
+static af_err arenaUnlock(
+    af_memory_manager handle,
+    void* ptr,
+    int userUnlock)
+{
+    if(nullptr == ptr) return ::AF_SUCCESS;
+
+    auto* arena = getBackendArena(handle);
+    std::lock_guard<std::mutex> lock(arena->mutex);
+
+    DeviceArena* deviceArena = nullptr;
+    std::unordered_map<void*, Allocation>::iterator allocationIter;
+    if(!findAllocation(*arena, getActiveDevice(handle), ptr, &deviceArena, &allocationIter))
+    {
+        // Allocated before this manager was installed
+        return ::af_memory_manager_native_free(handle, ptr);
+    }
+
+    auto& allocation = allocationIter->second;
+    if(0 != userUnlock) allocation.userLocked = false;
+    else                allocation.managerLocked = false;
+
+    if(allocation.userLocked || allocation.managerLocked) return ::AF_SUCCESS;
+
+    const size_t bytes = allocation.bytes;
+    deviceArena->allocations.erase(allocationIter);
+    deviceArena->liveBytes -= bytes;
+
+    if((deviceArena->cachedBytes + bytes) <= getCacheLimit())
+    {
+        deviceArena->freeLists[bytes].emplace_back(ptr);
+        deviceArena->cachedBytes += bytes;
+    }
+    else
+    {
+        ++deviceArena->nativeFrees;
+        return ::af_memory_manager_native_free(handle, ptr);
+    }
+
+    return ::AF_SUCCESS;
+}
+
+static af_err arenaSignalMemoryCleanup(af_memory_manager handle)
+{
+    auto* arena = getBackendArena(handle);
+    std::lock_guard<std::mutex> lock(arena->mutex);
+
+    auto deviceIter = arena->devices.find(getActiveDevice(handle));
+    if(arena->devices.end() != deviceIter) releaseDeviceCache(*arena, deviceIter->second);
+
+    return ::AF_SUCCESS;
+}
+
+static af_err arenaPrintInfo(
+    af_memory_manager handle,
+    char* msg,
+    const int device)
+{
+    auto* arena = getBackendArena(handle);
+
+    poco_information_f2(
+        getLogger(),
+        "%s%s",
+        std::string(msg ? msg : ""),
+        memoryStatsToJSON(arena->backend, device).dump());
+
+    return ::AF_SUCCESS;
+}
+
+static af_err arenaUserLock(
+    af_memory_manager handle,
+    void* ptr)
+{
+    auto* arena = getBackendArena(handle);
+    std::lock_guard<std::mutex> lock(arena->mutex);
+
+    DeviceArena* deviceArena = nullptr;
+    std::unordered_map<void*, Allocation>::iterator allocationIter;
+    if(findAllocation(*arena, getActiveDevice(handle), ptr, &deviceArena, &allocationIter))
+    {
+        allocationIter->second.userLocked = true;
+    }
+
+    return ::AF_SUCCESS;
+}
+
+static af_err arenaUserUnlock(
+    af_memory_manager handle,
+    void* ptr)
+{
+    return arenaUnlock(handle, ptr, 1);
+}
+
+static af_err arenaIsUserLocked(
+    af_memory_manager handle,
+    void* ptr,
+    int* out)
+{
+    *out = 0;
+
+    auto* arena = getBackendArena(handle);
+    std::lock_guard<std::mutex> lock(arena->mutex);
+
+    DeviceArena* deviceArena = nullptr;
+    std::unordered_map<void*, Allocation>::iterator allocationIter;
+    if(findAllocation(*arena, getActiveDevice(handle), ptr, &deviceArena, &allocationIter))
+    {
+        *out = allocationIter->second.userLocked ? 1 : 0;
+    }
+
+    return ::AF_SUCCESS;
+}
+
+static af_err arenaGetMemoryPressure(
+    af_memory_manager handle,
+    float* pressure)
+{
+    *pressure = 0.0f;
+
+    const int device = getActiveDevice(handle);
+
+    size_t maxBytes = 0;
+    ::af_memory_manager_get_max_memory_size(handle, &maxBytes, device);
+    if(0 == maxBytes) return ::AF_SUCCESS;
+
+    auto* arena = getBackendArena(handle);
+    std::lock_guard<std::mutex> lock(arena->mutex);
+
+    auto deviceIter = arena->devices.find(device);
+    if(arena->devices.end() != deviceIter)
+    {
+        const auto& deviceArena = deviceIter->second;
+        *pressure = static_cast<float>(deviceArena.liveBytes + deviceArena.cachedBytes) / static_cast<float>(maxBytes);
+    }
+
+    return ::AF_SUCCESS;
+}
+
+// Matches ArrayFire's default heuristic for when to evaluate JIT trees.
+static af_err arenaJITTreeExceedsMemoryPressure(
+    af_memory_manager handle,
+    int* out,
+    size_t bytes)
+{
+    auto* arena = getBackendArena(handle);
+    std::lock_guard<std::mutex> lock(arena->mutex);
+
+    const auto& deviceArena = arena->devices[getActiveDevice(handle)];
+    *out = ((2 * bytes) > deviceArena.liveBytes) ? 1 : 0;
+
+    return ::AF_SUCCESS;
+}
+
+static void arenaAddMemoryManagement(
+    af_memory_manager,
+    int)
+{
+}
+
+static void arenaRemoveMemoryManagement(
+    af_memory_manager handle,
+    int device)
+{
+    auto* arena = getBackendArena(handle);
+    std::lock_guard<std::mutex> lock(arena->mutex);
+
+    auto deviceIter = arena->devices.find(device);
+    if(arena->devices.end() != deviceIter) releaseDeviceCache(*arena, deviceIter->second);
+}
+
+//
+// Installation
+//
+
+static bool installMemoryManager(BackendArena* arena)
+{
+    #define afCheck(call) \
+        if(::AF_SUCCESS != (call)) \
+        { \
+            poco_error_f2( \
+                getLogger(), \
+                "Failed to install memory manager for backend %s: %s failed", \
+                Pothos::Object(arena->backend).convert<std::string>(), \
+                std::string(#call)); \
+            return false; \
+        }
+
+    afCheck(::af_create_memory_manager(&arena->handle));
+    afCheck(::af_memory_manager_set_payload(arena->handle, arena));
+    afCheck(::af_memory_manager_set_initialize_fn(arena->handle, &arenaInitialize));
+    afCheck(::af_memory_manager_set_shutdown_fn(arena->handle, &arenaShutdown));
+    afCheck(::af_memory_manager_set_alloc_fn(arena->handle, &arenaAlloc));
+    afCheck(::af_memory_manager_set_allocated_fn(arena->handle, &arenaAllocated));
+    afCheck(::af_memory_manager_set_unlock_fn(arena->handle, &arenaUnlock));
+    afCheck(::af_memory_manager_set_signal_memory_cleanup_fn(arena->handle, &arenaSignalMemoryCleanup));
+    afCheck(::af_memory_manager_set_print_info_fn(arena->handle, &arenaPrintInfo));
+    afCheck(::af_memory_manager_set_user_lock_fn(arena->handle, &arenaUserLock));
+    afCheck(::af_memory_manager_set_user_unlock_fn(arena->handle, &arenaUserUnlock));
+    afCheck(::af_memory_manager_set_is_user_locked_fn(arena->handle, &arenaIsUserLocked));
+    afCheck(::af_memory_manager_set_get_memory_pressure_fn(arena->handle, &arenaGetMemoryPressure));
+    afCheck(::af_memory_manager_set_jit_tree_exceeds_memory_pressure_fn(arena->handle, &arenaJITTreeExceedsMemoryPressure));
+    afCheck(::af_memory_manager_set_add_memory_management_fn(arena->handle, &arenaAddMemoryManagement));
+    afCheck(::af_memory_manager_set_remove_memory_management_fn(arena->handle, &arenaRemoveMemoryManagement));
+    afCheck(::af_set_memory_manager(arena->handle));
+
+    #undef afCheck
+
+    return true;
+}
+
+void installMemoryManagers(const std::vector<af::Backend>& backends)
+{
+    if("default" == Poco::toLower(Poco::Environment::get("POTHOSGPU_MEMORY_MANAGER", "")))
+    {
+        return;
+    }
+
+    auto& backendArenas = getBackendArenas();
+    for(const auto& backend: backends)
+    {
+        setThreadBackend(backend);
+
+        // ArrayFire may call into the manager while shutting down, after
+        // static destructors have run, so arenas are never freed.
+        auto* arena = new BackendArena(backend);
+        if(installMemoryManager(arena)) backendArenas.emplace(backend, arena);
+    }
+}
+
+//
+// Public API
+//
+
+// Managers are installed when devices are first enumerated, so make sure
+// that has finished before reading the arenas.
+static const std::map<af::Backend, BackendArena*>& getInstalledBackendArenas()
+{
+    (void)getAvailableBackends();
+
+    return getBackendArenas();
+}
+
+bool memoryManagerInstalled()
+{
+    return !getInstalledBackendArenas().empty();
+}
+
+template <typename Func>
+static void withDeviceArena(
+    af::Backend backend,
+    int device,
+    const Func& func)
+{
+    const auto& backendArenas = getInstalledBackendArenas();
+
+    auto arenaIter = backendArenas.find(backend);
+    if(backendArenas.end() == arenaIter) return;
+
+    auto* arena = arenaIter->second;
+    std::lock_guard<std::mutex> lock(arena->mutex);
+
+    auto deviceIter = arena->devices.find(device);
+    if(arena->devices.end() != deviceIter) func(*arena, deviceIter->second);
+}
+
+size_t memoryLiveBytes(
+    af::Backend backend,
+    int device)
+{
+    size_t liveBytes = 0;
+    withDeviceArena(
+        backend,
+        device,
+        [&liveBytes](BackendArena&, DeviceArena& deviceArena)
+        {
+            liveBytes = deviceArena.liveBytes;
+        });
+
+    return liveBytes;
+}
+
+void releaseMemoryCache(
+    af::Backend backend,
+    int device)
+{
+    withDeviceArena(backend, device, &releaseDeviceCache);
+}
+
+static MemoryUsage getNativeMemoryUsage()
+{
+    MemoryUsage usage = {0, 0, 0, 0};
+    af::deviceMemInfo(
+        &usage.allocatedBytes,
+        &usage.allocatedBuffers,
+        &usage.lockedBytes,
+        &usage.lockedBuffers);
+
+    return usage;
+}
+
+MemoryUsage memoryUsage(
+    af::Backend backend,
+    int device)
+{
+    // ArrayFire doesn't ask custom memory managers for usage info.
+    if(!memoryManagerInstalled()) return getNativeMemoryUsage();
+
+    MemoryUsage usage = {0, 0, 0, 0};
+    withDeviceArena(
+        backend,
+        device,
+        [&usage](BackendArena&, DeviceArena& deviceArena)
+        {
+            size_t cachedBuffers = 0;
+            for(const auto& freeList: deviceArena.freeLists) cachedBuffers += freeList.second.size();
+
+            usage.allocatedBytes = deviceArena.liveBytes + deviceArena.cachedBytes;
+            usage.allocatedBuffers = deviceArena.allocations.size() + cachedBuffers;
+            usage.lockedBytes = deviceArena.liveBytes;
+            usage.lockedBuffers = deviceArena.allocations.size();
+        });
+
+    return usage;
+}
+
+static size_t getMemoryInUse(
+    af::Backend backend,
+    int device)
+{
+    // Cached buffers can be released, so they don't count here.
+    return memoryUsage(backend, device).lockedBytes;
+}
+
+json memoryStatsToJSON(
+    af::Backend backend,
+    int device)
+{
+    // Looking these up can initialize the device cache or take the budget
+    // lock, neither of which should happen with the arena locked.
+    const auto deviceName = getDeviceName(backend, device);
+    const auto budget = deviceMemoryBudget(backend, device);
+
+    json statsJSON;
+    withDeviceArena(
+        backend,
+        device,
+        [&](BackendArena&, DeviceArena& deviceArena)
+        {
+            statsJSON["Device"] = deviceName;
+            statsJSON["Backend"] = Pothos::Object(backend).convert<std::string>();
+            statsJSON["Live Bytes"] = deviceArena.liveBytes;
+            statsJSON["Peak Live Bytes"] = deviceArena.peakLiveBytes;
+            statsJSON["Cached Bytes"] = deviceArena.cachedBytes;
+            statsJSON["Cache Limit"] = memoryCacheLimit();
+            statsJSON["Budget"] = budget;
+            statsJSON["Cached Sizes"] = deviceArena.freeLists.size();
+            statsJSON["Allocations"] = deviceArena.allocCalls;
+            statsJSON["Cache Hits"] = deviceArena.cacheHits;
+            statsJSON["Native Allocations"] = deviceArena.nativeAllocs;
+            statsJSON["Native Frees"] = deviceArena.nativeFrees;
+            statsJSON["Cache Releases"] = deviceArena.cacheReleases;
+        });
+
+    return statsJSON;
+}
+
+json allMemoryStatsToJSON()
+{
+    std::vector<std::pair<af::Backend, int>> devices;
+    for(const auto& backendArena: getInstalledBackendArenas())
+    {
+        std::lock_guard<std::mutex> lock(backendArena.second->mutex);
+        for(const auto& device: backendArena.second->devices)
+        {
+            devices.emplace_back(backendArena.first, device.first);
+        }
+    }
+
+    json ret(json::array());
+    for(const auto& device: devices)
+    {
+        ret.push_back(memoryStatsToJSON(device.first, device.second));
+    }
+
+    return ret;
+}
+
+#else
+
+// ArrayFire's default memory manager is used.
+
+void installMemoryManagers(const std::vector<af::Backend>&)
+{
+}
+
+bool memoryManagerInstalled()
+{
+    return false;
+}
+
+size_t memoryLiveBytes(af::Backend, int)
+{
+    return 0;
+}
+
+void releaseMemoryCache(af::Backend, int)
+{
+}
+
+MemoryUsage memoryUsage(af::Backend, int)
+{
+    MemoryUsage usage = {0, 0, 0, 0};
+    af::deviceMemInfo(
+        &usage.allocatedBytes,
+        &usage.allocatedBuffers,
+        &usage.lockedBytes,
+        &usage.lockedBuffers);
+
+    return usage;
+}
+
+static size_t getMemoryInUse(
+    af::Backend backend,
+    int device)
+{
+    return memoryUsage(backend, device).lockedBytes;
+}
+
+json memoryStatsToJSON(af::Backend, int)
+{
+    return json();
+}
+
+json allMemoryStatsToJSON()
+{
+    return json(json::array());
+}
+
+#endif
+
+bool memoryUnderPressure(
+    af::Backend backend,
+    int device)
+{
+    const size_t budget = deviceMemoryBudget(backend, device);
+    if(0 == budget) return false;
+
+    return (static_cast<double>(getMemoryInUse(backend, device)) >= (PressureFraction * static_cast<double>(budget)));
+}
@@ -0,0 +1,99 @@
+// Copyright (c) 2021 Nicholas Corgan
+// SPDX-License-Identifier: BSD-3-Clause
+
+#pragma once
+
+#include <nlohmann/json.hpp>
+
+#include <arrayfire.h>
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+//
+// A replacement for ArrayFire's default memory manager (ArrayFire 3.7+).
+//
+// Streaming blocks allocate arrays of the same few sizes on every work()
+// call. ArrayFire's default manager rounds allocations up to its step size
+// and periodically garbage collects, which shows up as latency spikes. This
+// manager instead keeps a free list per exact allocation size on each
+// device, so a steady stream reuses the same buffers indefinitely.
+//
+// Freed buffers are kept up to a per-device cache limit, beyond which they
+// are released to the device. If an allocation fails, the device's cache is
+// released and the allocation is retried.
+//
+// The manager is installed for every backend when devices are first
+// enumerated, unless POTHOSGPU_MEMORY_MANAGER is set to "default". The cache limit can be set
+// with POTHOSGPU_MEMORY_CACHE_MB.
+//
+// Each device can also be given a memory budget, either for all devices
+// with POTHOSGPU_MEMORY_BUDGET_MB or per device with setMemoryBudget().
+// Allocations that would go over a device's budget fail, and blocks wait
+// for memory to be freed before processing while a device is near its
+// budget (see ArrayFireBlock::deferForMemory() for which blocks do).
+//
+
+// Called once by the device cache, before any arrays are allocated.
+void installMemoryManagers(const std::vector<af::Backend>& backends);
+
+bool memoryManagerInstalled();
+
+// In bytes, per device
+size_t memoryCacheLimit();
+
+void setMemoryCacheLimit(size_t bytes);
+
+// Bytes currently allocated to arrays on the given device, not including
+// cached buffers.
+size_t memoryLiveBytes(
+    af::Backend backend,
+    int device);
+
+struct MemoryUsage
+{
+    // Includes buffers held for reuse
+    size_t allocatedBytes;
+    size_t allocatedBuffers;
+
+    // Buffers in use by arrays
+    size_t lockedBytes;
+    size_t lockedBuffers;
+};
+
+// Without the custom memory manager, this relies on ArrayFire's memory
+// info, so the device must be active in the calling thread.
+MemoryUsage memoryUsage(
+    af::Backend backend,
+    int device);
+
+// Releases all cached buffers on the given device.
+void releaseMemoryCache(
+    af::Backend backend,
+    int device);
+
+// Takes a device name or "Platform:Index". 0 means no budget.
+size_t memoryBudget(const std::string& device);
+
+size_t deviceMemoryBudget(
+    af::Backend backend,
+    int device);
+
+void setMemoryBudget(
+    const std::string& device,
+    size_t bytes);
+
+// Whether the device is close enough to its budget that new work should
+// wait. Without the custom memory manager, this relies on ArrayFire's
+// memory info, so the device must be active in the calling thread.
+bool memoryUnderPressure(
+    af::Backend backend,
+    int device);
+
+nlohmann::json memoryStatsToJSON(
+    af::Backend backend,
+    int device);
+
+// Stats for every device that has allocated memory
+nlohmann::json allMemoryStatsToJSON();
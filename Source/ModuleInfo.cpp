@@ -1,7 +1,14 @@
-// Copyright (c) 2019 Nicholas Corgan
+// Copyright (c) 2019-2021 Nicholas Corgan
 // SPDX-License-Identifier: BSD-3-Clause
 
+#include "BlockStats.hpp"
+#include "BlockTrace.hpp"
+#include "DeviceBenchmark.hpp"
 #include "DeviceCache.hpp"
+#include "DevicePlacement.hpp"
+#include "DeviceThreads.hpp"
+#include "MemoryManager.hpp"
+#include "SharedBufferAllocator.hpp"
 #include "Utility.hpp"
 
 #include <Pothos/Plugin.hpp>
@@ -23,14 +30,24 @@ static json deviceCacheEntryToJSON(const DeviceCacheEntry& entry)
     json deviceJSON;
     deviceJSON["Name"] = entry.name;
     deviceJSON["Platform"] = entry.platform;
+    deviceJSON["Backend"] = Pothos::Object(entry.afBackendEnum).convert<std::string>();
     deviceJSON["Toolkit"] = entry.toolkit;
     deviceJSON["Compute"] = entry.compute;
     deviceJSON["Memory Step Size"] = entry.memoryStepSize;
 
+    if(isDeviceBenchmarked(entry))
+    {
+        deviceJSON["H2D Bandwidth (GB/s)"] = entry.h2dGBPerSec;
+        deviceJSON["D2H Bandwidth (GB/s)"] = entry.d2hGBPerSec;
+        deviceJSON["Elementwise Throughput (GElem/s)"] = entry.elementwiseGElemsPerSec;
+        deviceJSON["FFT Throughput (MSamples/s)"] = entry.fftMSamplesPerSec;
+        deviceJSON["Score"] = deviceScore(entry);
+    }
+
     return deviceJSON;
 }
 
-static std::string _enumerateArrayFireDevices()
+static json _enumerateArrayFireDevices()
 {
     json topObject;
     auto& arrayFireInfo = topObject["PothosGPU Library Info"];
@@ -60,19 +77,117 @@ static std::string _enumerateArrayFireDevices()
                                               std::begin(availableBackends),
                                               std::end(availableBackends));
 
-    return topObject.dump();
+    return topObject;
 }
 
 static std::string enumerateArrayFireDevices()
 {
-    // Only do this once
-    static const std::string devs = _enumerateArrayFireDevices();
+    // Only enumerate devices once
+    static const json devs = _enumerateArrayFireDevices();
+
+    // Block stats change over time, so always get the latest.
+    auto topObject = devs;
+    auto blockStats = BlockStats::allToJSON();
+    if(!blockStats.empty()) topObject["PothosGPU Block Stats"] = blockStats;
+
+    auto memoryStats = allMemoryStatsToJSON();
+    if(!memoryStats.empty()) topObject["PothosGPU Memory Stats"] = memoryStats;
+
+    return topObject.dump();
+}
+
+static json deviceCacheEntryStatsToJSON(const DeviceCacheEntry& entry)
+{
+    // Only needed for ArrayFire's own memory info
+    setThreadBackendAndDevice(entry.afBackendEnum, entry.afDeviceIndex);
+    const auto usage = memoryUsage(entry.afBackendEnum, entry.afDeviceIndex);
+
+    auto statsJSON = BlockStats::deviceTotalsToJSON(entry.afBackendEnum, entry.afDeviceIndex);
+    statsJSON["Name"] = entry.name;
+    statsJSON["Backend"] = Pothos::Object(entry.afBackendEnum).convert<std::string>();
+    statsJSON["Device Index"] = entry.afDeviceIndex;
+    statsJSON["Allocated Bytes"] = usage.allocatedBytes;
+    statsJSON["Allocated Buffers"] = usage.allocatedBuffers;
+    statsJSON["Locked Bytes"] = usage.lockedBytes;
+    statsJSON["Locked Buffers"] = usage.lockedBuffers;
+
+    // Allocated but not in use, so available without a new allocation. This
+    // is not the device's free memory, which ArrayFire doesn't report.
+    statsJSON["Cached Bytes"] = usage.allocatedBytes - std::min(usage.lockedBytes, usage.allocatedBytes);
+
+    const auto budget = deviceMemoryBudget(entry.afBackendEnum, entry.afDeviceIndex);
+    if(budget > 0) statsJSON["Budget"] = budget;
+
+    return statsJSON;
+}
 
-    return devs;
+// Unlike /devices/gpu/info, nothing here is cached, so this can be polled.
+static std::string getDeviceStats()
+{
+    json topObject;
+
+    json devicesJSON(json::array());
+    for(const auto& entry: getDeviceCache())
+    {
+        devicesJSON.push_back(deviceCacheEntryStatsToJSON(entry));
+    }
+    topObject["Devices"] = devicesJSON;
+
+    json pinnedJSON(json::array());
+    for(const auto& backend: getAvailableBackends())
+    {
+        const auto usage = pinnedMemoryUsage(backend);
+
+        json backendJSON;
+        backendJSON["Backend"] = Pothos::Object(backend).convert<std::string>();
+        backendJSON["Bytes"] = usage.bytes;
+        backendJSON["Buffers"] = usage.buffers;
+        pinnedJSON.push_back(backendJSON);
+    }
+    topObject["Pinned Memory"] = pinnedJSON;
+
+    return topObject.dump();
+}
+
+static std::string getMemoryStats()
+{
+    return allMemoryStatsToJSON().dump();
 }
 
 pothos_static_block(registerGPUInfo)
 {
     Pothos::PluginRegistry::addCall(
         "/devices/gpu/info", &enumerateArrayFireDevices);
+    Pothos::PluginRegistry::addCall(
+        "/devices/gpu/stats", &getDeviceStats);
+    Pothos::PluginRegistry::addCall(
+        "/devices/gpu/block_stats_enabled", &BlockStats::allEnabled);
+    Pothos::PluginRegistry::addCall(
+        "/devices/gpu/set_block_stats_enabled", &BlockStats::setAllEnabled);
+    Pothos::PluginRegistry::addCall(
+        "/devices/gpu/start_trace", &BlockTrace::start);
+    Pothos::PluginRegistry::addCall(
+        "/devices/gpu/stop_trace", &BlockTrace::stop);
+    Pothos::PluginRegistry::addCall(
+        "/devices/gpu/trace_file", &BlockTrace::filepath);
+    Pothos::PluginRegistry::addCall(
+        "/devices/gpu/auto_device_policy", &autoDevicePolicy);
+    Pothos::PluginRegistry::addCall(
+        "/devices/gpu/set_auto_device_policy", &setAutoDevicePolicy);
+    Pothos::PluginRegistry::addCall(
+        "/devices/gpu/device_threads_per_pool", &deviceThreadsPerPool);
+    Pothos::PluginRegistry::addCall(
+        "/devices/gpu/set_device_threads_per_pool", &setDeviceThreadsPerPool);
+    Pothos::PluginRegistry::addCall(
+        "/devices/gpu/memory_manager_installed", &memoryManagerInstalled);
+    Pothos::PluginRegistry::addCall(
+        "/devices/gpu/memory_stats", &getMemoryStats);
+    Pothos::PluginRegistry::addCall(
+        "/devices/gpu/memory_cache_limit", &memoryCacheLimit);
+    Pothos::PluginRegistry::addCall(
+        "/devices/gpu/set_memory_cache_limit", &setMemoryCacheLimit);
+    Pothos::PluginRegistry::addCall(
+        "/devices/gpu/memory_budget", &memoryBudget);
+    Pothos::PluginRegistry::addCall(
+        "/devices/gpu/set_memory_budget", &setMemoryBudget);
 }
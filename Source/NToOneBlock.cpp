@@ -1,4 +1,4 @@
-// Copyright (c) 2019-2020 Nicholas Corgan
+// Copyright (c) 2019-2021 Nicholas Corgan
 // SPDX-License-Identifier: BSD-3-Clause
 
 #include "NToOneBlock.hpp"
@@ -96,6 +96,9 @@ NToOneBlock::NToOneBlock(
         this->setupInput(chan, dtype, _domain);
     }
     this->setupOutput(0, dtype, _domain);
+
+    this->enableBatching();
+    this->enableFailover();
 }
 
 NToOneBlock::~NToOneBlock() {}
@@ -109,15 +112,27 @@ void NToOneBlock::work()
         return;
     }
 
-    auto afArray = this->getInputPortAsAfArray(0);
-    auto outputAfArray = afArray;
-
-    for(size_t chan = 1; chan < _nchans; ++chan)
+    if(this->deferForMemory() || this->deferForBatch(elems))
     {
-        afArray = this->getInputPortAsAfArray(chan);
-        outputAfArray = _func.call(outputAfArray, afArray).template extract<af::array>();
+        return;
     }
 
-    if(_postBuffer) this->postAfArray(0, outputAfArray);
-    else            this->produceFromAfArray(0, outputAfArray);
+    auto workTimer = this->timeStage(BlockStage::Work);
+
+    this->runWithFailover([&]()
+    {
+        auto afArray = this->getInputPortAsAfArray(0);
+        auto outputAfArray = afArray;
+
+        for(size_t chan = 1; chan < _nchans; ++chan)
+        {
+            afArray = this->getInputPortAsAfArray(chan);
+
+            auto timer = this->timeStage(BlockStage::Compute);
+            outputAfArray = _func.call(outputAfArray, afArray).template extract<af::array>();
+        }
+
+        if(_postBuffer) this->postAfArray(0, outputAfArray);
+        else            this->produceFromAfArray(0, outputAfArray);
+    });
 }
@@ -1,6 +1,7 @@
-// Copyright (c) 2020 Nicholas Corgan
+// Copyright (c) 2020-2021 Nicholas Corgan
 // SPDX-License-Identifier: BSD-3-Clause
 
+#include "DeviceThreads.hpp"
 #include "Utility.hpp"
 
 #include <Pothos/Object.hpp>
@@ -31,7 +32,7 @@ static int compareAfArray(const AfArrType& arr0, const AfArrType& arr1)
         return (af::getBackendId(arr0) < af::getBackendId(arr1)) ? -1 : 1;
     }
 
-    af::setBackend(af::getBackendId(arr0));
+    setThreadBackend(af::getBackendId(arr0));
 
     // Note: the C++ equality operators for ArrayFire types results in
     // another ArrayFire array with the results of a per-element comparison,
@@ -64,7 +65,7 @@ template <class Archive>
 void save(Archive& ar, const af::array& afArray, const unsigned int)
 {
     // Only for this thread
-    af::setBackend(af::getBackendId(afArray));
+    setThreadBackend(af::getBackendId(afArray));
 
     std::vector<unsigned char> hostVec(afArray.bytes());
     afArray.host(hostVec.data());
@@ -97,7 +98,7 @@ void load(Archive& ar, af::array& afArray, const unsigned int)
     ar >> typeInt;
 
     // Only for this thread.
-    af::setBackend(static_cast<af::Backend>(backendInt));
+    setThreadBackend(static_cast<af::Backend>(backendInt));
 
     afArray = af::array(dims, static_cast<af::dtype>(typeInt));
     afArray.write(hostVec.data(), hostVec.size(), ::afHost);
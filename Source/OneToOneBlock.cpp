@@ -1,7 +1,9 @@
-// Copyright (c) 2019-2020 Nicholas Corgan
+// Copyright (c) 2019-2021 Nicholas Corgan
 // SPDX-License-Identifier: BSD-3-Clause
 
 #include "BufferConversions.hpp"
+#include "DeviceThreads.hpp"
+#include "EnumConversions.hpp"
 #include "OneToOneBlock.hpp"
 #include "Utility.hpp"
 
@@ -14,10 +16,15 @@
 #include <Poco/Format.h>
 #include <Poco/NumberFormatter.h>
 
+#include <algorithm>
 #include <cassert>
 #include <cstring>
+#include <exception>
+#include <functional>
+#include <future>
 #include <string>
 #include <typeinfo>
+#include <vector>
 
 //
 // Factories
@@ -42,7 +49,12 @@ Pothos::Block* OneToOneBlock::makeFromOneTypeCallable(
 {
     validateDType(dtype, supportedTypes);
 
-    return new OneToOneBlock(device, func, dtype, dtype);
+    // These wrap functions like af::flip and af::setUnique, whose outputs
+    // depend on the whole buffer.
+    auto* block = new OneToOneBlock(device, func, dtype, dtype);
+    block->_canShard = false;
+
+    return block;
 }
 
 Pothos::Block* OneToOneBlock::makeFloatToComplex(
@@ -50,26 +62,26 @@ Pothos::Block* OneToOneBlock::makeFloatToComplex(
     const OneToOneFunc& func,
     const Pothos::DType& floatType)
 {
-    if(!isDTypeFloat(floatType))
-    {
-        throw Pothos::InvalidArgumentException(
-                  "This block must take a float type.",
-                  "Given: " + floatType.name());
-    }
-
-    Pothos::DType complexDType("complex_"+floatType.name());
-
     return new OneToOneBlock(
                    device,
                    func,
                    floatType,
-                   complexDType);
+                   getComplexDType(floatType));
 }
 
 Pothos::Block* OneToOneBlock::makeComplexToFloat(
     const std::string& device,
     const OneToOneFunc& func,
     const Pothos::DType& floatType)
+{
+    return new OneToOneBlock(
+                   device,
+                   func,
+                   getComplexDType(floatType),
+                   floatType);
+}
+
+Pothos::DType OneToOneBlock::getComplexDType(const Pothos::DType& floatType)
 {
     if(!isDTypeFloat(floatType))
     {
@@ -78,13 +90,7 @@ Pothos::Block* OneToOneBlock::makeComplexToFloat(
                   "Given: " + floatType.name());
     }
 
-    Pothos::DType complexDType("complex_"+floatType.name());
-
-    return new OneToOneBlock(
-                   device,
-                   func,
-                   complexDType,
-                   floatType);
+    return Pothos::DType("complex_"+floatType.name());
 }
 
 //
@@ -95,12 +101,14 @@ OneToOneBlock::OneToOneBlock(
     const std::string& device,
     const OneToOneFunc& func,
     const Pothos::DType& inputDType,
-    const Pothos::DType& outputDType
+    const Pothos::DType& outputDType,
+    size_t numChannels
 ): OneToOneBlock(
        device,
        Pothos::Callable(func),
        inputDType,
-       outputDType)
+       outputDType,
+       numChannels)
 {
 }
 
@@ -108,13 +116,34 @@ OneToOneBlock::OneToOneBlock(
     const std::string& device,
     const Pothos::Callable& func,
     const Pothos::DType& inputDType,
-    const Pothos::DType& outputDType
+    const Pothos::DType& outputDType,
+    size_t numChannels
 ): ArrayFireBlock(device),
    _func(func),
-   _afOutputDType(Pothos::Object(outputDType).convert<af::dtype>())
+   _afOutputDType(Pothos::Object(outputDType).convert<af::dtype>()),
+   _nchans(numChannels),
+   _canShard(1 == numChannels),
+   _shardDevices(),
+   _shardWorkers()
 {
-    this->setupInput(0, inputDType, _domain);
-    this->setupOutput(0, outputDType, _domain);
+    if(0 == numChannels)
+    {
+        throw Pothos::InvalidArgumentException("numChannels must be >= 1.");
+    }
+
+    for(size_t chan = 0; chan < _nchans; ++chan)
+    {
+        this->setupInput(chan, inputDType, _domain);
+        this->setupOutput(chan, outputDType, _domain);
+    }
+
+    this->registerCall(this, POTHOS_FCN_TUPLE(OneToOneBlock, shardDevices));
+    this->registerCall(this, POTHOS_FCN_TUPLE(OneToOneBlock, setShardDevices));
+    this->registerProbe("shardDevices");
+
+    this->enableAutoOffload();
+    this->enableBatching();
+    this->enableFailover();
 }
 
 OneToOneBlock::~OneToOneBlock() {}
@@ -124,22 +153,212 @@ void OneToOneBlock::work()
 {
     // The thread may have changed since the block was created, so make sure
     // the backend and device still match.
-    af::setBackend(_afBackend);
-    af::setDevice(_afDevice);
+    this->configArrayFire();
 
-    const size_t elems = this->workInfo().minElements;
+    const size_t elems = this->workInfo().minAllElements;
     if(0 == elems)
     {
         return;
     }
 
-    auto afInput = this->getInputPortAsAfArray(0);
+    if(this->deferForMemory() || this->deferForBatch(elems))
+    {
+        return;
+    }
+
+    auto workTimer = this->timeStage(BlockStage::Work);
+
+    this->runWithFailover([&]()
+    {
+        auto hostBackend = this->hostBackendIfSmall(elems * _nchans);
+
+        // After a fault, the shard devices may be the problem.
+        if(!hostBackend.active() && !_shardDevices.empty() && !this->failedOver())
+        {
+            this->shardedWork(elems);
+            return;
+        }
+
+        // Channels are processed as the columns of a single array, so there
+        // is one kernel for all of them.
+        auto afInput = (_nchans > 1) ? this->getInputPortsAsAfArray(_nchans)
+                                     : this->getInputPortAsAfArray(0);
+
+        af::array afOutput;
+        {
+            auto timer = this->timeStage(BlockStage::Compute);
+
+            afOutput = this->applyFuncOnCurrentDevice(afInput);
+
+            if(afOutput.type() != _afOutputDType)
+            {
+                afOutput = afOutput.as(_afOutputDType);
+            }
+        }
+
+        if(_nchans > 1) this->produceFromAfArrayColumns(afOutput);
+        else            this->produceFromAfArray(0, afOutput);
+    });
+}
+
+size_t OneToOneBlock::measureCrossoverElements()
+{
+    return this->timeCrossoverElements(
+               {pothosDTypeToAfDType(this->input(0)->dtype())},
+               [this](const std::vector<af::array>& afInputs)
+               {
+                   return this->applyFuncOnCurrentDevice(afInputs[0]);
+               });
+}
+
+af::array OneToOneBlock::applyFunc(const af::array& afInput)
+{
+    return _func.call(afInput).extract<af::array>();
+}
+
+// Any bound arrays are on the block's device, so they can't be used on the
+// host backend or after failing over.
+af::array OneToOneBlock::applyFuncOnCurrentDevice(const af::array& afInput)
+{
+    if(_onHostBackend || this->failedOver())
+    {
+        return this->shardFunc().call(afInput).extract<af::array>();
+    }
+
+    return this->applyFunc(afInput);
+}
+
+//
+// Sharding
+//
+
+std::vector<std::string> OneToOneBlock::shardDevices() const
+{
+    std::vector<std::string> shardDevices;
+    for(const auto* entry: _shardDevices) shardDevices.emplace_back(entry->name);
+
+    return shardDevices;
+}
+
+void OneToOneBlock::setShardDevices(const std::vector<std::string>& shardDevices)
+{
+    if(!_canShard && !shardDevices.empty())
+    {
+        throw Pothos::InvalidArgumentException("This block's computation cannot be split across devices.");
+    }
+
+    std::vector<const DeviceCacheEntry*> entries;
+    for(const auto& device: shardDevices) entries.emplace_back(&getDeviceCacheEntry(device));
+
+    _shardDevices = std::move(entries);
+
+    _shardWorkers.clear();
+    for(size_t shard = 1; shard < _shardDevices.size(); ++shard)
+    {
+        _shardWorkers.emplace_back(new DeviceWorker);
+    }
+}
+
+size_t OneToOneBlock::shardHalo() const
+{
+    return 0;
+}
+
+Pothos::Callable OneToOneBlock::shardFunc() const
+{
+    return _func;
+}
+
+void OneToOneBlock::shardedWork(size_t elems)
+{
+    const auto inputBuffer = this->input(0)->buffer();
+    const auto outputBuffer = this->output(0)->buffer();
+    const size_t inputSize = this->input(0)->dtype().size();
+    const size_t outputSize = this->output(0)->dtype().size();
+
+    const size_t numShards = std::min(_shardDevices.size(), elems);
+    const size_t halo = this->shardHalo();
 
-    auto afOutput = _func.call(afInput).extract<af::array>();
-    if(afOutput.type() != _afOutputDType)
+    auto processShard = [&](size_t shard)
     {
-        afOutput = afOutput.as(_afOutputDType);
+        const size_t begin = (shard * elems) / numShards;
+        const size_t end = ((shard + 1) * elems) / numShards;
+
+        // A piece's history comes from the previous piece's input, but
+        // like the unsharded path, nothing comes before the buffer.
+        const size_t pieceHalo = std::min(begin, halo);
+
+        auto shardInput = inputBuffer;
+        shardInput.address = inputBuffer.address + ((begin - pieceHalo) * inputSize);
+        shardInput.length = (end - begin + pieceHalo) * inputSize;
+
+        const auto* entry = _shardDevices[shard];
+        setThreadBackendAndDevice(entry->afBackendEnum, entry->afDeviceIndex);
+
+        auto afInput = bufferChunkToAfArray(shardInput);
+        af::array afOutput = this->shardFunc().call(afInput).extract<af::array>();
+        if(static_cast<size_t>(afOutput.elements()) != (end - begin + pieceHalo))
+        {
+            throw Pothos::AssertionViolationException(
+                      "A shard's output size did not match its input size.",
+                      Poco::format(
+                          "Input: %s elements, output: %s elements",
+                          Poco::NumberFormatter::format(end - begin + pieceHalo),
+                          Poco::NumberFormatter::format(afOutput.elements())));
+        }
+        if(afOutput.type() != _afOutputDType)
+        {
+            afOutput = afOutput.as(_afOutputDType);
+        }
+        if(pieceHalo > 0)
+        {
+            afOutput = afOutput(af::seq(static_cast<double>(pieceHalo), static_cast<double>(afOutput.elements() - 1)));
+        }
+
+        afOutput.host(reinterpret_cast<void*>(outputBuffer.address + (begin * outputSize)));
+    };
+
+    {
+        auto timer = this->timeStage(BlockStage::Compute);
+
+        std::vector<std::future<void>> futures;
+        for(size_t shard = 1; shard < numShards; ++shard)
+        {
+            futures.emplace_back(_shardWorkers[shard-1]->run(std::bind(processShard, shard)));
+        }
+
+        // The other shards reference this function's buffers, so they must
+        // finish before any error is thrown.
+        std::exception_ptr error;
+        try
+        {
+            processShard(0);
+        }
+        catch(...)
+        {
+            error = std::current_exception();
+        }
+        this->configArrayFire();
+
+        for(auto& future: futures)
+        {
+            try
+            {
+                future.get();
+            }
+            catch(...)
+            {
+                if(!error) error = std::current_exception();
+            }
+        }
+
+        if(error) std::rethrow_exception(error);
     }
 
-    this->produceFromAfArray(0, afOutput);
+    _stats->addBytesH2D(elems * inputSize);
+    _stats->addBytesD2H(elems * outputSize);
+    _stats->addCall(elems);
+
+    this->input(0)->consume(elems);
+    this->output(0)->produce(elems);
 }
@@ -1,9 +1,11 @@
-// Copyright (c) 2019-2020 Nicholas Corgan
+// Copyright (c) 2019-2021 Nicholas Corgan
 // SPDX-License-Identifier: BSD-3-Clause
 
 #pragma once
 
 #include "ArrayFireBlock.hpp"
+#include "DeviceCache.hpp"
+#include "DeviceWorker.hpp"
 #include "Utility.hpp"
 
 #include <Pothos/Callable.hpp>
@@ -12,6 +14,7 @@
 #include <arrayfire.h>
 
 #include <string>
+#include <vector>
 
 using OneToOneFunc = af::array(*)(const af::array&);
 
@@ -48,26 +51,169 @@ class OneToOneBlock: public ArrayFireBlock
         // Class implementation
         //
 
+        // With multiple channels, each input is processed into the output
+        // with the same index. All channels are gathered into one array, so
+        // the function is applied once per call to work(), which only suits
+        // element-wise functions.
         OneToOneBlock(
             const std::string& device,
             const OneToOneFunc& func,
             const Pothos::DType& inputDType,
-            const Pothos::DType& outputDType);
+            const Pothos::DType& outputDType,
+            size_t numChannels = 1);
 
         OneToOneBlock(
             const std::string& device,
             const Pothos::Callable& func,
             const Pothos::DType& inputDType,
-            const Pothos::DType& outputDType);
+            const Pothos::DType& outputDType,
+            size_t numChannels = 1);
 
         virtual ~OneToOneBlock();
 
         void work() override;
 
+        //
+        // Sharding
+        //
+        // If shard devices are set, each buffer is split into contiguous
+        // pieces, one per device, and the pieces are processed in
+        // parallel. The first piece is processed in the block's thread,
+        // and the rest in one persistent thread per device. An empty list
+        // processes buffers on the block's device as usual. Multi-channel
+        // blocks can't be sharded.
+        //
+
+        std::vector<std::string> shardDevices() const;
+
+        void setShardDevices(const std::vector<std::string>& shardDevices);
+
     protected:
 
+        size_t measureCrossoverElements() override;
+
+        // Applies the block's function in the calling thread. By default,
+        // this calls _func.
+        virtual af::array applyFunc(const af::array& afInput);
+
+        // Calls applyFunc() on the block's device, and shardFunc() anywhere
+        // else.
+        af::array applyFuncOnCurrentDevice(const af::array& afInput);
+
+        // Throws if the given type isn't a float type.
+        static Pothos::DType getComplexDType(const Pothos::DType& floatType);
+
+        // How many preceding input elements each piece needs to compute
+        // its first output, such as a filter's history.
+        virtual size_t shardHalo() const;
+
+        // Called in the thread processing each piece, after its device
+        // is set, and when running on the host backend or after failing
+        // over, so subclasses can re-create any bound arrays on the
+        // current device.
+        virtual Pothos::Callable shardFunc() const;
+
+        void shardedWork(size_t elems);
+
         Pothos::Callable _func;
 
         // We need to store this since ArrayFire may change the output type.
         af::dtype _afOutputDType;
+
+        size_t _nchans;
+
+        // Only blocks whose outputs depend on a fixed window of inputs
+        // can be split.
+        bool _canShard;
+        std::vector<const DeviceCacheEntry*> _shardDevices;
+
+        // Indexed by shard, starting with the second
+        std::vector<DeviceWorker::UPtr> _shardWorkers;
 };
+
+//
+// Calling _func boxes the input and output in Pothos::Objects and goes
+// through a type-erased call on every buffer. Blocks whose function is
+// known at compile time use this instead, which calls the function
+// directly. FuncType must have a static af::array call(const af::array&).
+//
+// _func is still set, for sharding and failover.
+//
+template <typename FuncType>
+class DirectOneToOneBlock: public OneToOneBlock
+{
+    public:
+        static Pothos::Block* makeFromOneType(
+            const std::string& device,
+            const Pothos::DType& dtype,
+            size_t numChannels,
+            const DTypeSupport& supportedTypes)
+        {
+            validateDType(dtype, supportedTypes);
+
+            return new DirectOneToOneBlock(device, dtype, dtype, numChannels);
+        }
+
+        static Pothos::Block* makeFloatToComplex(
+            const std::string& device,
+            const Pothos::DType& floatType,
+            size_t numChannels)
+        {
+            return new DirectOneToOneBlock(device, floatType, getComplexDType(floatType), numChannels);
+        }
+
+        static Pothos::Block* makeComplexToFloat(
+            const std::string& device,
+            const Pothos::DType& floatType,
+            size_t numChannels)
+        {
+            return new DirectOneToOneBlock(device, getComplexDType(floatType), floatType, numChannels);
+        }
+
+        DirectOneToOneBlock(
+            const std::string& device,
+            const Pothos::DType& inputDType,
+            const Pothos::DType& outputDType,
+            size_t numChannels
+        ):
+            OneToOneBlock(device, &FuncType::call, inputDType, outputDType, numChannels)
+        {
+        }
+
+        virtual ~DirectOneToOneBlock() = default;
+
+    protected:
+        af::array applyFunc(const af::array& afInput) override
+        {
+            return FuncType::call(afInput);
+        }
+};
+
+// For functions defined in this module. ArrayFire's own functions can't be
+// template arguments on platforms where they're imported from a DLL.
+template <OneToOneFunc Func>
+struct OneToOneFuncCaller
+{
+    static af::array call(const af::array& afInput)
+    {
+        return Func(afInput);
+    }
+};
+
+//
+// Registers a DirectOneToOneBlock factory taking (device, dtype, numChannels)
+// at the given path, along with an overload without numChannels that makes
+// a single-channel block, so existing (device, dtype) callers keep working.
+// Pothos resolves factories registered at the same path by their number of
+// arguments.
+//
+inline std::vector<Pothos::BlockRegistry> makeOneToOneBlockRegistries(
+    const std::string& path,
+    const Pothos::Callable& factory)
+{
+    return
+    {
+        Pothos::BlockRegistry(path, Pothos::Callable(factory).bind<size_t>(1, 2)),
+        Pothos::BlockRegistry(path, factory)
+    };
+}
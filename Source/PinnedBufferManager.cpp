@@ -1,9 +1,10 @@
 // Copyright (c) 2013-2016 Josh Blum
-//                    2020 Nicholas Corgan
+//                    2020-2021 Nicholas Corgan
 // SPDX-License-Identifier: BSD-3-Clause
 
 #include "BufferConversions.hpp"
 #include "DeviceCache.hpp"
+#include "DeviceThreads.hpp"
 #include "SharedBufferAllocator.hpp"
 #include "Utility.hpp"
 
@@ -36,8 +37,7 @@ public:
 
     void init(const Pothos::BufferManagerArgs &args)
     {
-        af::setBackend(_backend);
-        af::setDevice(0);
+        setThreadBackendAndDevice(_backend, 0);
 
         Pothos::BufferManager::init(args);
         _bufferSize = args.bufferSize;
@@ -1,7 +1,8 @@
-// Copyright (c) 2019-2020 Nicholas Corgan
+// Copyright (c) 2019-2021 Nicholas Corgan
 // SPDX-License-Identifier: BSD-3-Clause
 
 #include "ArrayFireBlock.hpp"
+#include "SharedBufferAllocator.hpp"
 #include "Utility.hpp"
 
 #include <Pothos/Exception.hpp>
@@ -12,12 +13,33 @@
 
 #include <arrayfire.h>
 
+#include <algorithm>
 #include <cassert>
+#include <cstdint>
+#include <cstring>
 #include <string>
 #include <typeinfo>
 
 using AfRandomFunc = af::array(*)(const af::dim4&, const af::dtype, af::randomEngine&);
 
+// Philox and Threefry are counter-based generators keyed by the seed, so
+// giving each stream its own key results in independent, non-overlapping
+// sequences. Stream 0 keeps the user's seed as-is.
+static unsigned long long getStreamKey(
+    unsigned long long seed,
+    size_t streamIndex)
+{
+    if(0 == streamIndex) return seed;
+
+    // SplitMix64 finalizer
+    auto z = static_cast<std::uint64_t>(streamIndex) * 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    z = z ^ (z >> 31);
+
+    return static_cast<unsigned long long>(seed ^ z);
+}
+
 class RandomBlock: public ArrayFireBlock
 {
     public:
@@ -44,12 +66,24 @@ class RandomBlock: public ArrayFireBlock
             _afRandomFunc(nullptr), // Set in constructor
             _distribution(), // Set in constructor
             _afDType(Pothos::Object(dtype).convert<af::dtype>()),
-            _afRandomEngine()
+            _afRandomEngine(),
+            _seed(0), // Set in constructor
+            _streamIndex(0),
+            _elemSize(Pothos::DType::fromDType(dtype, 1).size()),
+            _batchSize(0),
+            _afNextBatch(),
+            _hostBatch(),
+            _batchPos(0)
         {
             this->registerCall(this, POTHOS_FCN_TUPLE(RandomBlock, distribution));
             this->registerCall(this, POTHOS_FCN_TUPLE(RandomBlock, setDistribution));
             this->registerCall(this, POTHOS_FCN_TUPLE(RandomBlock, randomEngineType));
             this->registerCall(this, POTHOS_FCN_TUPLE(RandomBlock, setRandomEngineType));
+            this->registerCall(this, POTHOS_FCN_TUPLE(RandomBlock, seed));
+            this->registerCall(this, POTHOS_FCN_TUPLE(RandomBlock, streamIndex));
+            this->registerCall(this, POTHOS_FCN_TUPLE(RandomBlock, setStreamIndex));
+            this->registerCall(this, POTHOS_FCN_TUPLE(RandomBlock, batchSize));
+            this->registerCall(this, POTHOS_FCN_TUPLE(RandomBlock, setBatchSize));
 
             // This call is overloaded, so no macro for us.
             this->registerCall(
@@ -63,9 +97,14 @@ class RandomBlock: public ArrayFireBlock
 
             this->registerProbe("distribution");
             this->registerProbe("randomEngineType");
+            this->registerProbe("seed");
+            this->registerProbe("streamIndex");
+            this->registerProbe("batchSize");
 
             this->registerSignal("distributionChanged");
             this->registerSignal("randomEngineTypeChanged");
+            this->registerSignal("streamIndexChanged");
+            this->registerSignal("batchSizeChanged");
 
             this->setupOutput(0, dtype, _domain);
 
@@ -96,6 +135,7 @@ class RandomBlock: public ArrayFireBlock
             }
 
             this->_distribution = distribution;
+            this->_resetBatches();
             this->emitSignal("distributionChanged", distribution);
         }
 
@@ -107,6 +147,8 @@ class RandomBlock: public ArrayFireBlock
         void setRandomEngineType(const std::string& randomEngineType)
         {
             _afRandomEngine.setType(Pothos::Object(randomEngineType).convert<af::randomEngineType>());
+            _afRandomEngine.setSeed(getStreamKey(_seed, _streamIndex));
+            this->_resetBatches();
             this->emitSignal("randomEngineTypeChanged", randomEngineType);
         }
 
@@ -119,7 +161,40 @@ class RandomBlock: public ArrayFireBlock
 
         void reseedRandomEngine(SeedType seed)
         {
-            _afRandomEngine.setSeed(seed);
+            _seed = seed;
+            _afRandomEngine.setSeed(getStreamKey(_seed, _streamIndex));
+            this->_resetBatches();
+        }
+
+        SeedType seed() const
+        {
+            return _seed;
+        }
+
+        size_t streamIndex() const
+        {
+            return _streamIndex;
+        }
+
+        void setStreamIndex(size_t streamIndex)
+        {
+            _streamIndex = streamIndex;
+            this->reseedRandomEngine(_seed);
+
+            this->emitSignal("streamIndexChanged", streamIndex);
+        }
+
+        size_t batchSize() const
+        {
+            return _batchSize;
+        }
+
+        void setBatchSize(size_t batchSize)
+        {
+            _batchSize = batchSize;
+            this->_resetBatches();
+
+            this->emitSignal("batchSizeChanged", batchSize);
         }
 
         void work() override
@@ -130,10 +205,16 @@ class RandomBlock: public ArrayFireBlock
                 return;
             }
 
-            const af::dim4 dims(static_cast<dim_t>(elems));
+            this->configArrayFire();
+
+            if(0 == _batchSize)
+            {
+                const af::dim4 dims(static_cast<dim_t>(elems));
 
-            auto afOutput = _afRandomFunc(dims, _afDType, _afRandomEngine);
-            this->produceFromAfArray(0, afOutput);
+                auto afOutput = _afRandomFunc(dims, _afDType, _afRandomEngine);
+                this->produceFromAfArray(0, afOutput);
+            }
+            else this->_produceFromBatches(elems);
         }
 
     private:
@@ -142,6 +223,85 @@ class RandomBlock: public ArrayFireBlock
         std::string _distribution;
         af::dtype _afDType;
         mutable af::randomEngine _afRandomEngine;
+
+        SeedType _seed;
+        size_t _streamIndex;
+
+        //
+        // Batch mode: while the current batch is served from host memory,
+        // the next batch is already being generated on the device.
+        //
+
+        size_t _elemSize;
+        size_t _batchSize;
+        af::array _afNextBatch;
+        Pothos::SharedBuffer _hostBatch;
+        size_t _batchPos;
+
+        void _resetBatches()
+        {
+            _afNextBatch = af::array();
+
+            // Force a refill on the next call to work().
+            _batchPos = _hostBatch.getLength();
+        }
+
+        af::array _generateBatch()
+        {
+            const af::dim4 dims(static_cast<dim_t>(_batchSize));
+
+            auto afBatch = _afRandomFunc(dims, _afDType, _afRandomEngine);
+            afBatch.eval();
+
+            return afBatch;
+        }
+
+        void _refillHostBatch()
+        {
+            const size_t batchBytes = _batchSize * _elemSize;
+            if(_hostBatch.getLength() != batchBytes)
+            {
+                _hostBatch = allocateSharedBuffer(_afBackend, batchBytes);
+            }
+            if(_afNextBatch.isempty())
+            {
+                _afNextBatch = this->_generateBatch();
+            }
+
+            _afNextBatch.host(reinterpret_cast<void*>(_hostBatch.getAddress()));
+            _batchPos = 0;
+
+            // Queue up the next batch so it's ready by the time this one
+            // is consumed.
+            _afNextBatch = this->_generateBatch();
+        }
+
+        void _produceFromBatches(size_t elems)
+        {
+            auto* outputPort = this->output(0);
+            auto* out = outputPort->buffer().as<std::uint8_t*>();
+
+            size_t bytesLeft = elems * outputPort->dtype().size();
+            while(bytesLeft > 0)
+            {
+                if(_batchPos >= _hostBatch.getLength())
+                {
+                    this->_refillHostBatch();
+                }
+
+                const size_t numBytes = std::min(bytesLeft, (_hostBatch.getLength() - _batchPos));
+                std::memcpy(
+                    out,
+                    reinterpret_cast<const void*>(_hostBatch.getAddress() + _batchPos),
+                    numBytes);
+
+                out += numBytes;
+                _batchPos += numBytes;
+                bytesLeft -= numBytes;
+            }
+
+            outputPort->produce(elems);
+        }
 };
 
 /*
@@ -154,11 +314,22 @@ class RandomBlock: public ArrayFireBlock
  * The underlying random generation scheme can also be customized, although for
  * most purposes, leaving this value as its default will be fine.
  *
+ * When <b>batchSize</b> is non-zero, values are generated on the device in
+ * batches of the given size. Outgoing buffers are filled from the current
+ * batch while the next one is generated in the background, and the output
+ * sequence for a given seed does not depend on downstream buffer sizes.
+ *
+ * The Philox and Threefry engines are counter-based, so blocks given the same
+ * seed and different <b>streamIndex</b> values produce reproducible,
+ * non-overlapping streams, even on different devices.
+ *
  * |category /GPU/Sources
  * |keywords array random uniform normal philox threefry mersenne source
  * |factory /gpu/random/source(device,dtype,distribution)
  * |setter setDistribution(distribution)
  * |setter setRandomEngineType(randomEngineType)
+ * |setter setStreamIndex(streamIndex)
+ * |setter setBatchSize(batchSize)
  *
  * |param device[Device] Device to use for processing.
  * |default "Auto"
@@ -182,6 +353,18 @@ class RandomBlock: public ArrayFireBlock
  * |option [Mersenne] "Mersenne"
  * |default "Philox"
  * |preview enable
+ *
+ * |param streamIndex[Stream Index] Selects an independent stream for the given seed.
+ * |widget SpinBox(minimum=0)
+ * |default 0
+ * |preview disable
+ *
+ * |param batchSize[Batch Size] The number of elements generated per device batch.
+ * If 0, each call generates exactly the number of elements requested.
+ * |widget SpinBox(minimum=0)
+ * |default 0
+ * |units elements
+ * |preview disable
  */
 static Pothos::BlockRegistry registerRandomSource(
     "/gpu/random/source",
@@ -1,6 +1,7 @@
-// Copyright (c) 2019-2020 Nicholas Corgan
+// Copyright (c) 2019-2021 Nicholas Corgan
 // SPDX-License-Identifier: BSD-3-Clause
 
+#include "EnumConversions.hpp"
 #include "ReducedBlock.hpp"
 #include "Utility.hpp"
 
@@ -26,6 +27,7 @@ ReducedBlock::ReducedBlock(
 ):
     ArrayFireBlock(device),
     _func(func),
+    _afInputDType(pothosDTypeToAfDType(inputDType)),
     _afOutputDType(Pothos::Object(outputDType).convert<af::dtype>()),
     _nchans(numChannels)
 {
@@ -41,6 +43,9 @@ ReducedBlock::ReducedBlock(
         this->setupInput(chan, inputDType, _domain);
     }
     this->setupOutput(0, outputDType, _domain);
+
+    this->enableBatching();
+    this->enableFailover();
 }
 
 ReducedBlock::~ReducedBlock() {}
@@ -55,9 +60,7 @@ af::array ReducedBlock::getNumberedInputPortsAs2DAfArray()
 
     const auto dim0 = static_cast<dim_t>(inputs.size());
     const auto dim1 = static_cast<dim_t>(this->workInfo().minElements);
-    const auto afDType = Pothos::Object(inputs[0]->dtype()).convert<af::dtype>();
-
-    af::array ret(dim0, dim1, afDType);
+    af::array ret(dim0, dim1, _afInputDType);
     for(dim_t row = 0; row < dim0; ++row)
     {
         auto afArray = this->getInputPortAsAfArray(row);
@@ -86,15 +89,29 @@ void ReducedBlock::work()
         return;
     }
 
-    auto afArray = this->getNumberedInputPortsAs2DAfArray();
-    auto afOutput = _func(afArray, -1).as(_afOutputDType);
-
-    if(elems != static_cast<size_t>(afOutput.elements()))
+    if(this->deferForMemory() || this->deferForBatch(elems))
     {
-        throw Pothos::AssertionViolationException(
-                  "Unexpected output size",
-                  std::to_string(elems));
+        return;
     }
 
-    this->produceFromAfArray(0, afOutput);
+    auto workTimer = this->timeStage(BlockStage::Work);
+
+    this->runWithFailover([&]()
+    {
+        auto afArray = this->getNumberedInputPortsAs2DAfArray();
+        af::array afOutput;
+        {
+            auto timer = this->timeStage(BlockStage::Compute);
+            afOutput = _func(afArray, -1).as(_afOutputDType);
+        }
+
+        if(elems != static_cast<size_t>(afOutput.elements()))
+        {
+            throw Pothos::AssertionViolationException(
+                      "Unexpected output size",
+                      std::to_string(elems));
+        }
+
+        this->produceFromAfArray(0, afOutput);
+    });
 }
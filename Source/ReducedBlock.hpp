@@ -1,4 +1,4 @@
-// Copyright (c) 2019-2020 Nicholas Corgan
+// Copyright (c) 2019-2021 Nicholas Corgan
 // SPDX-License-Identifier: BSD-3-Clause
 
 #pragma once
@@ -32,6 +32,7 @@ class ReducedBlock: public ArrayFireBlock
 
     private:
         ReducedFunc _func;
+        af::dtype _afInputDType;
         af::dtype _afOutputDType;
         size_t _nchans;
 };
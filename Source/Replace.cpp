@@ -1,4 +1,4 @@
-// Copyright (c) 2020 Nicholas Corgan
+// Copyright (c) 2020-2021 Nicholas Corgan
 // SPDX-License-Identifier: BSD-3-Clause
 
 #include "ArrayFireBlock.hpp"
@@ -10,6 +10,7 @@
 
 #include <arrayfire.h>
 
+#include <cmath>
 #include <cstdint>
 #include <typeinfo>
 
@@ -23,14 +24,14 @@ static inline EnableIfAnyInt<T, af::array> isEqual(const af::array& afArray, con
     return (afArray == value);
 }
 
+// The special cases are resolved on the host, so no device array needs to
+// be allocated for the value.
 template <typename T>
 static inline EnableIfFloat<T, af::array> isEqual(const af::array& afArray, const T& value)
 {
-    auto afValue = af::constant(value, afArray.elements(), afArray.type());
-
-    return (af::isNaN(afArray) && af::isNaN(afValue)) ||
-           ((af::isInf(afArray) && af::isInf(afValue)) && (af::sign(afArray) == af::sign(afArray))) ||
-           (af::abs(afArray - value) <= 1e-6);
+    if(std::isnan(value))      return af::isNaN(afArray);
+    else if(std::isinf(value)) return af::isInf(afArray);
+    else                       return (af::abs(afArray - value) <= 1e-6);
 }
 
 template <typename T>
@@ -60,7 +61,8 @@ class Replace: public ArrayFireBlock
             size_t dtypeDims
         ):
             ArrayFireBlock(device),
-            _afDType(Pothos::Object(Class::dtype).convert<af::dtype>())
+            _afDType(Pothos::Object(Class::dtype).convert<af::dtype>()),
+            _afReplaceValueArray()
         {
             this->setupInput(
                 0,
@@ -106,6 +108,8 @@ class Replace: public ArrayFireBlock
         void setReplaceValue(const T& replaceValue)
         {
             _replaceValue = PothosToAF<T>::to(replaceValue);
+            _afReplaceValueArray = af::array();
+
             this->emitSignal("replaceValueChanged", replaceValue);
         }
 
@@ -121,11 +125,18 @@ class Replace: public ArrayFireBlock
             auto afArray = this->getInputPortAsAfArray(0);
             auto afCond = !isEqual<T>(afArray, PothosToAF<T>::from(_findValue));
 
+            // Only refill the device buffer when the size or value changes.
+            if(_afReplaceValueArray.elements() != afArray.elements())
+            {
+                _afReplaceValueArray = af::constant(_replaceValue, afArray.elements(), _afDType);
+                _afReplaceValueArray.eval();
+            }
+
             // af::replace operates in place.
             af::replace(
                 afArray,
                 afCond,
-                af::constant(_replaceValue, afArray.elements(), _afDType));
+                _afReplaceValueArray);
 
             this->produceFromAfArray(0, afArray);
         }
@@ -137,6 +148,8 @@ class Replace: public ArrayFireBlock
         typename PothosToAF<T>::type _findValue;
         typename PothosToAF<T>::type _replaceValue;
         af::dtype _afDType;
+
+        af::array _afReplaceValueArray;
 };
 
 template <typename T>
@@ -1,13 +1,63 @@
-// Copyright (c) 2019-2020 Nicholas Corgan
+// Copyright (c) 2019-2021 Nicholas Corgan
 // SPDX-License-Identifier: BSD-3-Clause
 
 #include "SharedBufferAllocator.hpp"
+#include "DeviceThreads.hpp"
 
 #include <Pothos/Framework.hpp>
 
 #include <arrayfire.h>
 
+#include <map>
 #include <memory>
+#include <mutex>
+
+//
+// Usage tracking
+//
+
+struct PinnedMemoryRegistry
+{
+    std::mutex mutex;
+    std::map<af::Backend, PinnedMemoryUsage> usage;
+};
+
+static PinnedMemoryRegistry& getPinnedMemoryRegistry()
+{
+    static PinnedMemoryRegistry registry;
+
+    return registry;
+}
+
+static void addPinnedMemory(
+    af::Backend backend,
+    size_t bytes,
+    bool allocated)
+{
+    auto& registry = getPinnedMemoryRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+
+    auto& usage = registry.usage[backend];
+    if(allocated)
+    {
+        usage.bytes += bytes;
+        ++usage.buffers;
+    }
+    else
+    {
+        usage.bytes -= bytes;
+        --usage.buffers;
+    }
+}
+
+PinnedMemoryUsage pinnedMemoryUsage(af::Backend backend)
+{
+    auto& registry = getPinnedMemoryRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+
+    auto usageIter = registry.usage.find(backend);
+    return (registry.usage.end() != usageIter) ? usageIter->second : PinnedMemoryUsage{0, 0};
+}
 
 //
 // Minimal wrapper class to ensure allocation and deallocation are done
@@ -21,20 +71,24 @@ class AfPinnedMemRAII
         
         AfPinnedMemRAII(af::Backend backend, size_t allocSize):
             _backend(backend),
+            _allocSize(allocSize),
             _pinnedMem(nullptr)
         {
-            af::setBackend(_backend);
+            setThreadBackend(_backend);
             _pinnedMem = af::pinned(allocSize, ::u8);
+            addPinnedMemory(_backend, _allocSize, true);
         }
 
         virtual ~AfPinnedMemRAII()
         {
             try
             {
-                af::setBackend(_backend);
+                setThreadBackend(_backend);
                 af::freePinned(_pinnedMem);
             }
             catch(...){}
+
+            addPinnedMemory(_backend, _allocSize, false);
         }
 
         inline void* get() const
@@ -44,6 +98,7 @@ class AfPinnedMemRAII
 
     private:
         af::Backend _backend;
+        size_t _allocSize;
         void* _pinnedMem;
 };
 
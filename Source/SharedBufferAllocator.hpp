@@ -1,4 +1,4 @@
-// Copyright (c) 2020 Nicholas Corgan
+// Copyright (c) 2020-2021 Nicholas Corgan
 // SPDX-License-Identifier: BSD-3-Clause
 
 #pragma once
@@ -16,3 +16,13 @@ using BufferAllocateFcn = Pothos::BufferManager::AllocateFcn;
 Pothos::SharedBuffer allocateSharedBuffer(af::Backend backend, size_t size);
 
 BufferAllocateFcn getSharedBufferAllocator(af::Backend backend);
+
+struct PinnedMemoryUsage
+{
+    size_t bytes;
+    size_t buffers;
+};
+
+// Page-locked memory currently allocated by the given backend for block
+// buffers
+PinnedMemoryUsage pinnedMemoryUsage(af::Backend backend);
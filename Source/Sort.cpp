@@ -1,4 +1,4 @@
-// Copyright (c) 2020 Nicholas Corgan
+// Copyright (c) 2020-2021 Nicholas Corgan
 // SPDX-License-Identifier: BSD-3-Clause
 
 #include "OneToOneBlock.hpp"
@@ -46,6 +46,8 @@ class Sort: public OneToOneBlock
 
             // Set here instead of class instantiation to send signal
             this->setIsAscending(true);
+
+            _canShard = false;
         }
 
         virtual ~Sort() {};
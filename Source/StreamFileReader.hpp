@@ -0,0 +1,51 @@
+// Copyright (c) 2021 Nicholas Corgan
+// SPDX-License-Identifier: BSD-3-Clause
+
+#pragma once
+
+#include <Pothos/Framework.hpp>
+
+#include <memory>
+#include <vector>
+
+struct StreamFileLabel
+{
+    // Absolute sample index
+    size_t index;
+    size_t channel;
+    Pothos::Label label;
+};
+
+//
+// Random access to a multi-channel stream stored on disk. FileSource streams
+// from these in windows, with at most one read() in flight at a time.
+//
+class StreamFileReader
+{
+    public:
+        using UPtr = std::unique_ptr<StreamFileReader>;
+
+        virtual ~StreamFileReader() = default;
+
+        virtual size_t numChannels() const = 0;
+
+        virtual Pothos::DType dtype(size_t chan) const = 0;
+
+        virtual size_t numSamples() const = 0;
+
+        // A good read size given the block's maximum window size
+        virtual size_t preferredReadSamples(size_t maxBytes) const = 0;
+
+        // Reads into one caller-provided buffer per channel, each large
+        // enough for numSamples elements of the channel's DType.
+        virtual void read(
+            size_t startSample,
+            size_t numSamples,
+            const std::vector<void*>& channels) = 0;
+
+        // Sorted by index
+        virtual std::vector<StreamFileLabel> labels() const
+        {
+            return {};
+        }
+};
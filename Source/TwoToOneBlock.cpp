@@ -1,6 +1,7 @@
-// Copyright (c) 2019-2020 Nicholas Corgan
+// Copyright (c) 2019-2021 Nicholas Corgan
 // SPDX-License-Identifier: BSD-3-Clause
 
+#include "EnumConversions.hpp"
 #include "TwoToOneBlock.hpp"
 #include "Utility.hpp"
 
@@ -13,6 +14,7 @@
 #include <cassert>
 #include <string>
 #include <typeinfo>
+#include <vector>
 
 //
 // Factories
@@ -93,6 +95,10 @@ TwoToOneBlock::TwoToOneBlock(
     this->setupInput(0, inputDType, _domain);
     this->setupInput(1, inputDType, _domain);
     this->setupOutput(0, outputDType, _domain);
+
+    this->enableAutoOffload();
+    this->enableBatching();
+    this->enableFailover();
 }
 
 TwoToOneBlock::~TwoToOneBlock() {}
@@ -105,14 +111,42 @@ void TwoToOneBlock::work()
         return;
     }
 
-    auto inputAfArray0 = this->getInputPortAsAfArray(0);
-    auto inputAfArray1 = this->getInputPortAsAfArray(1);
-
-    if(!_allowZeroInBuffer1 && (elems != static_cast<size_t>(inputAfArray1.nonzeros())))
+    if(this->deferForMemory() || this->deferForBatch(elems))
     {
-        throw Pothos::InvalidArgumentException("Denominator cannot contain zeros.");
+        return;
     }
 
-    auto outputAfArray = _func(inputAfArray0, inputAfArray1);
-    this->produceFromAfArray(0, outputAfArray);
+    auto workTimer = this->timeStage(BlockStage::Work);
+
+    this->runWithFailover([&]()
+    {
+        auto hostBackend = this->hostBackendIfSmall(elems);
+
+        auto inputAfArray0 = this->getInputPortAsAfArray(0);
+        auto inputAfArray1 = this->getInputPortAsAfArray(1);
+
+        if(!_allowZeroInBuffer1 && (elems != static_cast<size_t>(inputAfArray1.nonzeros())))
+        {
+            throw Pothos::InvalidArgumentException("Denominator cannot contain zeros.");
+        }
+
+        af::array outputAfArray;
+        {
+            auto timer = this->timeStage(BlockStage::Compute);
+            outputAfArray = _func(inputAfArray0, inputAfArray1);
+        }
+        this->produceFromAfArray(0, outputAfArray);
+    });
+}
+
+size_t TwoToOneBlock::measureCrossoverElements()
+{
+    const auto afInputDType = pothosDTypeToAfDType(this->input(0)->dtype());
+
+    return this->timeCrossoverElements(
+               {afInputDType, afInputDType},
+               [this](const std::vector<af::array>& afInputs)
+               {
+                   return _func(afInputs[0], afInputs[1]);
+               });
 }
@@ -54,6 +54,10 @@ class TwoToOneBlock: public ArrayFireBlock
 
         void work() override;
 
+    protected:
+
+        size_t measureCrossoverElements() override;
+
     private:
         TwoToOneFunc _func;
         bool _allowZeroInBuffer1;
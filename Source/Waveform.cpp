@@ -0,0 +1,531 @@
+// Copyright (c) 2021 Nicholas Corgan
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "ArrayFireBlock.hpp"
+#include "Utility.hpp"
+
+#include <Pothos/Exception.hpp>
+#include <Pothos/Framework.hpp>
+#include <Pothos/Object.hpp>
+
+#include <Poco/Format.h>
+#include <Poco/NumberFormatter.h>
+
+#include <arrayfire.h>
+
+#include <cmath>
+#include <string>
+#include <typeinfo>
+#include <unordered_map>
+
+//
+// Utility code
+//
+
+static constexpr double TwoPi = 2.0 * M_PI;
+
+enum class WaveformType
+{
+    Sine,
+    Cosine,
+    ComplexExponential,
+    Square,
+    Sawtooth,
+    LinearChirp,
+    LogChirp
+};
+
+static const std::unordered_map<std::string, WaveformType> WaveformTypeMap =
+{
+    {"Sine",                WaveformType::Sine},
+    {"Cosine",              WaveformType::Cosine},
+    {"Complex Exponential", WaveformType::ComplexExponential},
+    {"Square",              WaveformType::Square},
+    {"Sawtooth",            WaveformType::Sawtooth},
+    {"Linear Chirp",        WaveformType::LinearChirp},
+    {"Log Chirp",           WaveformType::LogChirp},
+};
+
+static inline bool isChirp(WaveformType waveformType)
+{
+    return (WaveformType::LinearChirp == waveformType) ||
+           (WaveformType::LogChirp == waveformType);
+}
+
+static inline double wrapPhase(double phase)
+{
+    auto ret = std::fmod(phase, TwoPi);
+    if(ret < 0.0) ret += TwoPi;
+
+    return ret;
+}
+
+//
+// Interface
+//
+
+template <typename T>
+class Waveform: public ArrayFireBlock
+{
+    public:
+
+        using Class = Waveform<T>;
+
+        static const Pothos::DType dtype;
+
+        Waveform(
+            const std::string& device,
+            const std::string& waveform,
+            double sampleRate,
+            double frequency,
+            double amplitude,
+            size_t dtypeDims
+        ):
+            ArrayFireBlock(device),
+            _afDType(Pothos::Object(Class::dtype).convert<af::dtype>()),
+            _waveformType(WaveformType::Sine), // Set in constructor
+            _waveform(), // Set in constructor
+            _sampleRate(0.0), // Set in constructor
+            _frequency(frequency),
+            _amplitude(amplitude),
+            _phase(0.0),
+            _chirpEndFrequency(frequency),
+            _chirpDuration(1.0),
+            _chirpPos(0.0),
+            _afPeriod(),
+            _afCachedOutput()
+        {
+            this->setupOutput(
+                0,
+                Pothos::DType::fromDType(Class::dtype, dtypeDims),
+                _domain);
+
+            this->registerCall(this, POTHOS_FCN_TUPLE(Class, waveform));
+            this->registerCall(this, POTHOS_FCN_TUPLE(Class, setWaveform));
+            this->registerCall(this, POTHOS_FCN_TUPLE(Class, sampleRate));
+            this->registerCall(this, POTHOS_FCN_TUPLE(Class, setSampleRate));
+            this->registerCall(this, POTHOS_FCN_TUPLE(Class, frequency));
+            this->registerCall(this, POTHOS_FCN_TUPLE(Class, setFrequency));
+            this->registerCall(this, POTHOS_FCN_TUPLE(Class, amplitude));
+            this->registerCall(this, POTHOS_FCN_TUPLE(Class, setAmplitude));
+            this->registerCall(this, POTHOS_FCN_TUPLE(Class, phase));
+            this->registerCall(this, POTHOS_FCN_TUPLE(Class, setPhase));
+            this->registerCall(this, POTHOS_FCN_TUPLE(Class, chirpEndFrequency));
+            this->registerCall(this, POTHOS_FCN_TUPLE(Class, setChirpEndFrequency));
+            this->registerCall(this, POTHOS_FCN_TUPLE(Class, chirpDuration));
+            this->registerCall(this, POTHOS_FCN_TUPLE(Class, setChirpDuration));
+
+            this->registerProbe("waveform");
+            this->registerProbe("sampleRate");
+            this->registerProbe("frequency");
+            this->registerProbe("amplitude");
+            this->registerProbe("phase");
+            this->registerProbe("chirpEndFrequency");
+            this->registerProbe("chirpDuration");
+
+            this->registerSignal("waveformChanged");
+            this->registerSignal("sampleRateChanged");
+            this->registerSignal("frequencyChanged");
+            this->registerSignal("amplitudeChanged");
+            this->registerSignal("phaseChanged");
+            this->registerSignal("chirpEndFrequencyChanged");
+            this->registerSignal("chirpDurationChanged");
+
+            this->setWaveform(waveform);
+            this->setSampleRate(sampleRate);
+        }
+
+        virtual ~Waveform() = default;
+
+        std::string waveform() const
+        {
+            return _waveform;
+        }
+
+        void setWaveform(const std::string& waveform)
+        {
+            const auto waveformType = getValForKey(WaveformTypeMap, waveform);
+            if((WaveformType::ComplexExponential == waveformType) && !IsComplex<T>::value)
+            {
+                throw Pothos::InvalidArgumentException(
+                          "This waveform requires a complex type.",
+                          Class::dtype.name());
+            }
+
+            _waveformType = waveformType;
+            _waveform = waveform;
+            _chirpPos = 0.0;
+            this->_invalidateCache();
+
+            this->emitSignal("waveformChanged", waveform);
+        }
+
+        double sampleRate() const
+        {
+            return _sampleRate;
+        }
+
+        void setSampleRate(double sampleRate)
+        {
+            if(sampleRate <= 0.0)
+            {
+                throw Pothos::InvalidArgumentException(
+                          "Sample rate must be positive.",
+                          Poco::NumberFormatter::format(sampleRate));
+            }
+
+            _sampleRate = sampleRate;
+            this->_invalidateCache();
+
+            this->emitSignal("sampleRateChanged", sampleRate);
+        }
+
+        double frequency() const
+        {
+            return _frequency;
+        }
+
+        void setFrequency(double frequency)
+        {
+            // The phase accumulator is untouched, so the output stays
+            // continuous across the change.
+            _frequency = frequency;
+            this->_invalidateCache();
+
+            this->emitSignal("frequencyChanged", frequency);
+        }
+
+        double amplitude() const
+        {
+            return _amplitude;
+        }
+
+        void setAmplitude(double amplitude)
+        {
+            _amplitude = amplitude;
+            this->_invalidateCache();
+
+            this->emitSignal("amplitudeChanged", amplitude);
+        }
+
+        double phase() const
+        {
+            return _phase;
+        }
+
+        void setPhase(double phase)
+        {
+            _phase = wrapPhase(phase);
+            this->_invalidateCache();
+
+            this->emitSignal("phaseChanged", phase);
+        }
+
+        double chirpEndFrequency() const
+        {
+            return _chirpEndFrequency;
+        }
+
+        void setChirpEndFrequency(double chirpEndFrequency)
+        {
+            _chirpEndFrequency = chirpEndFrequency;
+            this->_invalidateCache();
+
+            this->emitSignal("chirpEndFrequencyChanged", chirpEndFrequency);
+        }
+
+        double chirpDuration() const
+        {
+            return _chirpDuration;
+        }
+
+        void setChirpDuration(double chirpDuration)
+        {
+            if(chirpDuration <= 0.0)
+            {
+                throw Pothos::InvalidArgumentException(
+                          "Chirp duration must be positive.",
+                          Poco::NumberFormatter::format(chirpDuration));
+            }
+
+            _chirpDuration = chirpDuration;
+            _chirpPos = 0.0;
+            this->_invalidateCache();
+
+            this->emitSignal("chirpDurationChanged", chirpDuration);
+        }
+
+        void work() override
+        {
+            const auto elems = this->workInfo().minElements;
+            if(0 == elems)
+            {
+                return;
+            }
+
+            this->configArrayFire();
+
+            const size_t periodLength = this->_getPeriodLength();
+            if((periodLength > 0) && (0 == (elems % periodLength)))
+            {
+                // A whole number of periods leaves the phase where it started,
+                // so the same device buffer can be posted until something
+                // changes.
+                if(static_cast<size_t>(_afCachedOutput.elements()) != elems)
+                {
+                    if(_afPeriod.isempty())
+                    {
+                        const auto phase = _phase;
+                        _afPeriod = this->_getWaveform(periodLength);
+                        _afPeriod.eval();
+                        _phase = phase;
+                    }
+
+                    _afCachedOutput = af::tile(_afPeriod, static_cast<unsigned>(elems / periodLength));
+                    _afCachedOutput.eval();
+                }
+
+                this->produceFromAfArray(0, _afCachedOutput);
+            }
+            else
+            {
+                this->_invalidateCache();
+                this->produceFromAfArray(0, this->_getWaveform(elems));
+            }
+        }
+
+    private:
+
+        af::dtype _afDType;
+
+        WaveformType _waveformType;
+        std::string _waveform;
+        double _sampleRate;
+        double _frequency;
+        double _amplitude;
+        double _phase;
+
+        double _chirpEndFrequency;
+        double _chirpDuration;
+        double _chirpPos;
+
+        af::array _afPeriod;
+        af::array _afCachedOutput;
+
+        void _invalidateCache()
+        {
+            _afPeriod = af::array();
+            _afCachedOutput = af::array();
+        }
+
+        // Returns 0 if the waveform isn't periodic in a whole number of samples.
+        size_t _getPeriodLength() const
+        {
+            if(isChirp(_waveformType)) return 0;
+            else if(0.0 == _frequency) return 1;
+
+            const double period = _sampleRate / std::abs(_frequency);
+            const double roundedPeriod = std::round(period);
+
+            return ((roundedPeriod >= 1.0) && (std::abs(period - roundedPeriod) < 1e-9))
+                 ? static_cast<size_t>(roundedPeriod)
+                 : 0;
+        }
+
+        // Calculated in double precision to avoid drift, and advances
+        // the phase accumulator.
+        af::array _getPhases(size_t elems)
+        {
+            const auto afRange = af::range(af::dim4(static_cast<dim_t>(elems)), 0, ::f64);
+
+            af::array afPhases;
+            if(isChirp(_waveformType))
+            {
+                const double sweepLength = _chirpDuration * _sampleRate;
+                const auto afSweepPos = af::mod(afRange + _chirpPos, sweepLength) / sweepLength;
+
+                af::array afFreqs;
+                if(WaveformType::LinearChirp == _waveformType)
+                {
+                    afFreqs = _frequency + ((_chirpEndFrequency - _frequency) * afSweepPos);
+                }
+                else
+                {
+                    if((_frequency <= 0.0) || (_chirpEndFrequency <= 0.0))
+                    {
+                        throw Pothos::InvalidArgumentException(
+                                  "Log chirp frequencies must be positive.",
+                                  Poco::format(
+                                      "%s -> %s",
+                                      Poco::NumberFormatter::format(_frequency),
+                                      Poco::NumberFormatter::format(_chirpEndFrequency)));
+                    }
+
+                    afFreqs = _frequency * af::pow(_chirpEndFrequency / _frequency, afSweepPos);
+                }
+
+                // Exclusive scan, so the first sample is at the current phase.
+                const auto afPhaseSteps = (TwoPi / _sampleRate) * afFreqs;
+                afPhases = _phase + (af::accum(afPhaseSteps) - afPhaseSteps);
+
+                _phase = wrapPhase(_phase + af::sum<double>(afPhaseSteps));
+                _chirpPos = std::fmod(_chirpPos + static_cast<double>(elems), sweepLength);
+            }
+            else
+            {
+                const double phaseStep = TwoPi * _frequency / _sampleRate;
+                afPhases = _phase + (phaseStep * afRange);
+
+                _phase = wrapPhase(_phase + (phaseStep * static_cast<double>(elems)));
+            }
+
+            return afPhases;
+        }
+
+        af::array _getWaveform(size_t elems)
+        {
+            const auto afPhases = this->_getPhases(elems);
+
+            af::array afOutput;
+            switch(_waveformType)
+            {
+                case WaveformType::Sine:
+                    afOutput = af::sin(afPhases);
+                    break;
+
+                case WaveformType::Cosine:
+                    afOutput = af::cos(afPhases);
+                    break;
+
+                case WaveformType::Square:
+                    afOutput = 1.0 - (2.0 * (af::mod(afPhases, TwoPi) >= M_PI).as(::f64));
+                    break;
+
+                case WaveformType::Sawtooth:
+                    afOutput = (af::mod(afPhases, TwoPi) / M_PI) - 1.0;
+                    break;
+
+                // Chirps are real for real types and analytic for complex types.
+                case WaveformType::ComplexExponential:
+                case WaveformType::LinearChirp:
+                case WaveformType::LogChirp:
+                    afOutput = IsComplex<T>::value ? af::complex(af::cos(afPhases), af::sin(afPhases))
+                                                   : af::cos(afPhases);
+                    break;
+            }
+
+            return (_amplitude * afOutput).as(_afDType);
+        }
+};
+
+template <typename T>
+const Pothos::DType Waveform<T>::dtype(typeid(T));
+
+//
+// Factory/Registration
+//
+
+static Pothos::Block* waveformFactory(
+    const std::string& device,
+    const Pothos::DType& dtype,
+    const std::string& waveform,
+    double sampleRate,
+    double frequency,
+    double amplitude)
+{
+    #define ifTypeDeclareFactory(T) \
+        if(Pothos::DType::fromDType(dtype, 1) == Pothos::DType(typeid(T))) \
+            return new Waveform<T>(device, waveform, sampleRate, frequency, amplitude, dtype.dimension());
+
+    ifTypeDeclareFactory(float)
+    ifTypeDeclareFactory(double)
+    ifTypeDeclareFactory(std::complex<float>)
+    ifTypeDeclareFactory(std::complex<double>)
+    #undef ifTypeDeclareFactory
+
+    throw Pothos::InvalidArgumentException(
+              "Unsupported type",
+              dtype.name());
+}
+
+/*
+ * |PothosDoc Waveform Source (GPU)
+ *
+ * Generates a periodic waveform or a repeating frequency sweep on the device.
+ * The phase is tracked across calls to work(), so changing the frequency,
+ * amplitude, or waveform at runtime does not cause a phase discontinuity.
+ *
+ * For complex types, the chirp waveforms are complex exponentials. For real
+ * types, they are cosines. The complex exponential waveform requires a
+ * complex type.
+ *
+ * When the waveform's period is a whole number of samples that divides the
+ * requested buffer size, one period is computed once and reused on the device
+ * until a parameter changes.
+ *
+ * |category /GPU/Sources
+ * |category /GPU/Signal
+ * |keywords signal waveform sine cosine square sawtooth chirp tone lo source
+ * |factory /gpu/signal/waveform(device,dtype,waveform,sampleRate,frequency,amplitude)
+ * |setter setWaveform(waveform)
+ * |setter setSampleRate(sampleRate)
+ * |setter setFrequency(frequency)
+ * |setter setAmplitude(amplitude)
+ * |setter setPhase(phase)
+ * |setter setChirpEndFrequency(chirpEndFrequency)
+ * |setter setChirpDuration(chirpDuration)
+ *
+ * |param device[Device] Device to use for processing.
+ * |default "Auto"
+ *
+ * |param dtype[Data Type] The output's data type.
+ * |widget DTypeChooser(float=1,cfloat=1,dim=1)
+ * |default "complex_float32"
+ * |preview disable
+ *
+ * |param waveform[Waveform]
+ * |widget ComboBox(editable=False)
+ * |option [Sine] "Sine"
+ * |option [Cosine] "Cosine"
+ * |option [Complex Exponential] "Complex Exponential"
+ * |option [Square] "Square"
+ * |option [Sawtooth] "Sawtooth"
+ * |option [Linear Chirp] "Linear Chirp"
+ * |option [Log Chirp] "Log Chirp"
+ * |default "Complex Exponential"
+ * |preview enable
+ *
+ * |param sampleRate[Sample Rate]
+ * |widget DoubleSpinBox(minimum=0)
+ * |default 1e6
+ * |units samples/sec
+ * |preview enable
+ *
+ * |param frequency[Frequency] The waveform frequency, or the start frequency of a chirp.
+ * |default 1e3
+ * |units Hz
+ * |preview enable
+ *
+ * |param amplitude[Amplitude]
+ * |default 1.0
+ * |preview enable
+ *
+ * |param phase[Phase] The phase of the next output sample.
+ * |default 0.0
+ * |units radians
+ * |preview disable
+ *
+ * |param chirpEndFrequency[Chirp End Frequency] The frequency at the end of each sweep.
+ * |default 1e4
+ * |units Hz
+ * |preview disable
+ *
+ * |param chirpDuration[Chirp Duration] The length of each sweep.
+ * |widget DoubleSpinBox(minimum=0)
+ * |default 1.0
+ * |units seconds
+ * |preview disable
+ */
+static Pothos::BlockRegistry registerWaveform(
+    "/gpu/signal/waveform",
+    Pothos::Callable(&waveformFactory));
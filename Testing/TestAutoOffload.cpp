@@ -0,0 +1,145 @@
+// Copyright (c) 2021 Nicholas Corgan
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "TestUtility.hpp"
+
+#include <Pothos/Framework.hpp>
+#include <Pothos/Proxy.hpp>
+#include <Pothos/Testing.hpp>
+
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace GPUTests
+{
+
+static const Pothos::DType dtype("float32");
+
+static Pothos::BufferChunk runBlock(
+    const Pothos::Proxy& block,
+    const std::vector<Pothos::BufferChunk>& inputs)
+{
+    Pothos::Topology topology;
+
+    std::vector<Pothos::Proxy> feederSources;
+    for(size_t input = 0; input < inputs.size(); ++input)
+    {
+        feederSources.emplace_back(Pothos::BlockRegistry::make(
+                                       "/blocks/feeder_source",
+                                       dtype));
+        feederSources.back().call("feedBuffer", inputs[input]);
+
+        topology.connect(feederSources.back(), 0, block, input);
+    }
+
+    auto collectorSink = Pothos::BlockRegistry::make(
+                             "/blocks/collector_sink",
+                             dtype);
+    topology.connect(block, 0, collectorSink, 0);
+
+    topology.commit();
+    POTHOS_TEST_TRUE(topology.waitInactive(0.05));
+
+    return collectorSink.call<Pothos::BufferChunk>("getBuffer");
+}
+
+}
+
+POTHOS_TEST_BLOCK("/gpu/tests", test_auto_offload)
+{
+    using namespace GPUTests;
+
+    setupTestEnv();
+
+    const auto input0 = getTestInputs(dtype.name());
+    const auto input1 = getTestInputs(dtype.name());
+
+    Pothos::BufferChunk expectedAbsOutputs(dtype, input0.elements());
+    Pothos::BufferChunk expectedHypotOutputs(dtype, input0.elements());
+    for(size_t elem = 0; elem < input0.elements(); ++elem)
+    {
+        expectedAbsOutputs.as<float*>()[elem] = std::abs(input0.as<const float*>()[elem]);
+        expectedHypotOutputs.as<float*>()[elem] = std::hypot(
+                                                      input0.as<const float*>()[elem],
+                                                      input1.as<const float*>()[elem]);
+    }
+
+    // Force all buffers to run on the host, if the device isn't already
+    // the CPU.
+    for(const auto& blockPath: {"/gpu/arith/abs", "/gpu/arith/hypot"})
+    {
+        auto block = Pothos::BlockRegistry::make(blockPath, "Auto", dtype);
+        POTHOS_TEST_FALSE(block.call<bool>("autoOffload"));
+
+        block.call("setCrossoverElements", (input0.elements() * 2));
+        block.call("setAutoOffload", true);
+        POTHOS_TEST_TRUE(block.call<bool>("autoOffload"));
+        POTHOS_TEST_EQUAL(
+            (input0.elements() * 2),
+            block.call<size_t>("crossoverElements"));
+
+        const bool isAbs = (std::string(blockPath) == "/gpu/arith/abs");
+        const auto outputs = isAbs ? runBlock(block, {input0})
+                                   : runBlock(block, {input0, input1});
+        testBufferChunk(
+            isAbs ? expectedAbsOutputs : expectedHypotOutputs,
+            outputs);
+    }
+
+    // Make sure measuring the crossover size doesn't affect the output.
+    auto absBlock = Pothos::BlockRegistry::make("/gpu/arith/abs", "Auto", dtype);
+    absBlock.call("setAutoOffload", true);
+    testBufferChunk(
+        expectedAbsOutputs,
+        runBlock(absBlock, {input0}));
+
+    // Blocks that don't process through the host backend don't expose it.
+    auto fftBlock = Pothos::BlockRegistry::make(
+                        "/gpu/signal/fft",
+                        "Auto",
+                        Pothos::DType("complex_float32"),
+                        Pothos::DType("complex_float32"),
+                        1024,
+                        1.0,
+                        false);
+    POTHOS_TEST_THROWS(
+        fftBlock.call("setAutoOffload", true),
+        Pothos::ProxyExceptionMessage);
+}
+
+// The taps are bound to the block's device, so on the host backend, they
+// must be re-created there.
+POTHOS_TEST_BLOCK("/gpu/tests", test_auto_offload_bound_taps)
+{
+    using namespace GPUTests;
+
+    setupTestEnv();
+
+    const auto inputs = getSignedTestInputs(dtype.name());
+    const std::vector<float> taps{0.25f, 0.5f, 0.25f};
+
+    for(const std::string blockPath: {"/gpu/signal/fir_filter", "/gpu/signal/convolve"})
+    {
+        std::cout << "Testing " << blockPath << "..." << std::endl;
+
+        auto block = Pothos::BlockRegistry::make(blockPath, "Auto", dtype);
+        block.call("setTaps", taps);
+        const auto expectedOutputs = runBlock(block, {inputs});
+
+        // Both forced onto the host, and with the crossover size measured
+        // on activation
+        for(const bool measureCrossover: {false, true})
+        {
+            auto offloadedBlock = Pothos::BlockRegistry::make(blockPath, "Auto", dtype);
+            offloadedBlock.call("setTaps", taps);
+            if(!measureCrossover) offloadedBlock.call("setCrossoverElements", (inputs.elements() * 2));
+            offloadedBlock.call("setAutoOffload", true);
+
+            testBufferChunk(
+                expectedOutputs,
+                runBlock(offloadedBlock, {inputs}));
+        }
+    }
+}
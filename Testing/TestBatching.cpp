@@ -0,0 +1,126 @@
+// Copyright (c) 2021 Nicholas Corgan
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "TestUtility.hpp"
+
+#include <Pothos/Framework.hpp>
+#include <Pothos/Proxy.hpp>
+#include <Pothos/Testing.hpp>
+
+#include <Poco/Thread.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+POTHOS_TEST_BLOCK("/gpu/tests", test_min_batch)
+{
+    using namespace GPUTests;
+
+    setupTestEnv();
+
+    static const Pothos::DType dtype("float32");
+
+    // The reserve is capped at what an upstream buffer pool can hold, so
+    // feed enough for two full pools.
+    const Pothos::BufferManagerArgs bufferArgs;
+    const size_t poolElements = (bufferArgs.numBuffers * bufferArgs.bufferSize) / dtype.size();
+
+    const auto inputs = getTestInputs(dtype.name());
+    const size_t numBuffers = 2 * std::max<size_t>(1, poolElements / inputs.elements());
+    Pothos::BufferChunk expectedOutputs(dtype, inputs.elements() * numBuffers);
+    for(size_t elem = 0; elem < expectedOutputs.elements(); ++elem)
+    {
+        expectedOutputs.as<float*>()[elem] = std::abs(inputs.as<const float*>()[elem % inputs.elements()]);
+    }
+
+    // Test both waiting for a full batch and a batch bigger than upstream
+    // blocks can buffer, which is processed as the buffers fill.
+    for(const size_t minBatchElements: {poolElements, (poolElements * 100)})
+    {
+        auto absBlock = Pothos::BlockRegistry::make("/gpu/arith/abs", "Auto", dtype);
+        absBlock.call("setMinBatchElements", minBatchElements);
+        absBlock.call("setMaxLatencyUs", 5000);
+        POTHOS_TEST_EQUAL(minBatchElements, absBlock.call<size_t>("minBatchElements"));
+        POTHOS_TEST_EQUAL(5000, absBlock.call<size_t>("maxLatencyUs"));
+
+        auto feederSource = Pothos::BlockRegistry::make(
+                                "/blocks/feeder_source",
+                                dtype);
+        for(size_t i = 0; i < numBuffers; ++i) feederSource.call("feedBuffer", inputs);
+
+        auto collectorSink = Pothos::BlockRegistry::make(
+                                 "/blocks/collector_sink",
+                                 dtype);
+
+        {
+            Pothos::Topology topology;
+            topology.connect(feederSource, 0, absBlock, 0);
+            topology.connect(absBlock, 0, collectorSink, 0);
+
+            topology.commit();
+            POTHOS_TEST_TRUE(topology.waitInactive(0.05));
+        }
+
+        testBufferChunk(
+            expectedOutputs,
+            collectorSink.call<Pothos::BufferChunk>("getBuffer"));
+    }
+}
+
+POTHOS_TEST_BLOCK("/gpu/tests", test_max_batch_latency)
+{
+    using namespace GPUTests;
+
+    setupTestEnv();
+
+    static const Pothos::DType dtype("float32");
+
+    // Scheduling adds some delay on top of the deadline.
+    constexpr size_t maxLatencyUs = 20000;
+    constexpr auto maxWait = std::chrono::microseconds(maxLatencyUs) + std::chrono::milliseconds(50);
+
+    // Less than a batch, and nothing else follows, so only the deadline
+    // can flush it.
+    const auto inputs = getTestInputs(dtype.name());
+    Pothos::BufferChunk expectedOutputs(dtype, inputs.elements());
+    for(size_t elem = 0; elem < inputs.elements(); ++elem)
+    {
+        expectedOutputs.as<float*>()[elem] = std::abs(inputs.as<const float*>()[elem]);
+    }
+
+    auto absBlock = Pothos::BlockRegistry::make("/gpu/arith/abs", "Auto", dtype);
+    absBlock.call("setMinBatchElements", inputs.elements() * 16);
+    absBlock.call("setMaxLatencyUs", maxLatencyUs);
+
+    auto feederSource = Pothos::BlockRegistry::make(
+                            "/blocks/feeder_source",
+                            dtype);
+    feederSource.call("feedBuffer", inputs);
+
+    auto collectorSink = Pothos::BlockRegistry::make(
+                             "/blocks/collector_sink",
+                             dtype);
+
+    Pothos::Topology topology;
+    topology.connect(feederSource, 0, absBlock, 0);
+    topology.connect(absBlock, 0, collectorSink, 0);
+
+    const auto start = std::chrono::steady_clock::now();
+    topology.commit();
+
+    auto outputs = collectorSink.call<Pothos::BufferChunk>("getBuffer");
+    while((outputs.length < inputs.length) &&
+          ((std::chrono::steady_clock::now() - start) < (maxWait * 4)))
+    {
+        Poco::Thread::sleep(1);
+        outputs = collectorSink.call<Pothos::BufferChunk>("getBuffer");
+    }
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+
+    POTHOS_TEST_EQUAL(inputs.length, outputs.length);
+    POTHOS_TEST_TRUE(elapsed <= maxWait);
+    testBufferChunk(expectedOutputs, outputs);
+
+    POTHOS_TEST_TRUE(topology.waitInactive(0.05));
+}
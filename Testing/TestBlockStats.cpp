@@ -0,0 +1,168 @@
+// Copyright (c) 2021 Nicholas Corgan
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "TestUtility.hpp"
+
+#include <Pothos/Framework.hpp>
+#include <Pothos/Proxy.hpp>
+#include <Pothos/Testing.hpp>
+
+#include <Poco/TemporaryFile.h>
+
+#include <nlohmann/json.hpp>
+
+#include <fstream>
+#include <set>
+#include <string>
+
+namespace GPUTests
+{
+
+static const Pothos::DType dtype("float32");
+
+static Pothos::Proxy makeAbsBlock()
+{
+    return Pothos::BlockRegistry::make(
+               "/gpu/arith/abs",
+               "Auto",
+               dtype);
+}
+
+static void runAbsBlock(
+    const Pothos::Proxy& absBlock,
+    const Pothos::BufferChunk& inputs)
+{
+    auto feederSource = Pothos::BlockRegistry::make(
+                            "/blocks/feeder_source",
+                            dtype);
+    feederSource.call("feedBuffer", inputs);
+
+    auto collectorSink = Pothos::BlockRegistry::make(
+                             "/blocks/collector_sink",
+                             dtype);
+
+    Pothos::Topology topology;
+    topology.connect(feederSource, 0, absBlock, 0);
+    topology.connect(absBlock, 0, collectorSink, 0);
+
+    topology.commit();
+    POTHOS_TEST_TRUE(topology.waitInactive(0.05));
+}
+
+}
+
+POTHOS_TEST_BLOCK("/gpu/tests", test_block_stats)
+{
+    using namespace GPUTests;
+
+    setupTestEnv();
+
+    const auto testInputs = getTestInputs(dtype.name());
+
+    auto absBlock = makeAbsBlock();
+    absBlock.call("setStatsEnabled", true);
+    POTHOS_TEST_TRUE(absBlock.call<bool>("statsEnabled"));
+
+    runAbsBlock(absBlock, testInputs);
+
+    auto stats = nlohmann::json::parse(absBlock.call<std::string>("stats"));
+    POTHOS_TEST_TRUE(stats["Calls"].get<size_t>() > 0);
+    POTHOS_TEST_EQUAL(testInputs.elements(), stats["Elements"].get<size_t>());
+    POTHOS_TEST_EQUAL(testInputs.length, stats["Bytes H2D"].get<size_t>());
+    POTHOS_TEST_EQUAL(testInputs.length, stats["Bytes D2H"].get<size_t>());
+
+    // Live blocks with stats should show up in the module info.
+    const auto info = nlohmann::json::parse(getAndCallPlugin<std::string>("/devices/gpu/info"));
+    POTHOS_TEST_TRUE(info.count("PothosGPU Block Stats") > 0);
+
+    absBlock.call("resetStats");
+    stats = nlohmann::json::parse(absBlock.call<std::string>("stats"));
+    POTHOS_TEST_EQUAL(0, stats["Calls"].get<size_t>());
+}
+
+POTHOS_TEST_BLOCK("/gpu/tests", test_block_stats_device_totals)
+{
+    using namespace GPUTests;
+
+    setupTestEnv();
+
+    const auto testInputs = getTestInputs(dtype.name());
+
+    auto absBlock = makeAbsBlock();
+    absBlock.call("setStatsEnabled", false);
+
+    const auto deviceName = absBlock.call<std::string>("device");
+    auto getDeviceTotals = [&deviceName]()
+    {
+        const auto stats = nlohmann::json::parse(getAndCallPlugin<std::string>("/devices/gpu/stats"));
+
+        nlohmann::json deviceTotals;
+        for(const auto& deviceStats: stats.at("Devices"))
+        {
+            if(deviceName == deviceStats.at("Name").get<std::string>()) deviceTotals = deviceStats;
+        }
+        POTHOS_TEST_FALSE(deviceTotals.is_null());
+
+        return deviceTotals;
+    };
+
+    const auto originalTotals = getDeviceTotals();
+
+    runAbsBlock(absBlock, testInputs);
+
+    // Transfers count towards the device totals even with stats disabled,
+    // but the block's untimed calls mean the kernel time is incomplete.
+    const auto totals = getDeviceTotals();
+    POTHOS_TEST_EQUAL(
+        originalTotals.at("Bytes H2D").get<size_t>() + testInputs.length,
+        totals.at("Bytes H2D").get<size_t>());
+    POTHOS_TEST_EQUAL(
+        originalTotals.at("Bytes D2H").get<size_t>() + testInputs.length,
+        totals.at("Bytes D2H").get<size_t>());
+    POTHOS_TEST_FALSE(totals.at("Kernel Time Recorded").get<bool>());
+
+    // Nothing is recorded for the block itself.
+    const auto stats = nlohmann::json::parse(absBlock.call<std::string>("stats"));
+    POTHOS_TEST_EQUAL(0, stats["Calls"].get<size_t>());
+    POTHOS_TEST_EQUAL(0, stats["Bytes H2D"].get<size_t>());
+}
+
+POTHOS_TEST_BLOCK("/gpu/tests", test_block_trace)
+{
+    using namespace GPUTests;
+
+    setupTestEnv();
+
+    Poco::TemporaryFile tempFile;
+
+    getAndCallPlugin<void>("/devices/gpu/start_trace", tempFile.path());
+    POTHOS_TEST_EQUAL(
+        tempFile.path(),
+        getAndCallPlugin<std::string>("/devices/gpu/trace_file"));
+
+    // Stats don't need to be enabled for tracing.
+    auto absBlock = makeAbsBlock();
+    runAbsBlock(absBlock, getTestInputs(dtype.name()));
+
+    getAndCallPlugin<void>("/devices/gpu/stop_trace");
+    POTHOS_TEST_TRUE(getAndCallPlugin<std::string>("/devices/gpu/trace_file").empty());
+
+    std::ifstream traceFile(tempFile.path());
+    const auto trace = nlohmann::json::parse(traceFile);
+    POTHOS_TEST_TRUE(trace.is_array());
+
+    std::set<std::string> spanNames;
+    for(const auto& event: trace)
+    {
+        if("X" != event["ph"].get<std::string>()) continue;
+
+        spanNames.emplace(event["name"].get<std::string>());
+        POTHOS_TEST_EQUAL(
+            absBlock.call<std::string>("device"),
+            event["args"]["device"].get<std::string>());
+    }
+    for(const std::string& name: {"Work", "Upload", "Compute", "Sync", "Download"})
+    {
+        POTHOS_TEST_EQUAL(1, spanNames.count(name));
+    }
+}
@@ -1,8 +1,9 @@
-// Copyright (c) 2019-2020 Nicholas Corgan
+// Copyright (c) 2019-2021 Nicholas Corgan
 // SPDX-License-Identifier: BSD-3-Clause
 
 #include "BufferConversions.hpp"
 #include "DeviceCache.hpp"
+#include "DeviceThreads.hpp"
 #include "Utility.hpp"
 #include "TestUtility.hpp"
 
@@ -41,6 +42,14 @@ static void test1DArrayConversion(const Pothos::DType& dtype)
     compareAfArrayToBufferChunk(
         convertedAfArray,
         convertedBufferChunk);
+
+    // Blocks skip the registry and call these directly.
+    compareAfArrayToBufferChunk(
+        afArray,
+        afArrayTypeToBufferChunk(afArray));
+    compareAfArrayToBufferChunk(
+        bufferChunkToAfArray(convertedBufferChunk, afDType),
+        convertedBufferChunk);
 }
 
 static void test2DArrayConversion(const Pothos::DType& dtype)
@@ -101,7 +110,7 @@ POTHOS_TEST_BLOCK("/gpu/tests", test_af_array_conversion)
 
     for(const auto& backend: getAvailableBackends())
     {
-        af::setBackend(backend);
+        setThreadBackend(backend);
         std::cout << "Backend: " << Pothos::Object(backend).convert<std::string>() << std::endl;
 
         for(const auto& dtype: getAllDTypes())
@@ -117,7 +126,7 @@ POTHOS_TEST_BLOCK("/gpu/tests", test_af_arrayproxy_conversion)
 
     for(const auto& backend: getAvailableBackends())
     {
-        af::setBackend(backend);
+        setThreadBackend(backend);
         std::cout << "Backend: " << Pothos::Object(backend).convert<std::string>() << std::endl;
 
         for(const auto& dtype: getAllDTypes())
@@ -133,7 +142,7 @@ POTHOS_TEST_BLOCK("/gpu/tests", test_std_vector_conversion)
 
     for(const auto& backend: getAvailableBackends())
     {
-        af::setBackend(backend);
+        setThreadBackend(backend);
         std::cout << "Backend: " << Pothos::Object(backend).convert<std::string>() << std::endl;
 
         testStdVectorToAfArrayConversion<float>(::f32);
@@ -0,0 +1,261 @@
+// Copyright (c) 2021 Nicholas Corgan
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "CaptureFile.hpp"
+#include "TestUtility.hpp"
+
+#include <Pothos/Framework.hpp>
+#include <Pothos/Proxy.hpp>
+#include <Pothos/Testing.hpp>
+
+#include <Poco/File.h>
+#include <Poco/TemporaryFile.h>
+
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace GPUTests
+{
+
+static constexpr size_t NumSamples = 1000;
+static constexpr size_t ChunkSamples = 64;
+static constexpr size_t LabelIndex = 500;
+static const std::string LabelID = "marker";
+static constexpr double LabelData = 1.5;
+
+// Magic, first sample, number of samples, CRC-32
+static constexpr size_t ChunkHeaderSize = 4 + 8 + 8 + 4;
+
+static std::string writeCaptureFile(const std::vector<float>& input)
+{
+    Poco::TemporaryFile tempFile;
+    tempFile.keepUntilExit();
+
+    auto feederSource = Pothos::BlockRegistry::make(
+                            "/blocks/feeder_source",
+                            "float32");
+    feederSource.call("feedBuffer", stdVectorToBufferChunk(input));
+    feederSource.call("feedLabel", Pothos::Label(LabelID, LabelData, LabelIndex));
+
+    auto captureSink = Pothos::BlockRegistry::make(
+                           "/gpu/array/capture_sink",
+                           tempFile.path(),
+                           "float32",
+                           1,
+                           ChunkSamples);
+
+    {
+        Pothos::Topology topology;
+        topology.connect(feederSource, 0, captureSink, 0);
+
+        topology.commit();
+        POTHOS_TEST_TRUE(topology.waitInactive(0.05));
+    }
+
+    return tempFile.path();
+}
+
+static std::vector<float> playBack(
+    const Pothos::Proxy& fileSource,
+    std::vector<Pothos::Label>* pLabels = nullptr)
+{
+    auto collectorSink = Pothos::BlockRegistry::make(
+                             "/blocks/collector_sink",
+                             "float32");
+
+    {
+        Pothos::Topology topology;
+        topology.connect(fileSource, 0, collectorSink, 0);
+
+        topology.commit();
+        POTHOS_TEST_TRUE(topology.waitInactive(0.05));
+    }
+
+    if(pLabels) *pLabels = collectorSink.call<std::vector<Pothos::Label>>("getLabels");
+
+    return bufferChunkToStdVector<float>(collectorSink.call<Pothos::BufferChunk>("getBuffer"));
+}
+
+static std::string copyFile(const std::string& filepath)
+{
+    Poco::TemporaryFile tempFile;
+    tempFile.keepUntilExit();
+    Poco::File(filepath).copyTo(tempFile.path());
+
+    return tempFile.path();
+}
+
+}
+
+POTHOS_TEST_BLOCK("/gpu/tests", test_capture_file)
+{
+    using namespace GPUTests;
+
+    setupTestEnv();
+
+    const auto input = linspace<float>(0.0f, 999.0f, NumSamples);
+    const auto filepath = writeCaptureFile(input);
+
+    std::cout << "Testing full playback..." << std::endl;
+    {
+        auto fileSource = Pothos::BlockRegistry::make(
+                              "/gpu/array/file_source",
+                              "Auto",
+                              filepath,
+                              "",
+                              false /*repeat*/);
+        POTHOS_TEST_EQUAL(NumSamples, fileSource.call<size_t>("numSamples"));
+
+        std::vector<Pothos::Label> labels;
+        const auto output = playBack(fileSource, &labels);
+        POTHOS_TEST_EQUALV(input, output);
+
+        // The label data should keep its type.
+        POTHOS_TEST_EQUAL(1, labels.size());
+        POTHOS_TEST_EQUAL(LabelID, labels[0].id);
+        POTHOS_TEST_EQUAL(LabelIndex, labels[0].index);
+        POTHOS_TEST_EQUAL(LabelData, labels[0].data.extract<double>());
+    }
+
+    // The range deliberately starts and ends mid-chunk.
+    std::cout << "Testing range playback..." << std::endl;
+    {
+        constexpr size_t start = 100;
+        constexpr size_t stop = 300;
+
+        auto fileSource = Pothos::BlockRegistry::make(
+                              "/gpu/array/file_source",
+                              "Auto",
+                              filepath,
+                              "",
+                              false /*repeat*/);
+        fileSource.call("setRange", start, stop);
+        POTHOS_TEST_EQUAL(start, fileSource.call<size_t>("position"));
+
+        const auto output = playBack(fileSource);
+        POTHOS_TEST_EQUALV(
+            std::vector<float>(input.begin()+start, input.begin()+stop),
+            output);
+    }
+
+    std::cout << "Testing seeking to a label..." << std::endl;
+    {
+        auto fileSource = Pothos::BlockRegistry::make(
+                              "/gpu/array/file_source",
+                              "Auto",
+                              filepath,
+                              "",
+                              false /*repeat*/);
+        fileSource.call("seekToLabel", LabelID);
+        POTHOS_TEST_EQUAL(LabelIndex, fileSource.call<size_t>("position"));
+
+        std::vector<Pothos::Label> labels;
+        const auto output = playBack(fileSource, &labels);
+        POTHOS_TEST_EQUALV(
+            std::vector<float>(input.begin()+LabelIndex, input.end()),
+            output);
+
+        POTHOS_TEST_EQUAL(1, labels.size());
+        POTHOS_TEST_EQUAL(0, labels[0].index);
+    }
+
+    std::cout << "Testing a corrupt payload..." << std::endl;
+    {
+        const auto corruptFilepath = copyFile(filepath);
+        const auto chunkOffset = CaptureFileReader(corruptFilepath).chunks()[1].offset;
+
+        std::fstream file(corruptFilepath, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekg(static_cast<std::streamoff>(chunkOffset + ChunkHeaderSize));
+        char byte = 0;
+        file.read(&byte, 1);
+        byte = static_cast<char>(~byte);
+        file.seekp(static_cast<std::streamoff>(chunkOffset + ChunkHeaderSize));
+        file.write(&byte, 1);
+        file.close();
+
+        // Only the corrupt chunk should fail its checksum.
+        CaptureFileReader reader(corruptFilepath);
+        std::vector<float> output(ChunkSamples);
+        reader.read(0, ChunkSamples, {output.data()});
+        POTHOS_TEST_THROWS(
+            reader.read(ChunkSamples, ChunkSamples, {output.data()}),
+            Pothos::DataFormatException);
+    }
+
+    // Without a valid footer, the complete chunks should still be readable,
+    // but the labels are lost.
+    std::cout << "Testing a missing or truncated footer..." << std::endl;
+    {
+        const auto lastChunk = CaptureFileReader(filepath).chunks().back();
+        const auto chunksEnd = static_cast<Poco::File::FileSize>(lastChunk.offset + ChunkHeaderSize + (lastChunk.numSamples * sizeof(float)));
+        const auto fileSize = Poco::File(filepath).getSize();
+
+        for(const Poco::File::FileSize newSize: {chunksEnd, (fileSize - 4), (chunksEnd - 4)})
+        {
+            const auto truncatedFilepath = copyFile(filepath);
+            Poco::File(truncatedFilepath).setSize(newSize);
+
+            // Truncating into the last chunk loses that chunk.
+            const size_t expectedSamples = (newSize < chunksEnd) ? (NumSamples - static_cast<size_t>(lastChunk.numSamples))
+                                                                 : NumSamples;
+
+            CaptureFileReader reader(truncatedFilepath);
+            POTHOS_TEST_EQUAL(expectedSamples, reader.numSamples());
+            POTHOS_TEST_TRUE(reader.labels().empty());
+
+            std::vector<float> output(expectedSamples);
+            reader.read(0, expectedSamples, {output.data()});
+            POTHOS_TEST_EQUALV(
+                std::vector<float>(input.begin(), input.begin()+expectedSamples),
+                output);
+        }
+    }
+}
+
+POTHOS_TEST_BLOCK("/gpu/tests", test_capture_file_mixed_types)
+{
+    using namespace GPUTests;
+
+    setupTestEnv();
+
+    Poco::TemporaryFile tempFile;
+
+    const auto floatInput = linspace<float>(0.0f, 999.0f, NumSamples);
+    const auto intInput = linspace<std::int16_t>(-500, 499, NumSamples);
+
+    auto floatSource = Pothos::BlockRegistry::make("/blocks/feeder_source", "float32");
+    floatSource.call("feedBuffer", stdVectorToBufferChunk(floatInput));
+
+    auto intSource = Pothos::BlockRegistry::make("/blocks/feeder_source", "int16");
+    intSource.call("feedBuffer", stdVectorToBufferChunk(intInput));
+
+    auto captureSink = Pothos::BlockRegistry::make(
+                           "/gpu/array/capture_sink",
+                           tempFile.path(),
+                           std::vector<Pothos::DType>{Pothos::DType("float32"), Pothos::DType("int16")},
+                           ChunkSamples);
+
+    {
+        Pothos::Topology topology;
+        topology.connect(floatSource, 0, captureSink, 0);
+        topology.connect(intSource, 0, captureSink, 1);
+
+        topology.commit();
+        POTHOS_TEST_TRUE(topology.waitInactive(0.05));
+    }
+
+    CaptureFileReader reader(tempFile.path());
+    POTHOS_TEST_EQUAL(2, reader.numChannels());
+    POTHOS_TEST_EQUAL("float32", reader.dtype(0).name());
+    POTHOS_TEST_EQUAL("int16", reader.dtype(1).name());
+    POTHOS_TEST_EQUAL(NumSamples, reader.numSamples());
+
+    std::vector<float> floatOutput(NumSamples);
+    std::vector<std::int16_t> intOutput(NumSamples);
+    reader.read(0, NumSamples, {floatOutput.data(), intOutput.data()});
+    POTHOS_TEST_EQUALV(floatInput, floatOutput);
+    POTHOS_TEST_EQUALV(intInput, intOutput);
+}
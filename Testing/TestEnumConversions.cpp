@@ -1,6 +1,7 @@
-// Copyright (c) 2019-2020 Nicholas Corgan
+// Copyright (c) 2019-2021 Nicholas Corgan
 // SPDX-License-Identifier: BSD-3-Clause
 
+#include "EnumConversions.hpp"
 #include "Utility.hpp"
 
 #include <Pothos/Framework.hpp>
@@ -52,6 +53,10 @@ static void testDTypeEnumUsage(
     auto dtypeFromAF = Pothos::Object(afDType).convert<Pothos::DType>();
     POTHOS_TEST_EQUAL(dtypeName, dtypeFromAF.name());
 
+    // The direct conversions should match the registered ones.
+    POTHOS_TEST_EQUAL(afDType, pothosDTypeToAfDType(dtype));
+    POTHOS_TEST_EQUAL(dtypeName, afDTypeToPothosDType(afDType).name());
+
     testEnumValueConversion(dtypeName, afDType);
 }
 
@@ -0,0 +1,144 @@
+// Copyright (c) 2021 Nicholas Corgan
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "TestUtility.hpp"
+
+#include "Expression.hpp"
+
+#include <Pothos/Exception.hpp>
+#include <Pothos/Framework.hpp>
+#include <Pothos/Object/Containers.hpp>
+#include <Pothos/Testing.hpp>
+
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+static constexpr size_t BufferLen = 4096;
+
+POTHOS_TEST_BLOCK("/gpu/tests", test_expression_parsing)
+{
+    const Expression expression("sqrt(x0*x0 + x2^2) * gain - offset/gain");
+    POTHOS_TEST_EQUAL(3, expression.numInputs());
+
+    const std::vector<std::string> expectedNames{"gain", "offset"};
+    POTHOS_TEST_EQUALV(expectedNames, expression.parameterNames());
+
+    const std::vector<std::string> invalidExpressions =
+    {
+        "",
+        "x0 +",
+        "(x0",
+        "x0 $ x1",
+        "sqrt(x0, x1)",
+        "atan2(x0)",
+        "notAFunction(x0)",
+        "x0 + x99999999999999999999999",
+    };
+    for(const auto& invalidExpression: invalidExpressions)
+    {
+        std::cout << " * Testing \"" << invalidExpression << "\"..." << std::endl;
+        POTHOS_TEST_THROWS(
+            Expression{invalidExpression},
+            Pothos::InvalidArgumentException);
+    }
+}
+
+POTHOS_TEST_BLOCK("/gpu/tests", test_expression_block)
+{
+    GPUTests::setupTestEnv();
+
+    const Pothos::DType dtype("float32");
+
+    std::random_device rd;
+    std::mt19937 g(rd());
+    std::uniform_real_distribution<float> distribution(-100.0f, 100.0f);
+
+    Pothos::BufferChunk inputs[2] =
+    {
+        Pothos::BufferChunk(dtype, BufferLen),
+        Pothos::BufferChunk(dtype, BufferLen)
+    };
+    for(size_t elem = 0; elem < BufferLen; ++elem)
+    {
+        inputs[0].as<float*>()[elem] = distribution(g);
+        inputs[1].as<float*>()[elem] = distribution(g);
+    }
+
+    auto getExpectedOutputs = [&inputs, &dtype](float gain)
+    {
+        Pothos::BufferChunk expectedOutputs(dtype, BufferLen);
+        for(size_t elem = 0; elem < BufferLen; ++elem)
+        {
+            const auto x0 = inputs[0].as<const float*>()[elem];
+            const auto x1 = inputs[1].as<const float*>()[elem];
+
+            expectedOutputs.as<float*>()[elem] = std::sqrt(x0*x0 + x1*x1) * gain;
+        }
+
+        return expectedOutputs;
+    };
+
+    constexpr float gain = 0.5f;
+
+    auto expression = Pothos::BlockRegistry::make(
+                          "/gpu/arith/expression",
+                          "Auto",
+                          dtype,
+                          2);
+    expression.call("setExpression", "sqrt(x0*x0 + x1*x1) * gain");
+    POTHOS_TEST_EQUAL(
+        "sqrt(x0*x0 + x1*x1) * gain",
+        expression.call<std::string>("expression"));
+
+    // Expressions that use more inputs than the block has are rejected.
+    POTHOS_TEST_THROWS(
+        expression.call("setExpression", "x0 + x2"),
+        Pothos::InvalidArgumentException);
+    POTHOS_TEST_THROWS(
+        expression.call("setParameter", "notAParameter", 1.0),
+        Pothos::InvalidArgumentException);
+
+    Pothos::ObjectMap parameters;
+    parameters[Pothos::Object("gain")] = Pothos::Object(gain);
+    expression.call("setParameters", parameters);
+    POTHOS_TEST_CLOSE(gain, expression.call<double>("parameter", "gain"), 1e-6);
+
+    auto runExpression = [&]()
+    {
+        auto sink = Pothos::BlockRegistry::make("/blocks/collector_sink", dtype);
+
+        {
+            Pothos::Topology topology;
+            for(size_t chan = 0; chan < 2; ++chan)
+            {
+                auto source = Pothos::BlockRegistry::make("/blocks/feeder_source", dtype);
+                source.call("feedBuffer", inputs[chan]);
+
+                topology.connect(source, 0, expression, chan);
+            }
+            topology.connect(expression, 0, sink, 0);
+
+            topology.commit();
+            POTHOS_TEST_TRUE(topology.waitInactive(0.01));
+        }
+
+        return sink.call<Pothos::BufferChunk>("getBuffer");
+    };
+
+    GPUTests::testBufferChunk(
+        getExpectedOutputs(gain),
+        runExpression());
+
+    // Changing a parameter after the block has run must not reuse the
+    // kernel built with the old value.
+    constexpr float newGain = -2.0f;
+    expression.call("setParameter", "gain", newGain);
+    POTHOS_TEST_CLOSE(newGain, expression.call<double>("parameter", "gain"), 1e-6);
+
+    GPUTests::testBufferChunk(
+        getExpectedOutputs(newGain),
+        runExpression());
+}
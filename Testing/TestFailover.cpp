@@ -0,0 +1,189 @@
+// Copyright (c) 2021 Nicholas Corgan
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "DeviceCache.hpp"
+#include "TestUtility.hpp"
+
+#include <Pothos/Framework.hpp>
+#include <Pothos/Proxy.hpp>
+#include <Pothos/Testing.hpp>
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+namespace GPUTests
+{
+
+static const Pothos::DType dtype("float32");
+
+static Pothos::BufferChunk runBlock(
+    const Pothos::Proxy& block,
+    const std::vector<Pothos::BufferChunk>& inputs)
+{
+    Pothos::Topology topology;
+
+    std::vector<Pothos::Proxy> feederSources;
+    for(size_t input = 0; input < inputs.size(); ++input)
+    {
+        feederSources.emplace_back(Pothos::BlockRegistry::make(
+                                       "/blocks/feeder_source",
+                                       dtype));
+        feederSources.back().call("feedBuffer", inputs[input]);
+
+        topology.connect(feederSources.back(), 0, block, input);
+    }
+
+    auto collectorSink = Pothos::BlockRegistry::make(
+                             "/blocks/collector_sink",
+                             dtype);
+    topology.connect(block, 0, collectorSink, 0);
+
+    topology.commit();
+    POTHOS_TEST_TRUE(topology.waitInactive(0.05));
+
+    return collectorSink.call<Pothos::BufferChunk>("getBuffer");
+}
+
+}
+
+POTHOS_TEST_BLOCK("/gpu/tests", test_failover)
+{
+    using namespace GPUTests;
+
+    setupTestEnv();
+
+    // Faults are simulated, so this only needs a CPU device, which is also
+    // the failover device.
+    const auto cpuDevice = getCPUOrBestDevice();
+    if("Auto" == cpuDevice) return;
+
+    // Signed, so abs() changes the data
+    const auto input0 = getSignedTestInputs(dtype.name());
+    const auto input1 = getSignedTestInputs(dtype.name());
+
+    Pothos::BufferChunk expectedAbsOutputs(dtype, input0.elements());
+    Pothos::BufferChunk expectedHypotOutputs(dtype, input0.elements());
+    for(size_t elem = 0; elem < input0.elements(); ++elem)
+    {
+        expectedAbsOutputs.as<float*>()[elem] = std::abs(input0.as<const float*>()[elem]);
+        expectedHypotOutputs.as<float*>()[elem] = std::hypot(
+                                                      input0.as<const float*>()[elem],
+                                                      input1.as<const float*>()[elem]);
+    }
+
+    for(const std::string blockPath: {"/gpu/arith/abs", "/gpu/arith/hypot"})
+    {
+        auto block = Pothos::BlockRegistry::make(blockPath, cpuDevice, dtype);
+        POTHOS_TEST_FALSE(block.call<bool>("failover"));
+
+        block.call("setFailover", true);
+        block.call("setFailoverRetryMs", 100);
+        POTHOS_TEST_TRUE(block.call<bool>("failover"));
+        POTHOS_TEST_EQUAL(100, block.call<size_t>("failoverRetryMs"));
+
+        // The fault happens after the first input is consumed. The output
+        // should be unaffected, with every input processed exactly once.
+        block.call("injectDeviceFault");
+
+        const bool isAbs = ("/gpu/arith/abs" == blockPath);
+        const auto outputs = isAbs ? runBlock(block, {input0})
+                                   : runBlock(block, {input0, input1});
+        POTHOS_TEST_EQUAL(input0.elements(), outputs.elements());
+        if(isAbs)
+        {
+            POTHOS_TEST_EQUALA(
+                expectedAbsOutputs.as<const float*>(),
+                outputs.as<const float*>(),
+                outputs.elements());
+        }
+        else testBufferChunk(expectedHypotOutputs, outputs);
+
+        POTHOS_TEST_EQUAL(1, block.call<size_t>("deviceFaults"));
+        POTHOS_TEST_EQUAL(cpuDevice, block.call<std::string>("device"));
+    }
+
+    // Blocks with taps bound on their device re-create them on the
+    // failover device.
+    const std::vector<float> taps{0.25f, 0.5f, 0.25f};
+    const std::vector<float> feedbackCoeffs{1.0f, -1.142f, 0.412f};
+    for(const std::string blockPath: {"/gpu/signal/fir_filter", "/gpu/signal/iir_filter", "/gpu/signal/convolve"})
+    {
+        auto makeBlock = [&]()
+        {
+            auto block = Pothos::BlockRegistry::make(blockPath, cpuDevice, dtype);
+            if("/gpu/signal/iir_filter" == blockPath)
+            {
+                block.call("setFeedForwardCoeffs", taps);
+                block.call("setFeedbackCoeffs", feedbackCoeffs);
+            }
+            else block.call("setTaps", taps);
+
+            return block;
+        };
+
+        const auto expectedOutputs = runBlock(makeBlock(), {input0});
+
+        auto faultingBlock = makeBlock();
+        faultingBlock.call("setFailover", true);
+        faultingBlock.call("injectDeviceFault");
+
+        testBufferChunk(
+            expectedOutputs,
+            runBlock(faultingBlock, {input0}));
+        POTHOS_TEST_EQUAL(1, faultingBlock.call<size_t>("deviceFaults"));
+    }
+
+    // Multiple channels are output as the columns of one array. Each column
+    // should be output exactly once.
+    {
+        constexpr size_t numChannels = 2;
+
+        auto block = Pothos::BlockRegistry::make("/gpu/arith/abs", cpuDevice, dtype, numChannels);
+        block.call("setFailover", true);
+        block.call("injectDeviceFault");
+
+        std::vector<Pothos::Proxy> feederSources;
+        std::vector<Pothos::Proxy> collectorSinks;
+        {
+            Pothos::Topology topology;
+            for(size_t chan = 0; chan < numChannels; ++chan)
+            {
+                feederSources.emplace_back(Pothos::BlockRegistry::make("/blocks/feeder_source", dtype));
+                feederSources.back().call("feedBuffer", input0);
+                collectorSinks.emplace_back(Pothos::BlockRegistry::make("/blocks/collector_sink", dtype));
+
+                topology.connect(feederSources.back(), 0, block, chan);
+                topology.connect(block, chan, collectorSinks.back(), 0);
+            }
+
+            topology.commit();
+            POTHOS_TEST_TRUE(topology.waitInactive(0.05));
+        }
+
+        POTHOS_TEST_EQUAL(1, block.call<size_t>("deviceFaults"));
+        for(const auto& collectorSink: collectorSinks)
+        {
+            const auto outputs = collectorSink.call<Pothos::BufferChunk>("getBuffer");
+            POTHOS_TEST_EQUAL(input0.elements(), outputs.elements());
+            POTHOS_TEST_EQUALA(
+                expectedAbsOutputs.as<const float*>(),
+                outputs.as<const float*>(),
+                outputs.elements());
+        }
+    }
+
+    // Blocks that don't run their computation through runWithFailover()
+    // don't expose failover.
+    auto fftBlock = Pothos::BlockRegistry::make(
+                        "/gpu/signal/fft",
+                        cpuDevice,
+                        Pothos::DType("complex_float32"),
+                        Pothos::DType("complex_float32"),
+                        1024,
+                        1.0,
+                        false);
+    POTHOS_TEST_THROWS(
+        fftBlock.call("setFailover", true),
+        Pothos::ProxyExceptionMessage);
+}
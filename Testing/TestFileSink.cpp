@@ -1,17 +1,20 @@
 // Copyright (c) 2019-2020 Nicholas Corgan
 // SPDX-License-Identifier: BSD-3-Clause
 
+#include "ArrayFireBinary.hpp"
 #include "TestUtility.hpp"
 
 #include <Pothos/Framework.hpp>
 #include <Pothos/Proxy.hpp>
 #include <Pothos/Testing.hpp>
 
+#include <Poco/File.h>
 #include <Poco/TemporaryFile.h>
 #include <Poco/Timestamp.h>
 
 #include <arrayfire.h>
 
+#include <fstream>
 #include <iostream>
 #include <string>
 #include <vector>
@@ -178,6 +181,174 @@ static void testFileSink2D(
     }
 }
 
+
+// Enough data to span multiple writer chunks, fed as separate buffers so
+// it arrives over multiple work() calls.
+static constexpr size_t IncrementalChannels = 2;
+static constexpr size_t IncrementalBuffers = 10;
+static constexpr dim_t IncrementalBufferElements = 65536;
+
+static void testFileSinkIncremental(const std::string& filepath)
+{
+    std::cout << "Testing incremental writes..." << std::endl;
+
+    const Pothos::DType dtype("float32");
+    const auto afArray = af::randu(
+                             static_cast<dim_t>(IncrementalChannels),
+                             static_cast<dim_t>(IncrementalBuffers) * IncrementalBufferElements,
+                             ::f32);
+
+    auto fileSink = Pothos::BlockRegistry::make(
+                        "/gpu/array/file_sink",
+                        filepath,
+                        "incremental",
+                        dtype,
+                        IncrementalChannels,
+                        false /*append*/);
+
+    std::vector<Pothos::Proxy> feederSources;
+    for(size_t chan = 0; chan < IncrementalChannels; ++chan)
+    {
+        feederSources.emplace_back(Pothos::BlockRegistry::make(
+                                       "/blocks/feeder_source",
+                                       dtype));
+    }
+    for(size_t bufferIndex = 0; bufferIndex < IncrementalBuffers; ++bufferIndex)
+    {
+        const auto start = static_cast<dim_t>(bufferIndex) * IncrementalBufferElements;
+        const auto buffers = GPUTests::convert2DAfArrayToBufferChunks(
+                                 afArray(af::span, af::seq(static_cast<double>(start), static_cast<double>(start + IncrementalBufferElements - 1))));
+        for(size_t chan = 0; chan < IncrementalChannels; ++chan)
+        {
+            feederSources[chan].call("feedBuffer", buffers[chan]);
+        }
+    }
+
+    {
+        Pothos::Topology topology;
+        for(size_t chan = 0; chan < IncrementalChannels; ++chan)
+        {
+            topology.connect(
+                feederSources[chan],
+                0,
+                fileSink,
+                chan);
+        }
+
+        topology.commit();
+        POTHOS_TEST_TRUE(topology.waitInactive(0.1, 5.0));
+    }
+
+    auto arrFromFile = af::readArray(filepath.c_str(), "incremental");
+    POTHOS_TEST_EQUAL(2, arrFromFile.numdims());
+    POTHOS_TEST_EQUAL(IncrementalChannels, size_t(arrFromFile.dims(0)));
+    POTHOS_TEST_EQUAL(afArray.dims(1), arrFromFile.dims(1));
+
+    const auto expectedChunks = GPUTests::convert2DAfArrayToBufferChunks(afArray);
+    for(size_t chan = 0; chan < IncrementalChannels; ++chan)
+    {
+        compareAfArrayToBufferChunk(arrFromFile.row(chan), expectedChunks[chan]);
+    }
+}
+
+// Leave a file as an interrupted capture would: everything up to the last
+// completed write, then part of a write whose header was never updated.
+// Make sure it can still be read and appended to.
+static void testFileSinkAfterInterruption(const std::string& filepath)
+{
+    std::cout << "Testing appending after an interrupted capture..." << std::endl;
+
+    const Pothos::DType dtype("float32");
+    constexpr dim_t numChannels = 2;
+    constexpr dim_t numElements = 1024;
+
+    const auto writtenArray = af::randu(numChannels, numElements, ::f32);
+    const auto resumedArray = af::randu(numChannels, numElements, ::f32);
+
+    {
+        // Column-major, so this is already interleaved.
+        std::vector<char> columns(writtenArray.bytes());
+        writtenArray.host(columns.data());
+
+        ArrayFireBinaryWriter writer(
+            filepath,
+            "interrupted",
+            ::f32,
+            static_cast<size_t>(numChannels),
+            false /*append*/,
+            1 /*maxQueuedWrites*/);
+        writer.write(std::move(columns));
+        writer.close();
+        POTHOS_TEST_EQUAL(size_t(numElements), writer.samplesWritten());
+    }
+    {
+        const std::vector<char> partialWrite(100, 0x55);
+        std::ofstream file(filepath, std::ios::out | std::ios::binary | std::ios::app);
+        file.write(partialWrite.data(), static_cast<std::streamsize>(partialWrite.size()));
+    }
+
+    const auto writtenChunks = GPUTests::convert2DAfArrayToBufferChunks(writtenArray);
+    const auto resumedChunks = GPUTests::convert2DAfArrayToBufferChunks(resumedArray);
+
+    // Everything written before the interruption is readable.
+    {
+        auto arrFromFile = af::readArray(filepath.c_str(), "interrupted");
+        POTHOS_TEST_EQUAL(numElements, arrFromFile.dims(1));
+        for(dim_t chan = 0; chan < numChannels; ++chan)
+        {
+            compareAfArrayToBufferChunk(arrFromFile.row(chan), writtenChunks[chan]);
+        }
+    }
+
+    auto fileSink = Pothos::BlockRegistry::make(
+                        "/gpu/array/file_sink",
+                        filepath,
+                        "resumed",
+                        dtype,
+                        static_cast<size_t>(numChannels),
+                        true /*append*/);
+
+    std::vector<Pothos::Proxy> feederSources;
+    for(dim_t chan = 0; chan < numChannels; ++chan)
+    {
+        feederSources.emplace_back(Pothos::BlockRegistry::make(
+                                       "/blocks/feeder_source",
+                                       dtype));
+        feederSources.back().call("feedBuffer", resumedChunks[chan]);
+    }
+
+    {
+        Pothos::Topology topology;
+        for(dim_t chan = 0; chan < numChannels; ++chan)
+        {
+            topology.connect(
+                feederSources[chan],
+                0,
+                fileSink,
+                static_cast<size_t>(chan));
+        }
+
+        topology.commit();
+        POTHOS_TEST_TRUE(topology.waitInactive(0.05));
+    }
+
+    // The partial write is dropped, and both arrays are intact.
+    const auto entries = getArrayFireBinaryEntries(filepath);
+    POTHOS_TEST_EQUAL(2, entries.size());
+    POTHOS_TEST_EQUAL(
+        static_cast<Poco::File::FileSize>(entries.back().dataOffset + static_cast<std::streamoff>(entries.back().bytes())),
+        Poco::File(filepath).getSize());
+
+    auto interruptedArr = af::readArray(filepath.c_str(), "interrupted");
+    auto resumedArr = af::readArray(filepath.c_str(), "resumed");
+    POTHOS_TEST_EQUAL(numElements, resumedArr.dims(1));
+    for(dim_t chan = 0; chan < numChannels; ++chan)
+    {
+        compareAfArrayToBufferChunk(interruptedArr.row(chan), writtenChunks[chan]);
+        compareAfArrayToBufferChunk(resumedArr.row(chan), resumedChunks[chan]);
+    }
+}
+
 }
 
 POTHOS_TEST_BLOCK("/gpu/tests", test_file_sink)
@@ -230,3 +401,27 @@ POTHOS_TEST_BLOCK("/gpu/tests", test_file_sink)
     // TODO: test trying to append with wrong type, wrong dims
     // TODO: test valid appending
 }
+
+POTHOS_TEST_BLOCK("/gpu/tests", test_file_sink_incremental)
+{
+    using namespace GPUTests;
+
+    setupTestEnv();
+
+    Poco::TemporaryFile tempFile;
+    tempFile.keepUntilExit();
+
+    testFileSinkIncremental(tempFile.path());
+}
+
+POTHOS_TEST_BLOCK("/gpu/tests", test_file_sink_after_interruption)
+{
+    using namespace GPUTests;
+
+    setupTestEnv();
+
+    Poco::TemporaryFile tempFile;
+    tempFile.keepUntilExit();
+
+    testFileSinkAfterInterruption(tempFile.path());
+}
@@ -1,4 +1,4 @@
-// Copyright (c) 2019-2020 Nicholas Corgan
+// Copyright (c) 2019-2021 Nicholas Corgan
 // SPDX-License-Identifier: BSD-3-Clause
 
 #include "TestUtility.hpp"
@@ -8,10 +8,12 @@
 #include <Pothos/Testing.hpp>
 
 #include <Poco/TemporaryFile.h>
+#include <Poco/Thread.h>
 #include <Poco/Timestamp.h>
 
 #include <arrayfire.h>
 
+#include <cstring>
 #include <iostream>
 #include <string>
 #include <vector>
@@ -78,6 +80,7 @@ static void testFileSource1D(
 
     auto oneDimBlock = Pothos::BlockRegistry::make(
                            "/gpu/array/file_source",
+                           "Auto",
                            filepath,
                            testData.oneDimKey,
                            false /*repeat*/);
@@ -130,6 +133,7 @@ static void testFileSource2D(
 
     auto twoDimBlock = Pothos::BlockRegistry::make(
                            "/gpu/array/file_source",
+                           "Auto",
                            filepath,
                            testData.twoDimKey,
                            false /*repeat*/);
@@ -182,6 +186,54 @@ static void testFileSource2D(
     }
 }
 
+static void testFileSourceRepeat(
+    const std::string& filepath,
+    const TestData& testData)
+{
+    std::cout << "Testing " << testData.dtype.name()
+              << " (chans: 1, repeat)..." << std::endl;
+
+    auto repeatBlock = Pothos::BlockRegistry::make(
+                           "/gpu/array/file_source",
+                           "Auto",
+                           filepath,
+                           testData.oneDimKey,
+                           true /*repeat*/);
+    auto collectorSink = Pothos::BlockRegistry::make(
+                             "/blocks/collector_sink",
+                             testData.dtype);
+    POTHOS_TEST_TRUE(repeatBlock.call<bool>("repeat"));
+
+    // Execute the topology. This will never go inactive, so let it run.
+    {
+        Pothos::Topology topology;
+        topology.connect(
+            repeatBlock,
+            0,
+            collectorSink,
+            0);
+
+        topology.commit();
+        Poco::Thread::sleep(50 /*ms*/);
+    }
+
+    // The output should be the array over and over, seeking back to the
+    // beginning every time.
+    const auto bufferChunk = collectorSink.call<Pothos::BufferChunk>("getBuffer");
+    const auto arrayLength = testData.oneDimArray.length;
+    POTHOS_TEST_TRUE(bufferChunk.length > arrayLength);
+
+    for(size_t offset = 0; (offset + arrayLength) <= bufferChunk.length; offset += arrayLength)
+    {
+        POTHOS_TEST_EQUAL(
+            0,
+            std::memcmp(
+                testData.oneDimArray.as<const void*>(),
+                reinterpret_cast<const void*>(bufferChunk.address + offset),
+                arrayLength));
+    }
+}
+
 }
 
 POTHOS_TEST_BLOCK("/gpu/tests", test_file_source)
@@ -226,5 +278,8 @@ POTHOS_TEST_BLOCK("/gpu/tests", test_file_source)
         testFileSource2D(
             testDataFilepath,
             testData);
+        testFileSourceRepeat(
+            testDataFilepath,
+            testData);
     }
 }
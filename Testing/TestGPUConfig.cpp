@@ -1,17 +1,26 @@
-// Copyright (c) 2019-2020 Nicholas Corgan
+// Copyright (c) 2019-2021 Nicholas Corgan
 // SPDX-License-Identifier: BSD-3-Clause
 
 #include "DeviceCache.hpp"
+#include "DeviceThreads.hpp"
+#include "MemoryManager.hpp"
 #include "TestUtility.hpp"
 #include "Utility.hpp"
 
 #include <Pothos/Framework.hpp>
 #include <Pothos/Object.hpp>
+#include <Pothos/Proxy.hpp>
 #include <Pothos/Testing.hpp>
 
+#include <nlohmann/json.hpp>
+
 #include <arrayfire.h>
 
+#include <cmath>
+#include <set>
+#include <string>
 #include <typeinfo>
+#include <vector>
 
 POTHOS_TEST_BLOCK("/gpu/tests", test_pothosgpu_config)
 {
@@ -45,3 +54,330 @@ POTHOS_TEST_BLOCK("/gpu/tests", test_pothosgpu_config)
             abs.call<std::string>("device"));
     }
 }
+
+POTHOS_TEST_BLOCK("/gpu/tests", test_thread_backend_and_device)
+{
+    for(const auto& entry: getDeviceCache())
+    {
+        setThreadBackendAndDevice(entry.afBackendEnum, entry.afDeviceIndex);
+        POTHOS_TEST_EQUAL(entry.afBackendEnum, af::getActiveBackend());
+        POTHOS_TEST_EQUAL(entry.afDeviceIndex, af::getDevice());
+    }
+}
+
+POTHOS_TEST_BLOCK("/gpu/tests", test_device_thread_pools)
+{
+    using namespace GPUTests;
+
+    setupTestEnv();
+
+    static const Pothos::DType dtype("float32");
+
+    // Signed, so abs() changes the values.
+    const auto inputs = getSignedTestInputs(dtype.name());
+    Pothos::BufferChunk expectedOutputs(dtype, inputs.elements());
+    for(size_t elem = 0; elem < inputs.elements(); ++elem)
+    {
+        expectedOutputs.as<float*>()[elem] = std::abs(inputs.as<const float*>()[elem]);
+    }
+
+    const auto threadsPerPool = deviceThreadsPerPool();
+
+    // With pools disabled, blocks are left to the topology's pool.
+    setDeviceThreadsPerPool(0);
+    POTHOS_TEST_EQUAL(0, deviceThreadsPerPool());
+    {
+        auto abs = Pothos::BlockRegistry::make(
+                       "/gpu/arith/abs",
+                       "Auto",
+                       dtype);
+        POTHOS_TEST_FALSE(abs.call<Pothos::ThreadPool>("getThreadPool"));
+    }
+
+    setDeviceThreadsPerPool(1);
+    POTHOS_TEST_EQUAL(1, deviceThreadsPerPool());
+
+    for(const auto& entry: getDeviceCache())
+    {
+        auto abs = Pothos::BlockRegistry::make(
+                       "/gpu/arith/abs",
+                       entry.name,
+                       dtype);
+
+        // The block holds the device's pool, so this returns the same one.
+        const auto devicePool = getDeviceThreadPool(entry.afBackendEnum, entry.afDeviceIndex);
+        POTHOS_TEST_TRUE(devicePool);
+        POTHOS_TEST_TRUE(devicePool.getContainer() == abs.call<Pothos::ThreadPool>("getThreadPool").getContainer());
+
+        auto feederSource = Pothos::BlockRegistry::make(
+                                "/blocks/feeder_source",
+                                dtype);
+        feederSource.call("feedBuffer", inputs);
+
+        auto collectorSink = Pothos::BlockRegistry::make(
+                                 "/blocks/collector_sink",
+                                 dtype);
+
+        {
+            Pothos::Topology topology;
+            topology.connect(feederSource, 0, abs, 0);
+            topology.connect(abs, 0, collectorSink, 0);
+
+            topology.commit();
+            POTHOS_TEST_TRUE(topology.waitInactive(0.05));
+        }
+
+        // Committing the topology must not have replaced the pool.
+        POTHOS_TEST_TRUE(devicePool.getContainer() == abs.call<Pothos::ThreadPool>("getThreadPool").getContainer());
+
+        testBufferChunk(
+            expectedOutputs,
+            collectorSink.call<Pothos::BufferChunk>("getBuffer"));
+    }
+
+    setDeviceThreadsPerPool(threadsPerPool);
+}
+
+POTHOS_TEST_BLOCK("/gpu/tests", test_auto_device_placement)
+{
+    using namespace GPUTests;
+
+    static const Pothos::DType dtype("float32");
+
+    const auto policy = getAndCallPlugin<std::string>("/devices/gpu/auto_device_policy");
+    POTHOS_TEST_THROWS(
+        getAndCallPlugin<void>("/devices/gpu/set_auto_device_policy", std::string("Invalid")),
+        Pothos::InvalidArgumentException);
+
+    const auto& deviceCache = getDeviceCache();
+    std::set<std::string> candidates;
+    for(const auto& entry: deviceCache)
+    {
+        if(entry.afBackendEnum == deviceCache[0].afBackendEnum) candidates.emplace(entry.name);
+    }
+
+    for(const std::string& newPolicy: {"First", "RoundRobin", "LeastLoaded"})
+    {
+        getAndCallPlugin<void>("/devices/gpu/set_auto_device_policy", newPolicy);
+        POTHOS_TEST_EQUAL(
+            newPolicy,
+            getAndCallPlugin<std::string>("/devices/gpu/auto_device_policy"));
+
+        std::vector<Pothos::Proxy> blocks;
+        std::set<std::string> usedDevices;
+        for(size_t i = 0; i < candidates.size(); ++i)
+        {
+            blocks.emplace_back(Pothos::BlockRegistry::make("/gpu/arith/abs", "Auto", dtype));
+            POTHOS_TEST_EQUAL(newPolicy, blocks.back().call<std::string>("devicePlacement"));
+
+            const auto device = blocks.back().call<std::string>("device");
+            POTHOS_TEST_EQUAL(1, candidates.count(device));
+            usedDevices.emplace(device);
+        }
+
+        // Round-robin should have used every device once.
+        if("RoundRobin" == newPolicy) POTHOS_TEST_EQUAL(candidates.size(), usedDevices.size());
+        if("First" == newPolicy) POTHOS_TEST_EQUAL(1, usedDevices.size());
+
+        // Blocks in the same group should always share a device.
+        const auto groupDevice = Pothos::BlockRegistry::make("/gpu/arith/abs", "Auto:"+newPolicy, dtype).call<std::string>("device");
+        for(size_t i = 0; i < candidates.size(); ++i)
+        {
+            auto block = Pothos::BlockRegistry::make("/gpu/arith/abs", "Auto:"+newPolicy, dtype);
+            POTHOS_TEST_EQUAL(groupDevice, block.call<std::string>("device"));
+            POTHOS_TEST_EQUAL("Group "+newPolicy, block.call<std::string>("devicePlacement"));
+        }
+    }
+
+    // Blocks given a specific device aren't placed.
+    auto manualBlock = Pothos::BlockRegistry::make("/gpu/arith/abs", deviceCache[0].name, dtype);
+    POTHOS_TEST_EQUAL("Manual", manualBlock.call<std::string>("devicePlacement"));
+
+    getAndCallPlugin<void>("/devices/gpu/set_auto_device_policy", policy);
+}
+
+POTHOS_TEST_BLOCK("/gpu/tests", test_least_loaded_placement)
+{
+    using namespace GPUTests;
+
+    static const Pothos::DType dtype("float32");
+
+    // 64 MB, so it outweighs anything left over from other tests
+    static constexpr dim_t HeldElems = 16 * 1024 * 1024;
+
+    const auto policy = getAndCallPlugin<std::string>("/devices/gpu/auto_device_policy");
+    getAndCallPlugin<void>("/devices/gpu/set_auto_device_policy", std::string("LeastLoaded"));
+
+    const auto& deviceCache = getDeviceCache();
+    std::vector<const DeviceCacheEntry*> candidates;
+    for(const auto& entry: deviceCache)
+    {
+        if(entry.afBackendEnum == deviceCache[0].afBackendEnum) candidates.emplace_back(&entry);
+    }
+
+    // Arrays in use count toward a device's load.
+    {
+        const auto& entry = *candidates[0];
+        setThreadBackendAndDevice(entry.afBackendEnum, entry.afDeviceIndex);
+
+        const auto lockedBytes = memoryUsage(entry.afBackendEnum, entry.afDeviceIndex).lockedBytes;
+
+        af::array heldArray = af::constant(0.0f, HeldElems);
+        heldArray.eval();
+        af::sync();
+
+        POTHOS_TEST_TRUE(
+            memoryUsage(entry.afBackendEnum, entry.afDeviceIndex).lockedBytes >=
+            (lockedBytes + (HeldElems * sizeof(float))));
+    }
+
+    // With arrays held on every device but one, that device should be
+    // chosen.
+    if(candidates.size() > 1)
+    {
+        for(const auto* target: candidates)
+        {
+            std::vector<af::array> heldArrays;
+            for(const auto* candidate: candidates)
+            {
+                if(candidate == target) continue;
+
+                setThreadBackendAndDevice(candidate->afBackendEnum, candidate->afDeviceIndex);
+                heldArrays.emplace_back(af::constant(0.0f, HeldElems));
+                heldArrays.back().eval();
+                af::sync();
+            }
+
+            auto block = Pothos::BlockRegistry::make("/gpu/arith/abs", "Auto", dtype);
+            POTHOS_TEST_EQUAL(target->name, block.call<std::string>("device"));
+        }
+    }
+
+    getAndCallPlugin<void>("/devices/gpu/set_auto_device_policy", policy);
+}
+
+POTHOS_TEST_BLOCK("/gpu/tests", test_memory_manager)
+{
+    using namespace GPUTests;
+
+    setupTestEnv();
+
+    if(!memoryManagerInstalled()) return;
+
+    const auto cacheLimit = memoryCacheLimit();
+    setMemoryCacheLimit(1 << 24);
+    POTHOS_TEST_EQUAL((1 << 24), getAndCallPlugin<size_t>("/devices/gpu/memory_cache_limit"));
+
+    for(const auto& entry: getDeviceCache())
+    {
+        setThreadBackendAndDevice(entry.afBackendEnum, entry.afDeviceIndex);
+
+        // Make sure the first array's buffer isn't already cached.
+        (void)af::randu(1024).host<float>();
+        releaseMemoryCache(entry.afBackendEnum, entry.afDeviceIndex);
+
+        auto stats = memoryStatsToJSON(entry.afBackendEnum, entry.afDeviceIndex);
+        const auto cacheHits = stats["Cache Hits"].get<size_t>();
+        POTHOS_TEST_EQUAL(0, stats["Cached Bytes"].get<size_t>());
+
+        // Each array should reuse the last one's buffer.
+        for(size_t i = 0; i < 5; ++i)
+        {
+            af::array afArray = af::randu(1024);
+            afArray.eval();
+        }
+        af::sync();
+
+        stats = memoryStatsToJSON(entry.afBackendEnum, entry.afDeviceIndex);
+        POTHOS_TEST_EQUAL(entry.name, stats["Device"].get<std::string>());
+        POTHOS_TEST_TRUE(stats["Cache Hits"].get<size_t>() >= (cacheHits + 4));
+        POTHOS_TEST_TRUE(stats["Cached Bytes"].get<size_t>() > 0);
+    }
+
+    setMemoryCacheLimit(cacheLimit);
+}
+
+POTHOS_TEST_BLOCK("/gpu/tests", test_memory_budget)
+{
+    using namespace GPUTests;
+
+    setupTestEnv();
+
+    static constexpr size_t budget = 1 << 20;
+
+    for(const auto& entry: getDeviceCache())
+    {
+        const auto originalBudget = memoryBudget(entry.name);
+
+        getAndCallPlugin<void>("/devices/gpu/set_memory_budget", entry.name, budget);
+        POTHOS_TEST_EQUAL(budget, getAndCallPlugin<size_t>("/devices/gpu/memory_budget", entry.name));
+
+        setThreadBackendAndDevice(entry.afBackendEnum, entry.afDeviceIndex);
+        af::deviceGC();
+        POTHOS_TEST_FALSE(memoryUnderPressure(entry.afBackendEnum, entry.afDeviceIndex));
+
+        {
+            // Most of the budget, as float32
+            af::array afArray = af::constant(1.0f, (budget / 4) * 19 / 20);
+            afArray.eval();
+            af::sync();
+            POTHOS_TEST_TRUE(memoryUnderPressure(entry.afBackendEnum, entry.afDeviceIndex));
+
+            // With the custom memory manager, the budget is also enforced.
+            if(memoryManagerInstalled())
+            {
+                POTHOS_TEST_THROWS(
+                    af::constant(1.0f, budget / 4).eval(),
+                    af::exception);
+            }
+        }
+
+        af::deviceGC();
+        POTHOS_TEST_FALSE(memoryUnderPressure(entry.afBackendEnum, entry.afDeviceIndex));
+
+        setMemoryBudget(entry.name, originalBudget);
+    }
+}
+
+POTHOS_TEST_BLOCK("/gpu/tests", test_device_stats)
+{
+    using namespace GPUTests;
+
+    setupTestEnv();
+
+    const auto& deviceCache = getDeviceCache();
+    POTHOS_TEST_FALSE(deviceCache.empty());
+    const auto& entry = deviceCache[0];
+
+    auto getStats = []()
+    {
+        return nlohmann::json::parse(getAndCallPlugin<std::string>("/devices/gpu/stats"));
+    };
+
+    const auto originalStats = getStats().at("Devices").at(0);
+
+    auto abs = Pothos::BlockRegistry::make(
+                   "/gpu/arith/abs",
+                   entry.name,
+                   Pothos::DType(typeid(float)));
+
+    setThreadBackendAndDevice(entry.afBackendEnum, entry.afDeviceIndex);
+    af::array afArray = af::constant(1.0f, 1 << 16);
+    afArray.eval();
+    af::sync();
+
+    const auto stats = getStats();
+    POTHOS_TEST_EQUAL(deviceCache.size(), stats.at("Devices").size());
+    POTHOS_TEST_EQUAL(getAvailableBackends().size(), stats.at("Pinned Memory").size());
+
+    const auto& deviceStats = stats.at("Devices").at(0);
+    POTHOS_TEST_EQUAL(entry.name, deviceStats.at("Name").get<std::string>());
+    POTHOS_TEST_EQUAL(
+        originalStats.at("Active Blocks").get<size_t>() + 1,
+        deviceStats.at("Active Blocks").get<size_t>());
+    POTHOS_TEST_TRUE(deviceStats.at("Locked Bytes").get<size_t>() >= afArray.bytes());
+    POTHOS_TEST_TRUE(deviceStats.at("Allocated Bytes").get<size_t>() >= deviceStats.at("Locked Bytes").get<size_t>());
+    POTHOS_TEST_EQUAL(
+        deviceStats.at("Allocated Bytes").get<size_t>() - deviceStats.at("Locked Bytes").get<size_t>(),
+        deviceStats.at("Cached Bytes").get<size_t>());
+}
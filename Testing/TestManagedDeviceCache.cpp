@@ -1,6 +1,7 @@
-// Copyright (c) 2020 Nicholas Corgan
+// Copyright (c) 2020-2021 Nicholas Corgan
 // SPDX-License-Identifier: BSD-3-Clause
 
+#include "DeviceBenchmark.hpp"
 #include "DeviceCache.hpp"
 #include "TestUtility.hpp"
 
@@ -8,7 +9,15 @@
 #include <Pothos/Proxy.hpp>
 #include <Pothos/Testing.hpp>
 
+#include <nlohmann/json.hpp>
+
+#include <Poco/File.h>
+#include <Poco/TemporaryFile.h>
+
+#include <fstream>
 #include <iostream>
+#include <string>
+#include <vector>
 
 POTHOS_TEST_BLOCK("/gpu/tests", test_managed_device_cache)
 {
@@ -47,5 +56,116 @@ POTHOS_TEST_BLOCK("/gpu/tests", test_managed_device_cache)
         POTHOS_TEST_EQUAL(
             nativeDeviceCacheEntry.memoryStepSize,
             deviceCacheEntry.get<size_t>("Memory Step Size"));
+        POTHOS_TEST_EQUAL(
+            nativeDeviceCacheEntry.fftMSamplesPerSec,
+            deviceCacheEntry.get<double>("FFT Throughput (MSamples/s)"));
+    }
+}
+
+POTHOS_TEST_BLOCK("/gpu/tests", test_device_cache_file)
+{
+    const auto& deviceCache = getDeviceCache();
+
+    const auto filepath = getDeviceCacheFilepath();
+    if(filepath.empty() || deviceCache.empty()) return;
+
+    // Enumerating devices should have written the file.
+    std::ifstream stream(filepath);
+    POTHOS_TEST_TRUE(stream.good());
+
+    const auto topObject = nlohmann::json::parse(stream);
+    POTHOS_TEST_EQUAL(getAvailableBackends().size(), topObject.at("Backends").size());
+
+    const auto& devicesJSON = topObject.at("Devices");
+    POTHOS_TEST_EQUAL(deviceCache.size(), devicesJSON.size());
+    for(size_t deviceIndex = 0; deviceIndex < deviceCache.size(); ++deviceIndex)
+    {
+        POTHOS_TEST_EQUAL(
+            deviceCache[deviceIndex].name,
+            devicesJSON[deviceIndex].at("Name").get<std::string>());
+        POTHOS_TEST_EQUAL(
+            deviceCache[deviceIndex].afDeviceIndex,
+            devicesJSON[deviceIndex].at("Device Index").get<int>());
     }
 }
+
+static nlohmann::json readJSONFile(const std::string& filepath)
+{
+    std::ifstream stream(filepath);
+    POTHOS_TEST_TRUE(stream.good());
+
+    return nlohmann::json::parse(stream);
+}
+
+static void writeJSONFile(
+    const std::string& filepath,
+    const nlohmann::json& topObject)
+{
+    std::ofstream stream(filepath);
+    stream << topObject.dump(4);
+}
+
+POTHOS_TEST_BLOCK("/gpu/tests", test_device_cache_file_key)
+{
+    const auto& deviceCache = getDeviceCache();
+    if(deviceCache.empty()) return;
+
+    Poco::TemporaryFile tempFile;
+    const auto& filepath = tempFile.path();
+
+    // With no file, devices are enumerated and stored.
+    std::vector<DeviceCacheEntry> fileDeviceCache;
+    POTHOS_TEST_FALSE(loadOrEnumerateDeviceCache(filepath, fileDeviceCache));
+    POTHOS_TEST_EQUAL(deviceCache.size(), fileDeviceCache.size());
+    POTHOS_TEST_TRUE(Poco::File(filepath).exists());
+
+    // A file with a matching key is used as-is, so an edited device name
+    // shows up.
+    static const std::string EditedName = "Edited Device";
+
+    auto topObject = readJSONFile(filepath);
+    topObject.at("Devices")[0]["Name"] = EditedName;
+    writeJSONFile(filepath, topObject);
+
+    POTHOS_TEST_TRUE(loadOrEnumerateDeviceCache(filepath, fileDeviceCache));
+    POTHOS_TEST_EQUAL(deviceCache.size(), fileDeviceCache.size());
+    POTHOS_TEST_EQUAL(EditedName, fileDeviceCache[0].name);
+
+    // A mismatched key means the file is stale, so devices are enumerated
+    // again and the file is replaced.
+    topObject.at("Key")["ArrayFire Version"] = "0.0.0 (stale)";
+    writeJSONFile(filepath, topObject);
+
+    POTHOS_TEST_FALSE(loadOrEnumerateDeviceCache(filepath, fileDeviceCache));
+    POTHOS_TEST_EQUAL(deviceCache.size(), fileDeviceCache.size());
+    POTHOS_TEST_EQUAL(deviceCache[0].name, fileDeviceCache[0].name);
+
+    const auto rewrittenObject = readJSONFile(filepath);
+    POTHOS_TEST_NOT_EQUAL(
+        "0.0.0 (stale)",
+        rewrittenObject.at("Key").at("ArrayFire Version").get<std::string>());
+    POTHOS_TEST_EQUAL(
+        deviceCache[0].name,
+        rewrittenObject.at("Devices")[0].at("Name").get<std::string>());
+
+    POTHOS_TEST_TRUE(loadOrEnumerateDeviceCache(filepath, fileDeviceCache));
+}
+
+POTHOS_TEST_BLOCK("/gpu/tests", test_device_benchmark)
+{
+    const auto& deviceCache = getDeviceCache();
+    if(deviceCache.empty()) return;
+
+    // Benchmark a copy so the cache itself is untouched.
+    auto entry = deviceCache[0];
+    benchmarkDevice(entry);
+
+    std::cout << " * " << entry.name << ": score " << deviceScore(entry) << std::endl;
+
+    POTHOS_TEST_TRUE(isDeviceBenchmarked(entry));
+    POTHOS_TEST_TRUE(entry.h2dGBPerSec > 0.0);
+    POTHOS_TEST_TRUE(entry.d2hGBPerSec > 0.0);
+    POTHOS_TEST_TRUE(entry.elementwiseGElemsPerSec > 0.0);
+    POTHOS_TEST_TRUE(entry.fftMSamplesPerSec > 0.0);
+    POTHOS_TEST_TRUE(deviceScore(entry) > 0.0);
+}
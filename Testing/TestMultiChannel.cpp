@@ -0,0 +1,77 @@
+// Copyright (c) 2021 Nicholas Corgan
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "TestUtility.hpp"
+
+#include <Pothos/Framework.hpp>
+#include <Pothos/Proxy.hpp>
+#include <Pothos/Testing.hpp>
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+POTHOS_TEST_BLOCK("/gpu/tests", test_multichannel_one_to_one)
+{
+    using namespace GPUTests;
+
+    setupTestEnv();
+
+    static const Pothos::DType dtype("float32");
+    static constexpr size_t NumChannels = 5;
+
+    auto absBlock = Pothos::BlockRegistry::make("/gpu/arith/abs", "Auto", dtype, NumChannels);
+    POTHOS_TEST_EQUAL(NumChannels, absBlock.call<InputPortVector>("inputs").size());
+    POTHOS_TEST_EQUAL(NumChannels, absBlock.call<OutputPortVector>("outputs").size());
+
+    // All channels run as one array, so they can't be split up.
+    const auto device = absBlock.call<std::string>("device");
+    POTHOS_TEST_THROWS(
+        absBlock.call("setShardDevices", std::vector<std::string>{device, device}),
+        Pothos::ProxyExceptionMessage);
+
+    std::vector<Pothos::BufferChunk> inputs;
+    std::vector<Pothos::BufferChunk> expectedOutputs;
+    std::vector<Pothos::Proxy> collectorSinks;
+
+    {
+        Pothos::Topology topology;
+
+        for(size_t chan = 0; chan < NumChannels; ++chan)
+        {
+            inputs.emplace_back(getSignedTestInputs(dtype.name()));
+            expectedOutputs.emplace_back(dtype, inputs.back().elements());
+            for(size_t elem = 0; elem < inputs.back().elements(); ++elem)
+            {
+                expectedOutputs.back().as<float*>()[elem] = std::abs(inputs.back().as<const float*>()[elem]);
+            }
+
+            auto feederSource = Pothos::BlockRegistry::make("/blocks/feeder_source", dtype);
+            feederSource.call("feedBuffer", inputs.back());
+
+            collectorSinks.emplace_back(Pothos::BlockRegistry::make("/blocks/collector_sink", dtype));
+
+            topology.connect(feederSource, 0, absBlock, chan);
+            topology.connect(absBlock, chan, collectorSinks.back(), 0);
+        }
+
+        topology.commit();
+        POTHOS_TEST_TRUE(topology.waitInactive(0.05));
+    }
+
+    for(size_t chan = 0; chan < NumChannels; ++chan)
+    {
+        testBufferChunk(
+            expectedOutputs[chan],
+            collectorSinks[chan].call<Pothos::BufferChunk>("getBuffer"));
+    }
+
+    POTHOS_TEST_THROWS(
+        Pothos::BlockRegistry::make("/gpu/arith/abs", "Auto", dtype, 0),
+        Pothos::ProxyExceptionMessage);
+
+    // Without numChannels, the block has a single channel.
+    auto singleChannelBlock = Pothos::BlockRegistry::make("/gpu/arith/abs", "Auto", dtype);
+    POTHOS_TEST_EQUAL(1, singleChannelBlock.call<InputPortVector>("inputs").size());
+    POTHOS_TEST_EQUAL(1, singleChannelBlock.call<OutputPortVector>("outputs").size());
+}
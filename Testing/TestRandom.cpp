@@ -0,0 +1,125 @@
+// Copyright (c) 2021 Nicholas Corgan
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "TestUtility.hpp"
+
+#include <Pothos/Framework.hpp>
+#include <Pothos/Proxy.hpp>
+#include <Pothos/Testing.hpp>
+
+#include <Poco/Thread.h>
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace GPUTests
+{
+
+static constexpr unsigned long long TestSeed = 0x0123456789ABCDEFULL;
+
+static Pothos::Proxy makeRandomSource(
+    const Pothos::DType& dtype,
+    const std::string& distribution,
+    size_t streamIndex,
+    size_t batchSize)
+{
+    auto randomSource = Pothos::BlockRegistry::make(
+                            "/gpu/random/source",
+                            "Auto",
+                            dtype,
+                            distribution);
+    randomSource.call("setRandomEngineType", "Philox");
+    randomSource.call("setBatchSize", batchSize);
+    randomSource.call("setStreamIndex", streamIndex);
+    randomSource.call("reseedRandomEngine", TestSeed);
+
+    POTHOS_TEST_EQUAL(TestSeed, randomSource.call<unsigned long long>("seed"));
+    POTHOS_TEST_EQUAL(streamIndex, randomSource.call<size_t>("streamIndex"));
+    POTHOS_TEST_EQUAL(batchSize, randomSource.call<size_t>("batchSize"));
+
+    return randomSource;
+}
+
+static std::vector<Pothos::BufferChunk> runRandomSources(
+    const Pothos::DType& dtype,
+    const std::vector<Pothos::Proxy>& randomSources)
+{
+    std::vector<Pothos::Proxy> collectorSinks;
+
+    {
+        Pothos::Topology topology;
+        for(const auto& randomSource: randomSources)
+        {
+            collectorSinks.emplace_back(Pothos::BlockRegistry::make(
+                                            "/blocks/collector_sink",
+                                            dtype));
+            topology.connect(randomSource, 0, collectorSinks.back(), 0);
+        }
+
+        topology.commit();
+        Poco::Thread::sleep(50 /*ms*/);
+    }
+
+    std::vector<Pothos::BufferChunk> outputs;
+    for(const auto& collectorSink: collectorSinks)
+    {
+        outputs.emplace_back(collectorSink.call<Pothos::BufferChunk>("getBuffer"));
+        POTHOS_TEST_TRUE(outputs.back().elements() > 0);
+    }
+
+    return outputs;
+}
+
+static bool doBufferPrefixesMatch(
+    const Pothos::BufferChunk& bufferChunk0,
+    const Pothos::BufferChunk& bufferChunk1)
+{
+    const auto length = std::min(bufferChunk0.length, bufferChunk1.length);
+
+    return (0 == std::memcmp(
+                     bufferChunk0.as<const void*>(),
+                     bufferChunk1.as<const void*>(),
+                     length));
+}
+
+static void testRandomSourceStreams(
+    const std::string& type,
+    const std::string& distribution)
+{
+    constexpr size_t batchSize = 4096;
+
+    std::cout << "Testing " << type << " (" << distribution << ")..." << std::endl;
+
+    const Pothos::DType dtype(type);
+
+    // The same seed and stream must give the same values, regardless of
+    // what the scheduler asks for per call. Different streams must not.
+    const std::vector<Pothos::Proxy> randomSources =
+    {
+        makeRandomSource(dtype, distribution, 0, batchSize),
+        makeRandomSource(dtype, distribution, 0, batchSize),
+        makeRandomSource(dtype, distribution, 1, batchSize)
+    };
+    const auto outputs = runRandomSources(dtype, randomSources);
+
+    POTHOS_TEST_TRUE(doBufferPrefixesMatch(outputs[0], outputs[1]));
+    POTHOS_TEST_FALSE(doBufferPrefixesMatch(outputs[0], outputs[2]));
+}
+
+}
+
+POTHOS_TEST_BLOCK("/gpu/tests", test_random_source_streams)
+{
+    using namespace GPUTests;
+
+    setupTestEnv();
+
+    for(const std::string& type: {"float32", "float64", "complex_float32", "complex_float64"})
+    {
+        testRandomSourceStreams(type, "Normal");
+        testRandomSourceStreams(type, "Uniform");
+    }
+}
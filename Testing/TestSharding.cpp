@@ -0,0 +1,110 @@
+// Copyright (c) 2021 Nicholas Corgan
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "TestUtility.hpp"
+
+#include <Pothos/Framework.hpp>
+#include <Pothos/Proxy.hpp>
+#include <Pothos/Testing.hpp>
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+namespace GPUTests
+{
+
+static const Pothos::DType dtype("float32");
+
+// Not a multiple of the shard count, so the shards are uneven.
+static constexpr size_t NumShards = 3;
+static constexpr size_t NumInputs = 1021;
+static_assert(0 != (NumInputs % NumShards), "Shards must be uneven");
+
+static Pothos::BufferChunk runBlock(
+    const Pothos::Proxy& block,
+    const Pothos::BufferChunk& input)
+{
+    auto feederSource = Pothos::BlockRegistry::make(
+                            "/blocks/feeder_source",
+                            dtype);
+    feederSource.call("feedBuffer", input);
+
+    auto collectorSink = Pothos::BlockRegistry::make(
+                             "/blocks/collector_sink",
+                             dtype);
+
+    {
+        Pothos::Topology topology;
+        topology.connect(feederSource, 0, block, 0);
+        topology.connect(block, 0, collectorSink, 0);
+
+        topology.commit();
+        POTHOS_TEST_TRUE(topology.waitInactive(0.05));
+    }
+
+    return collectorSink.call<Pothos::BufferChunk>("getBuffer");
+}
+
+}
+
+POTHOS_TEST_BLOCK("/gpu/tests", test_sharding)
+{
+    using namespace GPUTests;
+
+    setupTestEnv();
+
+    // Signed, so abs() changes the values.
+    auto inputs = getSignedTestInputs(dtype.name());
+    POTHOS_TEST_TRUE(inputs.elements() >= NumInputs);
+    inputs.length = NumInputs * dtype.size();
+
+    Pothos::BufferChunk expectedAbsOutputs(dtype, inputs.elements());
+    for(size_t elem = 0; elem < inputs.elements(); ++elem)
+    {
+        expectedAbsOutputs.as<float*>()[elem] = std::abs(inputs.as<const float*>()[elem]);
+    }
+
+    // Listing a device more than once still splits buffers, so this is
+    // tested on any machine.
+    auto absBlock = Pothos::BlockRegistry::make("/gpu/arith/abs", "Auto", dtype);
+    const auto device = absBlock.call<std::string>("device");
+    const std::vector<std::string> shardDevices(NumShards, device);
+
+    absBlock.call("setShardDevices", shardDevices);
+    POTHOS_TEST_EQUAL(shardDevices.size(), absBlock.call<std::vector<std::string>>("shardDevices").size());
+
+    const auto absOutputs = runBlock(absBlock, inputs);
+    POTHOS_TEST_EQUAL(NumInputs, absOutputs.elements());
+    testBufferChunk(
+        expectedAbsOutputs,
+        absOutputs);
+
+    // Each piece of a sharded FIR filter needs the previous piece's input,
+    // so the outputs should match the unsharded filter.
+    const std::vector<float> taps{0.25f, 0.5f, 0.25f};
+
+    auto firBlock = Pothos::BlockRegistry::make("/gpu/signal/fir_filter", "Auto", dtype);
+    firBlock.call("setTaps", taps);
+    const auto expectedFIROutputs = runBlock(firBlock, inputs);
+    POTHOS_TEST_EQUAL(NumInputs, expectedFIROutputs.elements());
+
+    auto shardedFIRBlock = Pothos::BlockRegistry::make("/gpu/signal/fir_filter", "Auto", dtype);
+    shardedFIRBlock.call("setTaps", taps);
+    shardedFIRBlock.call("setShardDevices", shardDevices);
+
+    testBufferChunk(
+        expectedFIROutputs,
+        runBlock(shardedFIRBlock, inputs));
+
+    // Sorting depends on the whole buffer.
+    auto sortBlock = Pothos::BlockRegistry::make("/gpu/algorithm/sort", "Auto", dtype);
+    POTHOS_TEST_THROWS(
+        sortBlock.call("setShardDevices", shardDevices),
+        Pothos::ProxyExceptionMessage);
+
+    // An unknown device is an error.
+    POTHOS_TEST_THROWS(
+        absBlock.call("setShardDevices", std::vector<std::string>{"NotADevice"}),
+        Pothos::ProxyExceptionMessage);
+}
@@ -1,7 +1,8 @@
-// Copyright (c) 2020 Nicholas Corgan
+// Copyright (c) 2020-2021 Nicholas Corgan
 // SPDX-License-Identifier: BSD-3-Clause
 
 #include "DeviceCache.hpp"
+#include "DeviceThreads.hpp"
 #include "TestUtility.hpp"
 
 #include <Poco/Random.h>
@@ -19,7 +20,7 @@ namespace GPUTests
 
 void setupTestEnv()
 {
-    af::setBackend(getAvailableBackends()[0]);
+    setThreadBackend(getAvailableBackends()[0]);
 }
 
 template <typename T>
@@ -175,6 +176,13 @@ Pothos::BufferChunk getTestInputs(const std::string& type)
     return Pothos::Object(af::randu(TestInputLength, afDType)).convert<Pothos::BufferChunk>();
 }
 
+Pothos::BufferChunk getSignedTestInputs(const std::string& type)
+{
+    const auto afDType = Pothos::Object(Pothos::DType(type)).convert<af::dtype>();
+
+    return Pothos::Object(af::randn(TestInputLength, afDType)).convert<Pothos::BufferChunk>();
+}
+
 Pothos::Object getRandomValue(const Pothos::BufferChunk& bufferChunk)
 {
     #define GET_RANDOM_VALUE_OF_TYPE(typeStr, cType) \
@@ -177,6 +177,11 @@ static constexpr size_t TestInputLength = 1024;
 
 Pothos::BufferChunk getTestInputs(const std::string& type);
 
+// getTestInputs() values are in [0,1) for floating-point types, which
+// hides sign handling. These are normally distributed around zero.
+// Floating-point types only.
+Pothos::BufferChunk getSignedTestInputs(const std::string& type);
+
 Pothos::Object getRandomValue(const Pothos::BufferChunk& bufferChunk);
 
 Pothos::Object getSingleTestInput(const std::string& type);
@@ -0,0 +1,231 @@
+// Copyright (c) 2021 Nicholas Corgan
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "TestUtility.hpp"
+
+#include <Pothos/Framework.hpp>
+#include <Pothos/Proxy.hpp>
+#include <Pothos/Testing.hpp>
+
+#include <Poco/Thread.h>
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace GPUTests
+{
+
+static constexpr double SampleRate = 1e6;
+static constexpr double Amplitude = 2.5;
+static constexpr double Phase = 0.5;
+
+// Chirps sweep over this many samples, so several sweeps are checked.
+static constexpr double ChirpDuration = 0.01;
+static constexpr double ChirpEndFrequency = 1e5;
+static constexpr size_t MaxChirpSamples = 30000;
+
+// Near a discontinuity, the device and the reference can round to
+// different sides.
+static constexpr double DiscontinuityTolerance = 1e-9;
+
+static double wrapPhase(double phase)
+{
+    auto ret = std::fmod(phase, 2.0 * M_PI);
+    if(ret < 0.0) ret += (2.0 * M_PI);
+
+    return ret;
+}
+
+static bool isNearPhase(double phase, double target)
+{
+    return std::abs(wrapPhase(phase) - target) < DiscontinuityTolerance;
+}
+
+template <typename T>
+static Pothos::Proxy makeWaveformSource(
+    const std::string& waveform,
+    double sampleRate,
+    double frequency,
+    double phase)
+{
+    static const Pothos::DType dtype(typeid(T));
+
+    std::cout << "Testing " << waveform << " (" << dtype.name()
+              << ", " << frequency << " Hz)..." << std::endl;
+
+    auto waveformSource = Pothos::BlockRegistry::make(
+                              "/gpu/signal/waveform",
+                              "Auto",
+                              dtype,
+                              waveform,
+                              sampleRate,
+                              frequency,
+                              Amplitude);
+    waveformSource.call("setPhase", phase);
+
+    POTHOS_TEST_EQUAL(waveform, waveformSource.call<std::string>("waveform"));
+    POTHOS_TEST_EQUAL(sampleRate, waveformSource.call<double>("sampleRate"));
+    POTHOS_TEST_EQUAL(frequency, waveformSource.call<double>("frequency"));
+    POTHOS_TEST_EQUAL(Amplitude, waveformSource.call<double>("amplitude"));
+
+    return waveformSource;
+}
+
+template <typename T>
+static std::vector<T> getOutput(const Pothos::Proxy& waveformSource)
+{
+    static const Pothos::DType dtype(typeid(T));
+
+    auto collectorSink = Pothos::BlockRegistry::make(
+                             "/blocks/collector_sink",
+                             dtype);
+
+    {
+        Pothos::Topology topology;
+        topology.connect(waveformSource, 0, collectorSink, 0);
+
+        topology.commit();
+        Poco::Thread::sleep(50 /*ms*/);
+    }
+
+    auto output = bufferChunkToStdVector<T>(collectorSink.call<Pothos::BufferChunk>("getBuffer"));
+    POTHOS_TEST_FALSE(output.empty());
+
+    return output;
+}
+
+// The expected values are calculated from the absolute sample index, so
+// any phase discontinuity between calls to work() would show up here.
+static void testSine(double frequency)
+{
+    const auto output = getOutput<double>(makeWaveformSource<double>("Sine", SampleRate, frequency, Phase));
+    const double phaseStep = 2.0 * M_PI * frequency / SampleRate;
+
+    for(size_t i = 0; i < output.size(); ++i)
+    {
+        testEqual(
+            Amplitude * std::sin(Phase + (phaseStep * double(i))),
+            output[i]);
+    }
+}
+
+static void testComplexExponential(double frequency)
+{
+    const auto output = getOutput<std::complex<double>>(makeWaveformSource<std::complex<double>>("Complex Exponential", SampleRate, frequency, Phase));
+    const double phaseStep = 2.0 * M_PI * frequency / SampleRate;
+
+    for(size_t i = 0; i < output.size(); ++i)
+    {
+        testEqual(
+            std::polar(Amplitude, Phase + (phaseStep * double(i))),
+            output[i]);
+    }
+}
+
+// The square wave is positive for wrapped phases in [0, pi) and negative
+// for [pi, 2pi).
+static void testSquare(double frequency)
+{
+    const auto output = getOutput<double>(makeWaveformSource<double>("Square", SampleRate, frequency, Phase));
+    const double phaseStep = 2.0 * M_PI * frequency / SampleRate;
+
+    for(size_t i = 0; i < output.size(); ++i)
+    {
+        const double phase = Phase + (phaseStep * double(i));
+        if(isNearPhase(phase, 0.0) || isNearPhase(phase, M_PI) || isNearPhase(phase, 2.0 * M_PI)) continue;
+
+        testEqual(
+            (wrapPhase(phase) < M_PI) ? Amplitude : -Amplitude,
+            output[i]);
+    }
+}
+
+// The sawtooth ramps from -1 at a wrapped phase of 0 to 1 at 2pi.
+static void testSawtooth(double frequency)
+{
+    const auto output = getOutput<double>(makeWaveformSource<double>("Sawtooth", SampleRate, frequency, Phase));
+    const double phaseStep = 2.0 * M_PI * frequency / SampleRate;
+
+    for(size_t i = 0; i < output.size(); ++i)
+    {
+        const double phase = Phase + (phaseStep * double(i));
+        if(isNearPhase(phase, 0.0) || isNearPhase(phase, 2.0 * M_PI)) continue;
+
+        testEqual(
+            Amplitude * ((wrapPhase(phase) / M_PI) - 1.0),
+            output[i]);
+    }
+}
+
+// With a sample rate of four times the frequency, samples land exactly on
+// the thresholds at 0 and pi, so this checks which side they fall on.
+static void testThresholds()
+{
+    const std::vector<double> expectedSquare = {Amplitude, Amplitude, -Amplitude, -Amplitude};
+    const std::vector<double> expectedSawtooth = {-Amplitude, (-0.5 * Amplitude), 0.0, (0.5 * Amplitude)};
+
+    const auto squareOutput = getOutput<double>(makeWaveformSource<double>("Square", 4.0, 1.0, 0.0));
+    const auto sawtoothOutput = getOutput<double>(makeWaveformSource<double>("Sawtooth", 4.0, 1.0, 0.0));
+    for(size_t i = 0; i < squareOutput.size(); ++i)
+    {
+        testEqual(expectedSquare[i % 4], squareOutput[i]);
+    }
+    for(size_t i = 0; i < sawtoothOutput.size(); ++i)
+    {
+        testEqual(expectedSawtooth[i % 4], sawtoothOutput[i]);
+    }
+}
+
+// The reference accumulates each sample's instantaneous frequency, which
+// restarts at the start frequency with each sweep.
+static void testChirp(
+    const std::string& waveform,
+    double frequency)
+{
+    auto waveformSource = makeWaveformSource<double>(waveform, SampleRate, frequency, Phase);
+    waveformSource.call("setChirpEndFrequency", ChirpEndFrequency);
+    waveformSource.call("setChirpDuration", ChirpDuration);
+
+    const auto output = getOutput<double>(waveformSource);
+    const double sweepLength = ChirpDuration * SampleRate;
+    const bool isLinear = ("Linear Chirp" == waveform);
+
+    double phase = Phase;
+    for(size_t i = 0; i < std::min(output.size(), MaxChirpSamples); ++i)
+    {
+        testEqual(Amplitude * std::cos(phase), output[i]);
+
+        const double sweepPos = std::fmod(double(i), sweepLength) / sweepLength;
+        const double instFrequency = isLinear ? (frequency + ((ChirpEndFrequency - frequency) * sweepPos))
+                                              : (frequency * std::pow(ChirpEndFrequency / frequency, sweepPos));
+        phase = wrapPhase(phase + (2.0 * M_PI * instFrequency / SampleRate));
+    }
+}
+
+}
+
+POTHOS_TEST_BLOCK("/gpu/tests", test_waveform_source)
+{
+    using namespace GPUTests;
+
+    setupTestEnv();
+
+    // The first frequency has a period of 1000 samples, which exercises the
+    // cached period path. The second has no whole-sample period.
+    for(double frequency: {1e3, 1234.5})
+    {
+        testSine(frequency);
+        testComplexExponential(frequency);
+        testSquare(frequency);
+        testSawtooth(frequency);
+    }
+
+    testThresholds();
+
+    testChirp("Linear Chirp", 1e3);
+    testChirp("Log Chirp", 1e3);
+}